@@ -0,0 +1,244 @@
+#include <algorithm>
+#include <cctype>
+#include <filesystem>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "BatchGrader.hxx"
+#include "ExamConfig.hxx"
+#include "SheetGrader.hxx"
+#include "TextLogging.hxx"
+#include "TiffPageReader.hxx"
+
+namespace {
+	std::ostringstream tlOss;
+	TextLogging tlog;
+
+	//File extensions of the scanned images that will be graded
+	const std::vector<std::string> SCAN_EXTENSIONS = {".png", ".jpg", ".jpeg", ".tif", ".tiff", ".bmp"};
+
+	void printUsage(const char* programName) {
+		std::cerr << "Usage: " << programName << " [--threads <count>] <sheet-layout> <alignment-algorithm> <detection-algorithm> <scans>" << std::endl;
+		std::cerr << "       " << programName << " --compile-layout <output> <sheet-layout.xml>" << std::endl;
+		std::cerr << std::endl;
+		std::cerr << "Grades every scanned image in <scans> and writes the answers on each sheet to standard output as CSV. <scans> is either a directory" << std::endl;
+		std::cerr << "of scanned images (graded in filename order) or a multi-page TIFF file (graded in page order)." << std::endl;
+		std::cerr << "If the sheet layout has more than one side, consecutive images are treated as the sides of one sheet." << std::endl;
+		std::cerr << "Algorithm names refer to the filters in the alignment and detection algorithm configuration files." << std::endl;
+		std::cerr << "<sheet-layout> is either an XML sheet layout or a binary layout written by --compile-layout, which loads without being parsed." << std::endl;
+		std::cerr << std::endl;
+		std::cerr << "  --threads <count>            Number of worker threads to grade with. Defaults to one per core." << std::endl;
+		std::cerr << "  --compile-layout <output>    Write <sheet-layout.xml> to <output> as a binary layout instead of grading." << std::endl;
+	}
+
+	///
+	/// <summary> Get a sorted list of all of the scanned images in a directory </summary>
+	///
+	int listScans(const std::string& directory, std::vector<std::string>& scans) {
+		int status = 0;
+
+		std::error_code error;
+		std::filesystem::directory_iterator dirIter(directory, error);
+		if(error) {
+			status = -1;
+			TLOG_CRITICAL(tlog, tlOss, "Failed to open scan directory \"" << directory << "\": " << error.message());
+		}
+
+		if(status >= 0) {
+			for(const auto& entry : dirIter) {
+				if(!entry.is_regular_file()) {
+					continue;
+				}
+
+				std::string extension = entry.path().extension().string();
+				std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+				if(std::find(SCAN_EXTENSIONS.begin(), SCAN_EXTENSIONS.end(), extension) != SCAN_EXTENSIONS.end()) {
+					scans.push_back(entry.path().string());
+				}
+			}
+			std::sort(scans.begin(), scans.end());
+		}
+
+		return status;
+	}
+
+	///
+	/// <summary> Quote a CSV field if it contains any characters that would otherwise break the row </summary>
+	///
+	std::string csvField(const std::string& value) {
+		if(value.find_first_of(",\"\n") == std::string::npos) {
+			return value;
+		}
+
+		std::string quoted = "\"";
+		for(char c : value) {
+			if(c == '"') {
+				quoted += '"';
+			}
+			quoted += c;
+		}
+		quoted += '"';
+		return quoted;
+	}
+
+	///
+	/// <summary> Write the CSV header, naming a column for each question on the sheet layout </summary>
+	///
+	void writeHeader(std::ostream& os, const EasyGrade::ScanSheetLayout& layout) {
+		os << "sheet";
+		for(size_t i = 0; i < layout.numSides(); i++) {
+			const EasyGrade::SideLayout* side = layout.sideLayout(i);
+			for(size_t j = 0; j < side->numChildren(); j++) {
+				const EasyGrade::GroupLayout* group = side->groupAt(j);
+				for(size_t k = 0; k < group->numChildren(); k++) {
+					os << "," << csvField(group->getName() + " " + std::to_string(group->questionAt(k)->getQuestionNumber()));
+				}
+			}
+		}
+		os << std::endl;
+	}
+}
+
+int main(int argc, char *argv[]) {
+	int status = 0;
+
+	//Separate the options from the positional arguments
+	size_t numThreads = 0;
+	std::string compiledLayoutFilename;
+	std::vector<std::string> positionalArgs;
+	for(int i = 1; i < argc; i++) {
+		const std::string arg = argv[i];
+		if(arg == "--threads" && i + 1 < argc) {
+			std::istringstream threadsStream(argv[++i]);
+			if(!(threadsStream >> numThreads) || !threadsStream.eof()) {
+				printUsage(argv[0]);
+				return 2;
+			}
+		} else if(arg == "--compile-layout" && i + 1 < argc) {
+			compiledLayoutFilename = argv[++i];
+		} else {
+			positionalArgs.push_back(arg);
+		}
+	}
+
+	//Compiling a layout doesn't grade anything, so it only needs the layout
+	if(!compiledLayoutFilename.empty()) {
+		if(positionalArgs.size() != 1) {
+			printUsage(argv[0]);
+			return 2;
+		}
+
+		ExamConfig examConfig;
+		if(examConfig.loadSheetLayout(positionalArgs[0]) < 0) {
+			std::cerr << "Failed to load sheet layout \"" << positionalArgs[0] << "\"" << std::endl;
+			status = 2;
+		} else if(examConfig.getCompiledLayout().save(compiledLayoutFilename) < 0) {
+			std::cerr << "Failed to write binary layout \"" << compiledLayoutFilename << "\"" << std::endl;
+			status = 2;
+		}
+		return status;
+	}
+
+	if(positionalArgs.size() != 4) {
+		printUsage(argv[0]);
+		return 2;
+	}
+
+	const std::string layoutFilename = positionalArgs[0];
+	const std::string alignmentAlgorithm = positionalArgs[1];
+	const std::string detectionAlgorithm = positionalArgs[2];
+	const std::string scanPath = positionalArgs[3];
+
+	//Load the exam configuration
+	ExamConfig examConfig;
+	if(examConfig.loadSheetLayout(layoutFilename) < 0) {
+		status = -1;
+		std::cerr << "Failed to load sheet layout \"" << layoutFilename << "\"" << std::endl;
+	}
+
+	if(status >= 0 && examConfig.setAlignmentAlgorithm(alignmentAlgorithm) != 0) {
+		status = -1;
+		std::cerr << "Failed to load alignment algorithm \"" << alignmentAlgorithm << "\"" << std::endl;
+	}
+
+	if(status >= 0 && examConfig.setDetectionAlgorithm(detectionAlgorithm) != 0) {
+		status = -1;
+		std::cerr << "Failed to load detection algorithm \"" << detectionAlgorithm << "\"" << std::endl;
+	}
+
+	SheetGrader grader(examConfig);
+	if(status >= 0 && grader.sidesPerSheet() == 0) {
+		status = -1;
+		std::cerr << "Sheet layout \"" << layoutFilename << "\" does not have any sides" << std::endl;
+	}
+
+	//Find the scans to grade. A single file is a multi-page archive, whose pages are only decoded as they are graded.
+	const bool isArchive = std::filesystem::is_regular_file(scanPath);
+	TiffPageReader archive;
+	std::vector<std::string> scans;
+	if(status >= 0 && isArchive && archive.open(scanPath) < 0) {
+		status = -1;
+		std::cerr << "Failed to open scan archive \"" << scanPath << "\"" << std::endl;
+	} else if(status >= 0 && !isArchive && listScans(scanPath, scans) < 0) {
+		status = -1;
+		std::cerr << "Failed to list scans in \"" << scanPath << "\"" << std::endl;
+	}
+
+	if(status < 0) {
+		std::cerr << "See \"" << TextLogging::getLogFileName() << "\" for details." << std::endl;
+		return 2;
+	}
+
+	if(!isArchive && scans.size() % grader.sidesPerSheet() != 0) {
+		TLOG_WARNING(tlog, tlOss, "Found " << scans.size() << " scans, which is not a multiple of the " << grader.sidesPerSheet() << " sides per sheet. The trailing scans will be ignored.");
+	}
+
+	//Group the scans into sheets
+	std::vector<std::vector<std::string>> sheets;
+	for(size_t i = 0; i + grader.sidesPerSheet() <= scans.size(); i += grader.sidesPerSheet()) {
+		sheets.emplace_back(scans.begin() + i, scans.begin() + i + grader.sidesPerSheet());
+	}
+
+	//Grade each sheet, writing each row as soon as the sheet (and every sheet before it) is done
+	writeHeader(std::cout, examConfig.getSheetLayout());
+
+	//Sheets from an archive are named after the archive and the page they start on
+	auto sheetName = [&](size_t sheetIndex) {
+		if(isArchive) {
+			return std::filesystem::path(scanPath).filename().string() + ":" + std::to_string(sheetIndex * grader.sidesPerSheet() + 1);
+		} else {
+			return std::filesystem::path(sheets[sheetIndex][0]).filename().string();
+		}
+	};
+
+	size_t numFailed = 0;
+	BatchGrader batchGrader(grader, numThreads);
+	auto onSheetGraded = [&](size_t sheetIndex, int sheetStatus, const std::vector<QuestionResponse>& responses) {
+		if(sheetStatus < 0) {
+			numFailed++;
+			std::cerr << "Failed to grade sheet \"" << sheetName(sheetIndex) << "\"" << std::endl;
+			return;
+		}
+
+		std::cout << csvField(sheetName(sheetIndex));
+		for(const auto& response : responses) {
+			std::cout << "," << csvField(response.answer);
+		}
+		std::cout << std::endl;
+	};
+
+	if(isArchive) {
+		batchGrader.gradeArchive(archive, onSheetGraded);
+	} else {
+		batchGrader.gradeSheets(sheets, onSheetGraded);
+	}
+
+	if(numFailed > 0) {
+		std::cerr << numFailed << " sheets could not be graded. See \"" << TextLogging::getLogFileName() << "\" for details." << std::endl;
+		status = 1;
+	}
+
+	return status;
+}
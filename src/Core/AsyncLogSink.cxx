@@ -0,0 +1,233 @@
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <memory>
+
+#include "AsyncLogSink.hxx"
+
+namespace {
+	const char* DEFAULT_COLOR = "\033[0m";
+	const char* WHITE_COLOR = "\033[1;37m";
+	const char* RED_COLOR = "\033[1;31m";
+	const char* GREEN_COLOR = "\033[0;32m";
+	const char* YELLOW_COLOR = "\033[1;33m";
+	const char* MAGENTA_COLOR = "\033[1;35m";
+
+	const char* TRUNCATED_SUFFIX = " [truncated]";
+
+	//How long the background thread sleeps when the buffer is empty before checking it again
+	const std::chrono::milliseconds IDLE_INTERVAL(10);
+}
+
+AsyncLogSink::AsyncLogSink(const std::string& filename) : slots_(CAPACITY), logFile_(filename, std::ios_base::app) {
+	for(size_t i = 0; i < CAPACITY; i++) {
+		slots_[i].sequence.store(i, std::memory_order_relaxed);
+	}
+	thread_ = std::thread(&AsyncLogSink::run, this);
+}
+
+AsyncLogSink::~AsyncLogSink() {
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		isStopping_ = true;
+	}
+	wakeCondition_.notify_one();
+	thread_.join();
+}
+
+void AsyncLogSink::push(LogLevel level, const char* file, int line, const std::string& message, bool isColorTextEnabled) {
+	//Note how far the background thread had written before trying, so that if it makes room between a failed attempt and the wait below,
+	//the wait doesn't miss it
+	size_t writtenPos = writtenPos_.load(std::memory_order_acquire);
+	while(!tryPush(level, file, line, message, isColorTextEnabled)) {
+		//Fatal entries are the last thing logged before the program is killed, so they are always waited for
+		if(overflowPolicy_ == LogOverflowPolicy::DROP && level != LogLevel::FATAL) {
+			numDroppedEntries_++;
+			return;
+		}
+
+		//The buffer is full, so get the background thread working on it and sleep until it has written some entries out
+		std::unique_lock<std::mutex> lock(mutex_);
+		isFlushRequested_ = true;
+		wakeCondition_.notify_one();
+		writtenCondition_.wait(lock, [this, writtenPos] { return writtenPos_.load(std::memory_order_acquire) != writtenPos; });
+		writtenPos = writtenPos_.load(std::memory_order_acquire);
+	}
+}
+
+void AsyncLogSink::flush() {
+	const size_t target = enqueuePos_.load(std::memory_order_acquire);
+
+	std::unique_lock<std::mutex> lock(mutex_);
+	isFlushRequested_ = true;
+	wakeCondition_.notify_one();
+	writtenCondition_.wait(lock, [this, target] { return writtenPos_.load(std::memory_order_acquire) >= target; });
+}
+
+bool AsyncLogSink::tryPush(LogLevel level, const char* file, int line, const std::string& message, bool isColorTextEnabled) {
+	//Claim a slot by advancing the enqueue position past it. The slot's sequence number tells whether the background thread is done with the
+	//record that was in it the last time around the ring buffer
+	size_t pos = enqueuePos_.load(std::memory_order_relaxed);
+	Slot* slot = nullptr;
+	for(;;) {
+		slot = &slots_[pos % CAPACITY];
+		const size_t sequence = slot->sequence.load(std::memory_order_acquire);
+		if(sequence == pos) {
+			if(enqueuePos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+				break;
+			}
+		} else if(sequence < pos) {
+			//The slot still holds a record from the previous lap, so the buffer is full
+			return false;
+		} else {
+			//Another thread claimed this slot first
+			pos = enqueuePos_.load(std::memory_order_relaxed);
+		}
+	}
+
+	LogRecord& record = slot->record;
+	record.level = level;
+	record.file = file;
+	record.line = line;
+	record.isColorTextEnabled = isColorTextEnabled;
+	if(message.size() <= MAX_MESSAGE_LENGTH) {
+		record.length = message.size();
+		std::memcpy(record.message, message.data(), record.length);
+	} else {
+		const size_t suffixLength = std::strlen(TRUNCATED_SUFFIX);
+		record.length = MAX_MESSAGE_LENGTH;
+		std::memcpy(record.message, message.data(), MAX_MESSAGE_LENGTH - suffixLength);
+		std::memcpy(record.message + MAX_MESSAGE_LENGTH - suffixLength, TRUNCATED_SUFFIX, suffixLength);
+	}
+
+	//Publish the record to the background thread
+	slot->sequence.store(pos + 1, std::memory_order_release);
+	return true;
+}
+
+bool AsyncLogSink::tryPop(LogRecord& record) {
+	Slot& slot = slots_[dequeuePos_ % CAPACITY];
+	if(slot.sequence.load(std::memory_order_acquire) != dequeuePos_ + 1) {
+		return false;
+	}
+
+	record.level = slot.record.level;
+	record.file = slot.record.file;
+	record.line = slot.record.line;
+	record.isColorTextEnabled = slot.record.isColorTextEnabled;
+	record.length = slot.record.length;
+	std::memcpy(record.message, slot.record.message, record.length);
+
+	//Hand the slot back to the producers for the next lap around the ring buffer
+	slot.sequence.store(dequeuePos_ + CAPACITY, std::memory_order_release);
+	dequeuePos_++;
+	return true;
+}
+
+void AsyncLogSink::writeRecord(const LogRecord& record) {
+	//Set the text to the appropriate color (if color text is enabled)
+	if(record.isColorTextEnabled) {
+		switch(record.level) {
+		case LogLevel::DEBUG:
+			logFile_ << GREEN_COLOR;
+			break;
+		case LogLevel::INFO:
+			logFile_ << WHITE_COLOR;
+			break;
+		case LogLevel::WARNING:
+			logFile_ << YELLOW_COLOR;
+			break;
+		case LogLevel::CRITICAL:
+			logFile_ << MAGENTA_COLOR;
+			break;
+		case LogLevel::FATAL:
+			logFile_ << RED_COLOR;
+			break;
+		default:
+			logFile_ << DEFAULT_COLOR;
+		}
+	}
+
+	//Log the warning severity
+	switch(record.level) {
+	case LogLevel::DEBUG:
+		logFile_ << "DEBUG: ";
+		break;
+	case LogLevel::INFO:
+		logFile_ << "INFO: ";
+		break;
+	case LogLevel::WARNING:
+		logFile_ << "WARN: ";
+		break;
+	case LogLevel::CRITICAL:
+		logFile_ << "CRIT: ";
+		break;
+	case LogLevel::FATAL:
+		logFile_ << "FATAL: ";
+		break;
+	default:
+		logFile_ << ": ";
+	}
+
+	//Log the file/line info
+	logFile_ << record.file << " #" << record.line << ": ";
+
+	//Log the warning message
+	logFile_.write(record.message, record.length);
+
+	//Reset the text color
+	if(record.isColorTextEnabled) {
+		logFile_ << DEFAULT_COLOR;
+	}
+
+	logFile_ << '\n';
+}
+
+void AsyncLogSink::run() {
+	//Records are large, so keep the one being written off of the stack
+	std::unique_ptr<LogRecord> record = std::make_unique<LogRecord>();
+
+	for(;;) {
+		bool isWriteNeeded = false;
+		while(tryPop(*record)) {
+			writeRecord(*record);
+			isWriteNeeded = true;
+		}
+
+		const uint64_t numDroppedEntries = numDroppedEntries_.load();
+		if(numDroppedEntries != numReportedDroppedEntries_) {
+			logFile_ << "WARN: " << (numDroppedEntries - numReportedDroppedEntries_) << " log entries were dropped because the log buffer was full\n";
+			numReportedDroppedEntries_ = numDroppedEntries;
+			isWriteNeeded = true;
+		}
+
+		if(isWriteNeeded) {
+			logFile_.flush();
+		}
+
+		std::unique_lock<std::mutex> lock(mutex_);
+		writtenPos_.store(dequeuePos_, std::memory_order_release);
+		writtenCondition_.notify_all();
+
+		if(isStopping_ && enqueuePos_.load(std::memory_order_acquire) == dequeuePos_) {
+			break;
+		}
+
+		if(!isWriteNeeded) {
+			wakeCondition_.wait_for(lock, IDLE_INTERVAL, [this] { return isStopping_ || isFlushRequested_; });
+		}
+		isFlushRequested_ = false;
+	}
+}
+
+void AsyncLogSink::setOverflowPolicy(LogOverflowPolicy overflowPolicy) {
+	overflowPolicy_ = overflowPolicy;
+}
+
+LogOverflowPolicy AsyncLogSink::getOverflowPolicy() const {
+	return overflowPolicy_;
+}
+
+uint64_t AsyncLogSink::getNumDroppedEntries() const {
+	return numDroppedEntries_;
+}
@@ -0,0 +1,120 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+enum class LogLevel {
+	DEBUG,
+	INFO,
+	WARNING,
+	CRITICAL,
+	FATAL
+};
+
+///
+/// <summary> What a thread that logs an entry should do when the log buffer is full </summary>
+///
+enum class LogOverflowPolicy {
+	//Wait for the background thread to make room. No entries are lost, but a thread that logs heavily can be slowed down to the speed of the disk.
+	//Waiting threads sleep until the background thread has written entries out, rather than spinning.
+	BLOCK,
+	//Discard the entry and count it. The number of discarded entries is written to the log once there is room again. FATAL entries are never
+	//discarded; they wait for room as with BLOCK.
+	DROP
+};
+
+///
+/// <summary> Writes log entries to a file on a background thread. Threads that log only copy their entry into a fixed-size slot of a lock-free
+///           ring buffer; formatting the entry and writing it to the file both happen on the background thread. </summary>
+///
+class AsyncLogSink {
+public:
+	///
+	/// <summary> Open the log file and start the background thread </summary>
+	///
+	/// <param name="filename"> The file to append log entries to </param>
+	///
+	explicit AsyncLogSink(const std::string& filename);
+
+	///
+	/// <summary> Write every entry still in the buffer to the file and stop the background thread </summary>
+	///
+	~AsyncLogSink();
+
+	AsyncLogSink(const AsyncLogSink&) = delete;
+	AsyncLogSink& operator=(const AsyncLogSink&) = delete;
+
+	///
+	/// <summary> Queue an entry to be written to the log file. Safe to call from any number of threads at once. </summary>
+	///
+	/// <param name="level"> The severity of the entry </param>
+	/// <param name="file"> The source file that logged the entry. Must be a string literal (i.e. __FILE__), since only the pointer is stored. </param>
+	/// <param name="line"> The line of the source file that logged the entry </param>
+	/// <param name="message"> The message to log. Messages longer than AsyncLogSink::MAX_MESSAGE_LENGTH are truncated. </param>
+	/// <param name="isColorTextEnabled"> Whether to color code the entry using ANSI color codes </param>
+	///
+	void push(LogLevel level, const char* file, int line, const std::string& message, bool isColorTextEnabled);
+
+	///
+	/// <summary> Wait until every entry queued before this call has been written to the log file </summary>
+	///
+	void flush();
+
+	void setOverflowPolicy(LogOverflowPolicy overflowPolicy);
+	LogOverflowPolicy getOverflowPolicy() const;
+
+	///
+	/// <summary> Get the total number of entries discarded because the buffer was full (only happens with LogOverflowPolicy::DROP) </summary>
+	///
+	uint64_t getNumDroppedEntries() const;
+
+	static const size_t MAX_MESSAGE_LENGTH = 2000;
+
+private:
+	struct LogRecord {
+		LogLevel level{LogLevel::INFO};
+		const char* file{nullptr};
+		int line{0};
+		bool isColorTextEnabled{false};
+		size_t length{0};
+		char message[MAX_MESSAGE_LENGTH];
+	};
+
+	struct Slot {
+		//Which lap around the ring buffer this slot is ready for. Equal to the slot's position when it is free to be written and to the position
+		//plus one once a record has been written to it
+		std::atomic<size_t> sequence{0};
+		LogRecord record{};
+	};
+
+	bool tryPush(LogLevel level, const char* file, int line, const std::string& message, bool isColorTextEnabled);
+	bool tryPop(LogRecord& record);
+	void writeRecord(const LogRecord& record);
+	void run();
+
+	static const size_t CAPACITY = 512;
+
+	std::vector<Slot> slots_;
+	std::atomic<size_t> enqueuePos_{0};
+	size_t dequeuePos_{0};
+
+	std::atomic<size_t> writtenPos_{0};
+	std::atomic<uint64_t> numDroppedEntries_{0};
+	uint64_t numReportedDroppedEntries_{0};
+	std::atomic<LogOverflowPolicy> overflowPolicy_{LogOverflowPolicy::BLOCK};
+
+	std::ofstream logFile_;
+
+	bool isStopping_{false};
+	bool isFlushRequested_{false};
+	std::mutex mutex_{};
+	std::condition_variable wakeCondition_{};
+	std::condition_variable writtenCondition_{};
+	std::thread thread_{};
+};
@@ -0,0 +1,221 @@
+#include <algorithm>
+#include <atomic>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <thread>
+
+#include "BatchGrader.hxx"
+#include "BoundedQueue.hxx"
+#include "TextLogging.hxx"
+
+namespace {
+	thread_local std::ostringstream tlOss;
+	thread_local TextLogging tlog;
+
+	///
+	/// <summary> One side of one sheet as it moves through the grading stages </summary>
+	///
+	struct SideJob {
+		size_t sheetIndex{0};
+		size_t sideNumber{0};
+		int status{0};
+		SheetScan scan{};
+		std::vector<QuestionResponse> responses{};
+	};
+
+	using SideJobQueue = BoundedQueue<std::unique_ptr<SideJob>>;
+
+	///
+	/// <summary> The responses collected so far for a sheet whose sides have not all finished grading yet </summary>
+	///
+	struct PendingSheet {
+		size_t sidesDone{0};
+		int status{0};
+		std::vector<std::vector<QuestionResponse>> sideResponses{};
+	};
+
+	///
+	/// <summary> Start a group of worker threads that all run the same stage. The output queue is closed once the last of them finishes, which
+	///           lets the next stage know that no more work is coming. </summary>
+	///
+	void startStage(std::vector<std::thread>& threads, size_t count, SideJobQueue& output, const std::function<void()>& work) {
+		auto remaining = std::make_shared<std::atomic<size_t>>(count);
+		for(size_t i = 0; i < count; i++) {
+			threads.emplace_back([remaining, &output, work] {
+				work();
+				if(--(*remaining) == 0) {
+					output.close();
+				}
+			});
+		}
+	}
+}
+
+BatchGrader::BatchGrader(const SheetGrader& sheetGrader, size_t numThreads, size_t queueCapacity) : sheetGrader_(sheetGrader), numThreads_(numThreads), queueCapacity_(queueCapacity) {
+	if(numThreads_ == 0) {
+		numThreads_ = std::max(1u, std::thread::hardware_concurrency());
+	}
+	if(queueCapacity_ == 0) {
+		queueCapacity_ = 2 * numThreads_;
+	}
+}
+
+BatchGrader::~BatchGrader() = default;
+
+int BatchGrader::gradeSheets(const std::vector<std::vector<std::string>>& sheets, const SheetCallback& onSheetGraded) const {
+	int status = 0;
+
+	const size_t sidesPerSheet = sheetGrader_.sidesPerSheet();
+	for(size_t i = 0; i < sheets.size(); i++) {
+		if(sheets[i].size() != sidesPerSheet) {
+			status = -1;
+			TLOG_CRITICAL(tlog, tlOss, "Expected " << sidesPerSheet << " scanned images for sheet " << i << ", but recieved " << sheets[i].size());
+		}
+	}
+
+	if(status >= 0) {
+		auto loadSide = [this, &sheets](size_t sheetIndex, size_t sideNumber, SheetScan& scan) {
+			return sheetGrader_.loadSide(scan, sheets[sheetIndex][sideNumber], sideNumber);
+		};
+		auto nameSheet = [&sheets](size_t sheetIndex) {
+			return "\"" + sheets[sheetIndex][0] + "\"";
+		};
+		status = gradeSides(sheets.size(), loadSide, nameSheet, onSheetGraded);
+	}
+
+	return status;
+}
+
+int BatchGrader::gradeArchive(const TiffPageReader& archive, const SheetCallback& onSheetGraded) const {
+	const size_t sidesPerSheet = sheetGrader_.sidesPerSheet();
+	if(sidesPerSheet == 0) {
+		TLOG_CRITICAL(tlog, tlOss, "Unable to grade \"" << archive.getFilename() << "\", the sheet layout does not have any sides");
+		return -1;
+	}
+
+	if(archive.numPages() % sidesPerSheet != 0) {
+		TLOG_WARNING(tlog, tlOss, "\"" << archive.getFilename() << "\" has " << archive.numPages() << " pages, which is not a multiple of the " << sidesPerSheet << " sides per sheet. The trailing pages will be ignored.");
+	}
+
+	//Each page is only decoded once the decode stage gets to it, so the archive is never held in memory as a whole
+	auto loadSide = [this, &archive, sidesPerSheet](size_t sheetIndex, size_t sideNumber, SheetScan& scan) {
+		return sheetGrader_.loadSide(scan, archive, sheetIndex * sidesPerSheet + sideNumber, sideNumber);
+	};
+	auto nameSheet = [&archive, sidesPerSheet](size_t sheetIndex) {
+		return "on page " + std::to_string(sheetIndex * sidesPerSheet) + " of \"" + archive.getFilename() + "\"";
+	};
+
+	return gradeSides(archive.numPages() / sidesPerSheet, loadSide, nameSheet, onSheetGraded);
+}
+
+int BatchGrader::gradeSides(size_t numSheets, const SideLoader& loadSide, const SheetNamer& nameSheet, const SheetCallback& onSheetGraded) const {
+	int status = 0;
+
+	const size_t sidesPerSheet = sheetGrader_.sidesPerSheet();
+	if(numSheets == 0) {
+		return status;
+	}
+
+	//Decoding is mostly waiting on the disk, so it gets a quarter of the threads and the CPU heavy stages split the rest. Every stage needs at
+	//least one thread even if that means using more threads than were asked for
+	const size_t numDecodeThreads = std::max<size_t>(1, numThreads_ / 4);
+	const size_t numAlignThreads = std::max<size_t>(1, (numThreads_ - std::min(numThreads_, numDecodeThreads)) / 2);
+	const size_t numDetectThreads = std::max<size_t>(1, numThreads_ - std::min(numThreads_, numDecodeThreads + numAlignThreads));
+
+	TLOG_INFO(tlog, tlOss, "Grading " << numSheets << " sheets with " << numDecodeThreads << " decode, " << numAlignThreads << " align and " << numDetectThreads << " detect threads");
+
+	//Every sheet already runs on its own thread, so OpenCV's internal parallelism would only oversubscribe the cores
+	const int openCvThreads = cv::getNumThreads();
+	cv::setNumThreads(1);
+
+	SideJobQueue alignQueue(queueCapacity_);
+	SideJobQueue detectQueue(queueCapacity_);
+	SideJobQueue resultQueue(queueCapacity_);
+
+	std::vector<std::thread> threads;
+	std::atomic<size_t> nextSide{0};
+	const size_t totalSides = numSheets * sidesPerSheet;
+
+	startStage(threads, numDecodeThreads, alignQueue, [&] {
+		for(size_t i = nextSide++; i < totalSides; i = nextSide++) {
+			std::unique_ptr<SideJob> job = std::make_unique<SideJob>();
+			job->sheetIndex = i / sidesPerSheet;
+			job->sideNumber = i % sidesPerSheet;
+			job->scan.setAnnotationsEnabled(false);
+			job->status = loadSide(job->sheetIndex, job->sideNumber, job->scan);
+			if(!alignQueue.push(std::move(job))) {
+				break;
+			}
+		}
+	});
+
+	startStage(threads, numAlignThreads, detectQueue, [&] {
+		std::unique_ptr<SideJob> job;
+		while(alignQueue.pop(job)) {
+			if(job->status >= 0) {
+				job->status = sheetGrader_.alignSide(job->scan, job->sideNumber);
+			}
+			if(!detectQueue.push(std::move(job))) {
+				break;
+			}
+		}
+	});
+
+	startStage(threads, numDetectThreads, resultQueue, [&] {
+		std::unique_ptr<SideJob> job;
+		while(detectQueue.pop(job)) {
+			if(job->status >= 0) {
+				job->status = sheetGrader_.readSide(job->scan, job->sideNumber, job->responses);
+			}
+
+			//The image is no longer needed, so free it before the job waits in the result queue
+			job->scan.clear();
+			if(!resultQueue.push(std::move(job))) {
+				break;
+			}
+		}
+	});
+
+	//Collect the results on this thread, holding on to sheets that finish out of order until every sheet before them has been reported
+	std::map<size_t, PendingSheet> pendingSheets;
+	size_t nextSheet = 0;
+	std::unique_ptr<SideJob> job;
+	while(resultQueue.pop(job)) {
+		PendingSheet& pending = pendingSheets[job->sheetIndex];
+		pending.sideResponses.resize(sidesPerSheet);
+		pending.sideResponses[job->sideNumber] = std::move(job->responses);
+		pending.sidesDone++;
+		if(job->status < 0) {
+			pending.status = -1;
+			TLOG_WARNING(tlog, tlOss, "Failed to grade side " << job->sideNumber << " of sheet " << nameSheet(job->sheetIndex));
+		}
+
+		for(auto iter = pendingSheets.find(nextSheet); iter != pendingSheets.end() && iter->second.sidesDone == sidesPerSheet; iter = pendingSheets.find(nextSheet)) {
+			std::vector<QuestionResponse> responses;
+			for(auto& sideResponses : iter->second.sideResponses) {
+				responses.insert(responses.end(), std::make_move_iterator(sideResponses.begin()), std::make_move_iterator(sideResponses.end()));
+			}
+
+			if(iter->second.status < 0) {
+				status = -1;
+			}
+			onSheetGraded(nextSheet, iter->second.status, responses);
+
+			pendingSheets.erase(iter);
+			nextSheet++;
+		}
+	}
+
+	for(auto& thread : threads) {
+		thread.join();
+	}
+
+	cv::setNumThreads(openCvThreads);
+
+	return status;
+}
+
+size_t BatchGrader::getNumThreads() const {
+	return numThreads_;
+}
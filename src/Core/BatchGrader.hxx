@@ -0,0 +1,88 @@
+#pragma once
+
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "SheetGrader.hxx"
+#include "TiffPageReader.hxx"
+
+///
+/// <summary> Grades a large number of sheets at once by running the decode, align and detect stages of grading on a pool of worker threads.
+///           The stages are connected by bounded queues, so only a fixed number of scans are held in memory at any time regardless of how
+///           many sheets are being graded. </summary>
+///
+class BatchGrader {
+public:
+	///
+	/// <summary> Called once for every graded sheet, in the same order as the sheets were given to BatchGrader::gradeSheets(). </summary>
+	///
+	/// <param name="sheetIndex"> The index of the sheet in the list passed to BatchGrader::gradeSheets() </param>
+	/// <param name="status"> Integer status code. Negative if an error occured while grading the sheet, non-negative if no error occured. </param>
+	/// <param name="responses"> The responses to every question on the sheet. Incomplete if status is negative. </param>
+	///
+	using SheetCallback = std::function<void(size_t sheetIndex, int status, const std::vector<QuestionResponse>& responses)>;
+
+	///
+	/// <summary> Create a batch grader </summary>
+	///
+	/// <param name="sheetGrader"> The sheet grader used to align and read each side. Must outlive this batch grader. </param>
+	/// <param name="numThreads"> The total number of worker threads to use. If zero, one thread per core is used. </param>
+	/// <param name="queueCapacity"> How many scans may wait between two stages at once. If zero, twice the number of threads is used. </param>
+	///
+	BatchGrader(const SheetGrader& sheetGrader, size_t numThreads = 0, size_t queueCapacity = 0);
+	~BatchGrader();
+
+	///
+	/// <summary> Grade a list of sheets. Blocks until every sheet has been graded. </summary>
+	///
+	/// <param name="sheets"> The filenames of the scanned images of each sheet, one per side, in side order </param>
+	/// <param name="onSheetGraded"> Called on the calling thread as each sheet finishes grading, in sheet order </param>
+	///
+	/// <returns> Integer status code. Negative if any sheet could not be graded, non-negative if every sheet was graded successfully. </returns>
+	///
+	int gradeSheets(const std::vector<std::vector<std::string>>& sheets, const SheetCallback& onSheetGraded) const;
+
+	///
+	/// <summary> Grade every sheet in a multi-page TIFF archive, in which consecutive pages are the sides of one sheet. Pages are decoded one at
+	///           a time as the pipeline has room for them, so only a few pages are held in memory regardless of the size of the archive. Blocks
+	///           until every sheet has been graded. </summary>
+	///
+	/// <param name="archive"> The opened archive. If the number of pages is not a multiple of the number of sides per sheet, the trailing
+	///                        pages are ignored. </param>
+	/// <param name="onSheetGraded"> Called on the calling thread as each sheet finishes grading, in sheet order. The sheet index is the index
+	///                              of the sheet's first page divided by the number of sides per sheet. </param>
+	///
+	/// <returns> Integer status code. Negative if any sheet could not be graded, non-negative if every sheet was graded successfully. </returns>
+	///
+	int gradeArchive(const TiffPageReader& archive, const SheetCallback& onSheetGraded) const;
+
+	size_t getNumThreads() const;
+
+private:
+	///
+	/// <summary> Loads one side of one sheet into a scan, returning an integer status code </summary>
+	///
+	using SideLoader = std::function<int(size_t sheetIndex, size_t sideNumber, SheetScan& scan)>;
+
+	///
+	/// <summary> Gets a name for a sheet to use in log messages </summary>
+	///
+	using SheetNamer = std::function<std::string(size_t sheetIndex)>;
+
+	///
+	/// <summary> Run every side of every sheet through the decode, align and detect stages </summary>
+	///
+	/// <param name="numSheets"> The number of sheets to grade </param>
+	/// <param name="loadSide"> Called by the decode stage to load each side. Called from several threads at once. </param>
+	/// <param name="nameSheet"> Called on the calling thread to name sheets that fail to grade </param>
+	/// <param name="onSheetGraded"> Called on the calling thread as each sheet finishes grading, in sheet order </param>
+	///
+	/// <returns> Integer status code. Negative if any sheet could not be graded, non-negative if every sheet was graded successfully. </returns>
+	///
+	int gradeSides(size_t numSheets, const SideLoader& loadSide, const SheetNamer& nameSheet, const SheetCallback& onSheetGraded) const;
+
+	const SheetGrader& sheetGrader_;
+	size_t numThreads_;
+	size_t queueCapacity_;
+};
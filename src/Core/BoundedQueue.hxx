@@ -0,0 +1,84 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+
+///
+/// <summary> A thread safe first-in-first-out queue with a fixed capacity. Producers block while the queue is full and consumers block while the
+///           queue is empty, so a chain of these queues between processing stages keeps the amount of work in flight (and the memory it uses)
+///           constant no matter how much work there is in total. </summary>
+///
+template<typename T>
+class BoundedQueue {
+public:
+	///
+	/// <summary> Create an empty queue </summary>
+	///
+	/// <param name="capacity"> The maximum number of items the queue can hold at once. Must be at least 1. </param>
+	///
+	explicit BoundedQueue(size_t capacity) : capacity_(capacity > 0 ? capacity : 1) {}
+
+	BoundedQueue(const BoundedQueue&) = delete;
+	BoundedQueue& operator=(const BoundedQueue&) = delete;
+
+	///
+	/// <summary> Add an item to the back of the queue, waiting for space to become available if the queue is full. </summary>
+	///
+	/// <param name="item"> The item to add </param>
+	///
+	/// <returns> True if the item was added, false if the queue was closed before the item could be added. </returns>
+	///
+	bool push(T item) {
+		std::unique_lock<std::mutex> lock(mutex_);
+		notFull_.wait(lock, [this] { return closed_ || items_.size() < capacity_; });
+		if(closed_) {
+			return false;
+		}
+		items_.push_back(std::move(item));
+		lock.unlock();
+		notEmpty_.notify_one();
+		return true;
+	}
+
+	///
+	/// <summary> Remove an item from the front of the queue, waiting for one to become available if the queue is empty. </summary>
+	///
+	/// <param name="item"> Output parameter in which the removed item will be placed </param>
+	///
+	/// <returns> True if an item was removed, false if the queue has been closed and every item in it has already been removed. </returns>
+	///
+	bool pop(T& item) {
+		std::unique_lock<std::mutex> lock(mutex_);
+		notEmpty_.wait(lock, [this] { return closed_ || !items_.empty(); });
+		if(items_.empty()) {
+			return false;
+		}
+		item = std::move(items_.front());
+		items_.pop_front();
+		lock.unlock();
+		notFull_.notify_one();
+		return true;
+	}
+
+	///
+	/// <summary> Mark that no more items will be added to the queue. Items already in the queue can still be removed, after which pop() returns
+	///           false instead of waiting. Any producer waiting for space is released and its item is discarded. </summary>
+	///
+	void close() {
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			closed_ = true;
+		}
+		notEmpty_.notify_all();
+		notFull_.notify_all();
+	}
+
+private:
+	const size_t capacity_;
+	std::deque<T> items_{};
+	bool closed_{false};
+	std::mutex mutex_{};
+	std::condition_variable notEmpty_{};
+	std::condition_variable notFull_{};
+};
@@ -1,4 +1,5 @@
 
+#include <cstdlib>
 #include <sstream>
 #include "pugixml.hpp"
 
@@ -6,8 +7,8 @@
 #include "DetectionParams.hxx"
 
 namespace {
-	std::ostringstream tlOss;
-	TextLogging tlog;
+	thread_local std::ostringstream tlOss;
+	thread_local TextLogging tlog;
 }
 
 
@@ -36,8 +37,7 @@ float DetectionParams::getAsFloat(const std::string& paramName) const {
 	if(isFloat(paramName)) {
 		floatValue = std::stof(getAsStr(paramName));
 	} else {
-		tlOss << "Failed to retrieve parameter \"" << paramName << "\" as a float.";
-		tlog.warning(__FILE__, __LINE__, tlOss);
+		TLOG_WARNING(tlog, tlOss, "Failed to retrieve parameter \"" << paramName << "\" as a float.");
 	}
 
 	return floatValue;
@@ -51,8 +51,7 @@ int DetectionParams::getAsInt(const std::string& paramName) const {
 	if(isInt(paramName)) {
 		intValue = std::stoi(getAsStr(paramName));
 	} else {
-		tlOss << "Failed to retrieve parameter \"" << paramName << "\" as an int.";
-		tlog.warning(__FILE__, __LINE__, tlOss);
+		TLOG_WARNING(tlog, tlOss, "Failed to retrieve parameter \"" << paramName << "\" as an int.");
 	}
 
 	return intValue;
@@ -63,8 +62,7 @@ std::string DetectionParams::getAsStr(const std::string& paramName) const {
 	std::string value{};
 	//Check that the parameter table contains an entry for paramName
 	if(iterator == paramTable_.end()) {
-		tlOss << "Attempted to retrieve nonexistant parameter \"" << paramName << "\" on filter config \"" << name_ << "\"";
-		tlog.warning(__FILE__, __LINE__, tlOss);
+		TLOG_WARNING(tlog, tlOss, "Attempted to retrieve nonexistant parameter \"" << paramName << "\" on filter config \"" << name_ << "\"");
 	} else {
 		value = iterator->second;
 	}
@@ -80,9 +78,9 @@ void DetectionParams::set(const std::string& paramName, int value) {
 }
 
 void DetectionParams::set(const std::string& paramName, const std::string& value) {
-	tlOss << "Set parameter \"" << paramName << "\" to \"" << value << "\"";
-	tlog.debug(__FILE__, __LINE__, tlOss);
+	TLOG_DEBUG(tlog, tlOss, "Set parameter \"" << paramName << "\" to \"" << value << "\"");
 	paramTable_[paramName] = value;
+	isCompiled_ = false;
 }
 
 
@@ -99,12 +97,10 @@ int DetectionParams::load(const std::string& filename, const std::string& filter
 	pugi::xml_document doc;
 	pugi::xml_parse_result result = doc.load_file(filename.c_str());
 	if(result) {
-		tlOss << "Successfully parsed XML file \"" << filename << "\"";
-		tlog.debug(__FILE__, __LINE__, tlOss);
+		TLOG_DEBUG(tlog, tlOss, "Successfully parsed XML file \"" << filename << "\"");
 	} else {
 		status = -1;
-		tlOss << "Failed to parse XML file \"" << filename << "\". PugiXML error message: " << result.description();
-		tlog.critical(__FILE__, __LINE__, tlOss);
+		TLOG_CRITICAL(tlog, tlOss, "Failed to parse XML file \"" << filename << "\". PugiXML error message: " << result.description());
 	}
 
 	//Check that the XML file is formatted correctly.
@@ -113,8 +109,7 @@ int DetectionParams::load(const std::string& filename, const std::string& filter
 		filterParamsNode = doc.first_child();
 		if(std::string(filterParamsNode.name()) != "filter-params") {
 			status = -1;
-			tlOss << "Failed to filter parameters. \"" << filename << "\" does not appear to be a filter configuration file. Root node type: \"" << filterParamsNode.name() << "\"";
-			tlog.critical(__FILE__, __LINE__, tlOss);
+			TLOG_CRITICAL(tlog, tlOss, "Failed to filter parameters. \"" << filename << "\" does not appear to be a filter configuration file. Root node type: \"" << filterParamsNode.name() << "\"");
 		}
 	}
 
@@ -124,16 +119,14 @@ int DetectionParams::load(const std::string& filename, const std::string& filter
 		//Get name attribute of current filter
 		pugi::xml_attribute nameAttr = filterNode.attribute("name");
 		if(!nameAttr) {
-			tlOss << "Encountered a filter with no name attribute while parsing filter configuration file \"" << filename << "\"";
-			tlog.warning(__FILE__, __LINE__, tlOss);
+			TLOG_WARNING(tlog, tlOss, "Encountered a filter with no name attribute while parsing filter configuration file \"" << filename << "\"");
 			continue;
 		}
 
 		//Break out of the loop if the name of the current filter is the same as the one requesteed
 		if(nameAttr.value() == filterName) {
 			name_ = nameAttr.value();
-			tlOss << "Found filter \"" << filterName << "\"";
-			tlog.debug(__FILE__, __LINE__, tlOss);
+			TLOG_DEBUG(tlog, tlOss, "Found filter \"" << filterName << "\"");
 			break;
 		}
 	}
@@ -141,8 +134,7 @@ int DetectionParams::load(const std::string& filename, const std::string& filter
 	//Check that requested filter was in fact found. If not, then it is not present in the filter configuration file and the loop exited naturally having not found it.
 	if(status >= 0 && !filterNode) {
 		status = 1;
-		tlOss << "Unable to find filter \"" << filterName << "\" in filter configuration file \"" << filename << "\"";
-		tlog.critical(__FILE__, __LINE__, tlOss);
+		TLOG_CRITICAL(tlog, tlOss, "Unable to find filter \"" << filterName << "\" in filter configuration file \"" << filename << "\"");
 	}
 
 	//Get the filter type
@@ -150,8 +142,7 @@ int DetectionParams::load(const std::string& filename, const std::string& filter
 		pugi::xml_attribute typeAttr = filterNode.attribute("type");
 		if(!typeAttr) {
 			status = -1;
-			tlOss << "Requested filter " << filterName << " does not have a type attribute \"" << filename << "\"";
-			tlog.critical(__FILE__, __LINE__, tlOss);
+			TLOG_CRITICAL(tlog, tlOss, "Requested filter " << filterName << " does not have a type attribute \"" << filename << "\"");
 		}
 		//Note that it is okay to call typeAttr.value() even if typeAttr is null; it will just return an empty string
 		filterType_ = parseFilterType(typeAttr.value());
@@ -163,8 +154,7 @@ int DetectionParams::load(const std::string& filename, const std::string& filter
 			//Get the name of the current parameter
 			std::string paramName = paramNode.name();
 			if(paramTable_.find(paramName) != paramTable_.end()) {
-				tlOss << "Overwriting existing parameter \"" << paramName << "\" on filter configuration \"" << filterName << "\"";
-				tlog.warning(__FILE__, __LINE__, tlOss);
+				TLOG_WARNING(tlog, tlOss, "Overwriting existing parameter \"" << paramName << "\" on filter configuration \"" << filterName << "\"");
 			}
 
 			//Get the value of the current parameter
@@ -175,10 +165,224 @@ int DetectionParams::load(const std::string& filename, const std::string& filter
 		}
 	}
 
+	//Validate the parameters once here rather than every time a sheet is scanned
+	if(status == 0 && compile() < 0) {
+		status = -1;
+		TLOG_CRITICAL(tlog, tlOss, "Filter \"" << filterName << "\" in configuration file \"" << filename << "\" has missing or invalid parameters");
+	}
+
 	if(status == 0) {
-		tlOss << "Successfully loaded parameter list for filter \"" << filterName << "\" from configuration file \"" << filename << "\"";
-		tlog.info(__FILE__, __LINE__, tlOss);
+		TLOG_INFO(tlog, tlOss, "Successfully loaded parameter list for filter \"" << filterName << "\" from configuration file \"" << filename << "\"");
+	}
+	return status;
+}
+
+int DetectionParams::compile() {
+	int status = 0;
+
+	threshParams_ = ThreshParams();
+	threshFracParams_ = ThreshFracParams();
+	contourAlignParams_ = ContourAlignParams();
+	homographyAlignParams_ = HomographyAlignParams();
+	houghCircleParams_ = HoughCircleParams();
+
+	switch(filterType_) {
+	case FilterType::THRESH_FRAC:
+		status = compileThreshParams();
+		if(compileThreshFracParams() < 0) {
+			status = -1;
+		}
+		break;
+	case FilterType::THRESH_CONTOUR:
+		status = compileThreshParams();
+		if(compileContourAlignParams() < 0) {
+			status = -1;
+		}
+		break;
+	case FilterType::THRESH_HOMOGRAPHY:
+		status = compileThreshParams();
+		if(compileHomographyAlignParams() < 0) {
+			status = -1;
+		}
+		break;
+	case FilterType::THRESH_HCIRCLES:
+		status = compileThreshParams();
+		if(compileHoughCircleParams() < 0) {
+			status = -1;
+		}
+		break;
+	default:
+		status = -1;
+		TLOG_CRITICAL(tlog, tlOss, "Unable to compile parameters of \"" << name_ << "\", encountered unhandled filter type: " << filterType_);
+	}
+
+	isCompiled_ = status >= 0;
+
+	return status;
+}
+
+int DetectionParams::compileFloat(const std::string& paramName, const std::string& description, bool isNonNegative, float& value) const {
+	int status = 0;
+
+	//Parse the value with strtof rather than std::stof so that a malformed value (e.g. "1-2") is reported instead of throwing
+	auto iterator = paramTable_.find(paramName);
+	char* end = nullptr;
+	if(iterator != paramTable_.end() && isFloat(paramName)) {
+		value = std::strtof(iterator->second.c_str(), &end);
+	}
+
+	if(end == nullptr || end == iterator->second.c_str() || std::string(end).find_first_not_of(" ") != std::string::npos) {
+		status = -1;
+		TLOG_CRITICAL(tlog, tlOss, description << " (" << paramName << ") property on \"" << name_ << "\" configuration must exist and be a number");
+	} else if(isNonNegative && value < 0) {
+		status = -1;
+		TLOG_CRITICAL(tlog, tlOss, description << " (" << paramName << ") property on \"" << name_ << "\" must be a non-negative number.");
+	} else {
+		TLOG_DEBUG(tlog, tlOss, description << " set to " << value);
+	}
+
+	return status;
+}
+
+int DetectionParams::compileThreshParams() {
+	int status = 0;
+
+	//The channel is optional. If it is not specified the image is converted to grayscale instead. Whether the channel exists can only be
+	//checked once there is an image to threshold.
+	if(hasParam("channel")) {
+		if(isInt("channel")) {
+			threshParams_.channel = std::atoi(getAsStr("channel").c_str());
+		}
+		if(!isInt("channel") || threshParams_.channel < 0) {
+			status = -1;
+			TLOG_CRITICAL(tlog, tlOss, "Channel property on \"" << name_ << "\" configuration must be a non-negative integer");
+		}
+	}
+
+	//The blur is optional as well
+	if(hasParam("preblur") && compileFloat("preblur", "Preblur", true, threshParams_.preblur) < 0) {
+		status = -1;
+	}
+
+	if(compileFloat("threshold", "Threshold", true, threshParams_.threshold) < 0) {
+		status = -1;
+	}
+
+	threshParams_.invert = hasParam("invert");
+
+	//Decoding the scan at a reduced resolution is optional. Only the reductions that the image decoders support are allowed.
+	if(hasParam("decode-reduction")) {
+		if(isInt("decode-reduction")) {
+			threshParams_.decodeReduction = std::atoi(getAsStr("decode-reduction").c_str());
+		}
+		const int reduction = threshParams_.decodeReduction;
+		if(!isInt("decode-reduction") || (reduction != 1 && reduction != 2 && reduction != 4 && reduction != 8)) {
+			status = -1;
+			TLOG_CRITICAL(tlog, tlOss, "Decode reduction property on \"" << name_ << "\" configuration must be 1, 2, 4 or 8");
+		}
+	}
+
+	return status;
+}
+
+int DetectionParams::compileThreshFracParams() {
+	int status = 0;
+
+	if(compileFloat("fraction", "Fraction", true, threshFracParams_.fraction) < 0) {
+		status = -1;
+	} else if(threshFracParams_.fraction > 1) {
+		status = -1;
+		TLOG_CRITICAL(tlog, tlOss, "Fraction property on \"" << name_ << "\" must be between 0 and 1.");
+	}
+
+	threshFracParams_.useIntegral = hasParam("integral");
+	threshFracParams_.measureEllipse = hasParam("elliptical");
+
+	//Thresholding only the regions around the question groups is optional
+	if(hasParam("roi-padding") && compileFloat("roi-padding", "Region of interest padding", true, threshFracParams_.roiPadding) < 0) {
+		status = -1;
+	}
+
+	return status;
+}
+
+int DetectionParams::compileMarkParams(MarkParams& params) const {
+	int status = 0;
+
+	//Compile every parameter even after an error so that every problem with the configuration is reported at once
+	const std::vector<int> statuses = {
+		compileFloat("alignment-approx-tollerance", "Poligon approximation tollerance", true, params.approxTollerance),
+		compileFloat("alignment-min-width", "Minimum rectangle width", true, params.minWidth),
+		compileFloat("alignment-max-width", "Maximum rectangle width", true, params.maxWidth),
+		compileFloat("alignment-min-height", "Minimum rectangle height", true, params.minHeight),
+		compileFloat("alignment-max-height", "Maximum rectangle height", true, params.maxHeight),
+		compileFloat("alignment-min-filled", "Minimum fraction filled in", true, params.minFilled)
+	};
+
+	for(int paramStatus : statuses) {
+		if(paramStatus < 0) {
+			status = -1;
+		}
+	}
+
+	return status;
+}
+
+int DetectionParams::compileContourAlignParams() {
+	int status = compileMarkParams(contourAlignParams_.marks);
+
+	contourAlignParams_.transformOnly = hasParam("transform-only");
+
+	const std::vector<int> statuses = {
+		compileFloat("crop-offset-fraction-top", "Top crop offset", false, contourAlignParams_.cropOffsetTop),
+		compileFloat("crop-offset-fraction-bottom", "Bottom crop offset", false, contourAlignParams_.cropOffsetBottom),
+		compileFloat("crop-offset-fraction-left", "Left crop offset", false, contourAlignParams_.cropOffsetLeft),
+		compileFloat("crop-offset-fraction-right", "Right crop offset", false, contourAlignParams_.cropOffsetRight)
+	};
+
+	for(int paramStatus : statuses) {
+		if(paramStatus < 0) {
+			status = -1;
+		}
+	}
+
+	return status;
+}
+
+int DetectionParams::compileHomographyAlignParams() {
+	int status = compileMarkParams(homographyAlignParams_.marks);
+
+	const std::vector<int> statuses = {
+		compileFloat("homography-match-distance", "Mark matching distance", true, homographyAlignParams_.matchDistance),
+		compileFloat("homography-reprojection-threshold", "Reprojection error threshold", true, homographyAlignParams_.reprojectionThreshold)
+	};
+
+	for(int paramStatus : statuses) {
+		if(paramStatus < 0) {
+			status = -1;
+		}
+	}
+
+	return status;
+}
+
+int DetectionParams::compileHoughCircleParams() {
+	int status = 0;
+
+	const std::vector<int> statuses = {
+		compileFloat("circle-edge-detection-thresh", "Edge detection threshold", true, houghCircleParams_.edgeThreshold),
+		compileFloat("circle-accumulator-thresh", "Circle accumulator threshold", true, houghCircleParams_.accumulatorThreshold),
+		compileFloat("circle-min-distance", "Minimum circle distance", true, houghCircleParams_.minDistance),
+		compileFloat("circle-min-radius", "Minimum circle radius", true, houghCircleParams_.minRadius),
+		compileFloat("circle-max-radius", "Maximum circle radius", true, houghCircleParams_.maxRadius)
+	};
+
+	for(int paramStatus : statuses) {
+		if(paramStatus < 0) {
+			status = -1;
+		}
 	}
+
 	return status;
 }
 
@@ -186,6 +390,7 @@ void DetectionParams::reset() {
 	name_ = "";
 	filterType_ = FilterType::UNKNOWN;
 	paramTable_.clear();
+	isCompiled_ = false;
 }
 
 int DetectionParams::getFilterList(const std::string& filename, std::vector<std::string>& filters) {
@@ -197,12 +402,10 @@ int DetectionParams::getFilterList(const std::string& filename, std::vector<std:
 	pugi::xml_document doc;
 	pugi::xml_parse_result result = doc.load_file(filename.c_str());
 	if(result) {
-		tlOss << "Successfully parsed XML file \"" << filename << "\"";
-		tlog.debug(__FILE__, __LINE__, tlOss);
+		TLOG_DEBUG(tlog, tlOss, "Successfully parsed XML file \"" << filename << "\"");
 	} else {
 		status = -1;
-		tlOss << "Failed to parse XML file \"" << filename << "\". PugiXML error message: " << result.description();
-		tlog.critical(__FILE__, __LINE__, tlOss);
+		TLOG_CRITICAL(tlog, tlOss, "Failed to parse XML file \"" << filename << "\". PugiXML error message: " << result.description());
 	}
 
 	//Check that the XML file is formatted correctly.
@@ -211,8 +414,7 @@ int DetectionParams::getFilterList(const std::string& filename, std::vector<std:
 		filterParamsNode = doc.first_child();
 		if(std::string(filterParamsNode.name()) != "filter-params") {
 			status = -1;
-			tlOss << "Failed to filter parameters. \"" << filename << "\" does not appear to be a filter configuration file. Root node type: \"" << filterParamsNode.name() << "\"";
-			tlog.critical(__FILE__, __LINE__, tlOss);
+			TLOG_CRITICAL(tlog, tlOss, "Failed to filter parameters. \"" << filename << "\" does not appear to be a filter configuration file. Root node type: \"" << filterParamsNode.name() << "\"");
 		}
 	}
 
@@ -222,8 +424,7 @@ int DetectionParams::getFilterList(const std::string& filename, std::vector<std:
 		//Get name attribute of current filter
 		pugi::xml_attribute nameAttr = filterNode.attribute("name");
 		if(!nameAttr) {
-			tlOss << "Encountered a filter with no name attribute while parsing filter configuration file \"" << filename << "\"";
-			tlog.warning(__FILE__, __LINE__, tlOss);
+			TLOG_WARNING(tlog, tlOss, "Encountered a filter with no name attribute while parsing filter configuration file \"" << filename << "\"");
 			continue;
 		}
 		filters.push_back(nameAttr.value());
@@ -240,6 +441,30 @@ FilterType DetectionParams::getFilterType() const {
 	return filterType_;
 }
 
+bool DetectionParams::isCompiled() const {
+	return isCompiled_;
+}
+
+const ThreshParams& DetectionParams::getThreshParams() const {
+	return threshParams_;
+}
+
+const ThreshFracParams& DetectionParams::getThreshFracParams() const {
+	return threshFracParams_;
+}
+
+const ContourAlignParams& DetectionParams::getContourAlignParams() const {
+	return contourAlignParams_;
+}
+
+const HomographyAlignParams& DetectionParams::getHomographyAlignParams() const {
+	return homographyAlignParams_;
+}
+
+const HoughCircleParams& DetectionParams::getHoughCircleParams() const {
+	return houghCircleParams_;
+}
+
 std::string toString(const FilterType& filterType) {
 	std::ostringstream oss;
 	oss << filterType;
@@ -253,11 +478,12 @@ FilterType parseFilterType(const std::string& str) {
 		return FilterType::THRESH_CONTOUR;
 	} else if(str == toString(FilterType::THRESH_HCIRCLES)) {
 		return FilterType::THRESH_HCIRCLES;
+	} else if(str == toString(FilterType::THRESH_HOMOGRAPHY)) {
+		return FilterType::THRESH_HOMOGRAPHY;
 	} else if(str == toString(FilterType::UNKNOWN)) {
 		return FilterType::UNKNOWN;
 	} else {
-		tlOss << "Encountered unhandled filter type.";
-		tlog.warning(__FILE__, __LINE__, tlOss);
+		TLOG_WARNING(tlog, tlOss, "Encountered unhandled filter type.");
 		return FilterType::UNKNOWN;
 	}
 }
@@ -276,10 +502,12 @@ std::ostream& operator<<(std::ostream& os, const FilterType& filterType) {
 	case FilterType::THRESH_HCIRCLES:
 		os << "THRESH_HCIRCLES";
 		break;
+	case FilterType::THRESH_HOMOGRAPHY:
+		os << "THRESH_HOMOGRAPHY";
+		break;
 	default:
 		os << "UNKNOWN";
-		tlOss << "Encountered unhandled filter type.";
-		tlog.warning(__FILE__, __LINE__, tlOss);
+		TLOG_WARNING(tlog, tlOss, "Encountered unhandled filter type.");
 	}
 	return os;
 }
@@ -8,13 +8,99 @@ enum class FilterType {
 	UNKNOWN,
 	THRESH_FRAC,
 	THRESH_CONTOUR,
-	THRESH_HCIRCLES
+	THRESH_HCIRCLES,
+	THRESH_HOMOGRAPHY
 };
 
 std::string toString(const FilterType& filterType);
 FilterType parseFilterType(const std::string& str);
 std::ostream& operator<<(std::ostream& os, const FilterType& filterType);
 
+///
+/// <summary> Parameters for the threshold step, which every algorithm uses as its initialization step </summary>
+///
+struct ThreshParams {
+	//Which channel of the image to threshold. Negative if the image should be converted to grayscale instead.
+	int channel{-1};
+	//Size of the blur applied before thresholding, in pixels of the full resolution scan. Zero if the image should not be blurred.
+	float preblur{0};
+	//How far below the mean of its neighborhood a pixel has to be to be considered dark
+	float threshold{0};
+	bool invert{false};
+	//How many times smaller the scan may be decoded for this algorithm (1, 2, 4 or 8). The preblur and the threshold's neighborhood are
+	//scaled down to match, so they don't need recalibrating when this is changed.
+	int decodeReduction{1};
+};
+
+///
+/// <summary> Parameters for the THRESH_FRAC bubble detection algorithm </summary>
+///
+struct ThreshFracParams {
+	//The fraction of a bubble's pixels that have to be filled in for the bubble to count as filled in
+	float fraction{0};
+	//Whether to build a summed-area table of the thresholded image when the algorithm is set up. Checking a bubble then takes a constant
+	//number of lookups rather than a count over every pixel of the bubble, at the cost of an extra pass over the image during setup.
+	bool useIntegral{false};
+	//Whether to measure only the ellipse inscribed in each bubble's bounding box rather than the whole box. This keeps the printed outline
+	//in the box's corners from counting towards the filled fraction, but calls for recalibrating the fraction.
+	bool measureEllipse{false};
+	//How far past each question group's bounding box to threshold, in normalized coordinates, when only the regions around the question groups
+	//are thresholded. Negative if the whole image should be thresholded.
+	float roiPadding{-1};
+};
+
+///
+/// <summary> Parameters describing what the alignment marks look like, shared by the alignment algorithms that search for them. All lengths are
+///           normalized coordinates (see SheetScan::normalized()). </summary>
+///
+struct MarkParams {
+	//Tollerance used when approximating contours as polygons, as a fraction of the contour's perimeter
+	float approxTollerance{0};
+	float minWidth{0};
+	float maxWidth{0};
+	float minHeight{0};
+	float maxHeight{0};
+	//The minimum fraction of an alignment mark that has to be filled in
+	float minFilled{0};
+};
+
+///
+/// <summary> Parameters for the THRESH_CONTOUR alignment algorithm. All lengths are normalized coordinates (see SheetScan::normalized()). </summary>
+///
+struct ContourAlignParams {
+	MarkParams marks{};
+	//How far each edge of the cropped scan is from the first alignment mark, as a fraction of the distance between the first and last mark
+	float cropOffsetTop{0};
+	float cropOffsetBottom{0};
+	float cropOffsetLeft{0};
+	float cropOffsetRight{0};
+	//Whether to only record the transform from the aligned image to the scan rather than rotating and cropping the scan. Bubbles are then found
+	//by mapping their positions through the transform, which saves resampling the whole image.
+	bool transformOnly{false};
+};
+
+///
+/// <summary> Parameters for the THRESH_HOMOGRAPHY alignment algorithm. All lengths are normalized coordinates (see SheetScan::normalized()). </summary>
+///
+struct HomographyAlignParams {
+	MarkParams marks{};
+	//How far a detected mark may be from where a rough alignment predicts a layout's mark to be for the two to be paired up
+	float matchDistance{0};
+	//How far a mark may be from where the fitted transform puts it before it is treated as an outlier
+	float reprojectionThreshold{0};
+};
+
+///
+/// <summary> Parameters for the THRESH_HCIRCLES circle finding algorithm. Distances and radii are normalized coordinates. </summary>
+///
+struct HoughCircleParams {
+	float edgeThreshold{0};
+	float accumulatorThreshold{0};
+	float minDistance{0};
+	float minRadius{0};
+	float maxRadius{0};
+};
+
 class DetectionParams {
 public:
 	DetectionParams();
@@ -86,6 +172,10 @@ public:
 	///
 	std::string getAsStr(const std::string& paramName) const;
 
+	///
+	/// <summary> Set the value of a parameter. DetectionParams::compile() must be called afterwards for the change to affect the typed parameters
+	///           that the detection algorithms use. </summary>
+	///
 	void set(const std::string& paramName, float value);
 	void set(const std::string& paramName, int value);
 	void set(const std::string& paramName, const std::string& value);
@@ -106,6 +196,25 @@ public:
 	///
 	int load(const std::string& filename, const std::string& filterName);
 
+	///
+	/// <summary> Validate the parameters needed by this configuration's filter type and convert them into the typed parameter structs. Called by
+	///           DetectionParams::load(), so that the detection algorithms never have to parse strings while scanning sheets. </summary>
+	///
+	/// <returns> Integer status code. Negative if a parameter is missing or invalid, non-negative if no error occured. </returns>
+	///
+	int compile();
+
+	///
+	/// <summary> Check whether the typed parameters are up to date, i.e. DetectionParams::compile() has succeeded since the last change </summary>
+	///
+	bool isCompiled() const;
+
+	const ThreshParams& getThreshParams() const;
+	const ThreshFracParams& getThreshFracParams() const;
+	const ContourAlignParams& getContourAlignParams() const;
+	const HomographyAlignParams& getHomographyAlignParams() const;
+	const HoughCircleParams& getHoughCircleParams() const;
+
 	///
 	/// <summary> Remove all of the parameters and reset the object </summary>
 	///
@@ -124,9 +233,35 @@ public:
 	FilterType getFilterType() const;
 
 private:
+	///
+	/// <summary> Parse a parameter as a float, logging an error if it is missing or invalid </summary>
+	///
+	/// <param name="paramName"> The name of the parameter to parse </param>
+	/// <param name="description"> Human readable name of the parameter, used in error messages </param>
+	/// <param name="isNonNegative"> Whether negative values should be reported as an error </param>
+	/// <param name="value"> Output parameter in which the parsed value will be placed </param>
+	///
+	/// <returns> Integer status code. Negative if an error occured, non-negative if no error occured. </returns>
+	///
+	int compileFloat(const std::string& paramName, const std::string& description, bool isNonNegative, float& value) const;
+
+	int compileThreshParams();
+	int compileThreshFracParams();
+	int compileMarkParams(MarkParams& params) const;
+	int compileContourAlignParams();
+	int compileHomographyAlignParams();
+	int compileHoughCircleParams();
+
 	std::string name_{};
 	FilterType filterType_{};
 	std::map<std::string, std::string> paramTable_{};
+
+	bool isCompiled_{false};
+	ThreshParams threshParams_{};
+	ThreshFracParams threshFracParams_{};
+	ContourAlignParams contourAlignParams_{};
+	HomographyAlignParams homographyAlignParams_{};
+	HoughCircleParams houghCircleParams_{};
 };
 
 std::ostream& operator<<(std::ostream& os, const DetectionParams& detectionParams);
@@ -1,7 +1,14 @@
+#include <sstream>
+#include <fstream>
+
 #include "ExamConfig.hxx"
 #include "FilenameOracle.hxx"
+#include "TextLogging.hxx"
 
-
+namespace {
+	thread_local std::ostringstream tlOss;
+	thread_local TextLogging tlog;
+}
 
 ExamConfig::ExamConfig() = default;
 ExamConfig::~ExamConfig() = default;
@@ -15,3 +22,55 @@ int ExamConfig::setDetectionAlgorithm(const std::string& algorithmName) {
 	detectionAlgorithm_.reset();
 	return detectionAlgorithm_.load(FilenameOracle::getDetectionAlgorithmsFilename(), algorithmName);
 }
+
+int ExamConfig::loadSheetLayout(const std::string& filename) {
+	int status = 0;
+
+	if(EasyGrade::CompiledLayout::isCompiledLayoutFile(filename)) {
+		//Binary layouts are mapped rather than parsed. The tree is still rebuilt from them, since alignment works with the tree.
+		if(compiledLayout_.open(filename) < 0) {
+			status = -1;
+			TLOG_CRITICAL(tlog, tlOss, "Failed to read binary layout file \"" << filename << "\"");
+		} else {
+			compiledLayout_.expand(sheetLayout_);
+		}
+	} else {
+		std::ifstream sheetLayoutStream(filename);
+		if(!sheetLayoutStream.is_open()) {
+			status = -1;
+			TLOG_CRITICAL(tlog, tlOss, "Failed to open sheet layout file \"" << filename << "\"");
+		}
+
+		if(status >= 0 && sheetLayout_.readXml(sheetLayoutStream) < 0) {
+			status = -1;
+			TLOG_CRITICAL(tlog, tlOss, "Failed to read sheet layout file \"" << filename << "\"");
+		}
+
+		//Sheets are read from the flattened layout
+		if(status >= 0 && compiledLayout_.compile(sheetLayout_) < 0) {
+			status = -1;
+		}
+	}
+
+	if(status < 0) {
+		compiledLayout_.reset();
+	}
+
+	return status;
+}
+
+const DetectionParams& ExamConfig::getAlignmentAlgorithm() const {
+	return alignmentAlgorithm_;
+}
+
+const DetectionParams& ExamConfig::getDetectionAlgorithm() const {
+	return detectionAlgorithm_;
+}
+
+const EasyGrade::ScanSheetLayout& ExamConfig::getSheetLayout() const {
+	return sheetLayout_;
+}
+
+const EasyGrade::CompiledLayout& ExamConfig::getCompiledLayout() const {
+	return compiledLayout_;
+}
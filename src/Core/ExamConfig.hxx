@@ -1,5 +1,6 @@
 #pragma once
 
+#include "CompiledLayout.hxx"
 #include "DetectionParams.hxx"
 #include "ScanSheetLayout.hxx"
 
@@ -10,11 +11,27 @@ public:
 
 	int setAlignmentAlgorithm(const std::string& algorithmName);
 	int setDetectionAlgorithm(const std::string& algorithmName);
+
+	///
+	/// <summary> Load the sheet layout used by this exam from either an XML sheet layout file or a binary layout file written by CompiledLayout::save() </summary>
+	/// <param name="filename"> The name of the sheet layout file </param>
+	/// <returns> Integer status code. Negative if an error occured, non-negative if no error occured. </returns>
+	///
+	int loadSheetLayout(const std::string& filename);
+
+	const DetectionParams& getAlignmentAlgorithm() const;
+	const DetectionParams& getDetectionAlgorithm() const;
+	const EasyGrade::ScanSheetLayout& getSheetLayout() const;
+
+	///
+	/// <summary> Get the sheet layout flattened into arrays, which is what sheets are read with </summary>
+	///
+	const EasyGrade::CompiledLayout& getCompiledLayout() const;
 private:
 
 	DetectionParams alignmentAlgorithm_;
 	DetectionParams detectionAlgorithm_;
 	EasyGrade::ScanSheetLayout sheetLayout_;
+	EasyGrade::CompiledLayout compiledLayout_;
 
 };
-
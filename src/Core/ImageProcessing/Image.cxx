@@ -1,12 +1,14 @@
 #include "Image.hxx"
+#include "MappedFile.hxx"
 #include "TextLogging.hxx"
 
+#include <limits>
 #include <sstream>
 #include <opencv2\opencv.hpp>
 
 namespace {
-	std::ostringstream tlOss;
-	TextLogging tlog;
+	thread_local std::ostringstream tlOss;
+	thread_local TextLogging tlog;
 }
 
 
@@ -22,7 +24,7 @@ EasyGrade::Image::Image(const Image& other) {
 EasyGrade::Image::~Image() = default;
 
 // What size chunks to use when reading an unknown amount of serialized data from a stream.
-static const size_t CHUNK_SIZE = 1024;
+static const size_t CHUNK_SIZE = 64 * 1024;
 
 int EasyGrade::Image::read(std::istream& is) {
 	int status = 0;
@@ -30,67 +32,97 @@ int EasyGrade::Image::read(std::istream& is) {
 	//Check that input stream can be read
 	if(!is.good()) {
 		status = -1;
-		tlOss << "Recieved input stream that cannot be read" << std::endl;
-		tlog.critical(__FILE__, __LINE__, tlOss);
+		TLOG_CRITICAL(tlog, tlOss, "Recieved input stream that cannot be read");
 	}
 
-	//Read all of the data from the input stream into a buffer
-	std::vector<char> serializedData;
+	//Find out how much data is left in the stream, if the stream can tell
+	std::streamoff remainingSize = -1;
 	if(status >= 0) {
-		//Because the total size of the data in the stream may not be known, read it in chunks and then combine them together at the end once all of them are retrived
-
-		//Small buffer to store the most recent chunk
-		std::vector<char> currentChunk(CHUNK_SIZE, 0);
-		//buffered stream to store and combine all of the chunks
-		std::stringstream combinedChunks;
-		//The total amount of data read from the input stream so far
-		std::streamsize totalSize = 0;
+		const std::streampos start = is.tellg();
+		if(start != std::streampos(-1) && is.seekg(0, std::ios::end)) {
+			const std::streampos end = is.tellg();
+			if(end != std::streampos(-1) && is.seekg(start)) {
+				remainingSize = end - start;
+			}
+		}
+		//Streams that can't seek set the fail bit when asked to, but can still be read
+		is.clear();
+	}
 
-		//Read data until the end of the stream
+	//Read all of the data from the input stream into a buffer
+	std::vector<unsigned char> serializedData;
+	if(status >= 0 && remainingSize >= 0) {
+		//The size is known, so read the data straight into a buffer of the right size
+		serializedData.resize(static_cast<size_t>(remainingSize));
+		is.read(reinterpret_cast<char*>(serializedData.data()), remainingSize);
+		if(is.gcount() != remainingSize) {
+			status = -1;
+			TLOG_CRITICAL(tlog, tlOss, "An error occured while reading data from an input stream");
+		}
+	} else if(status >= 0) {
+		//Because the total size of the data in the stream is not known, read it in chunks straight onto the end of the buffer, growing the buffer
+		//as needed
 		while(status >= 0 && !is.eof()) {
-			//Read the next chunk from the input stream
-			is.read(currentChunk.data(), CHUNK_SIZE);
-			std::streamsize currentChunkSize = is.gcount();
-
-			//Append the latest chunk
-			combinedChunks.write(currentChunk.data(), currentChunkSize);
+			const size_t totalSize = serializedData.size();
+			serializedData.resize(totalSize + CHUNK_SIZE);
+			is.read(reinterpret_cast<char*>(serializedData.data() + totalSize), CHUNK_SIZE);
+			serializedData.resize(totalSize + static_cast<size_t>(is.gcount()));
 
-			//Update the total size counter
-			totalSize += currentChunkSize;
-
-			//Check if any errors have occured
-			if(is.fail()) {
+			//Reading past the end of the stream sets the fail bit as well as the eof bit, which is expected on the last chunk
+			if(is.bad() || (is.fail() && !is.eof())) {
 				status = -1;
-				tlOss << "An error occured while reading data from an input stream";
-				tlog.critical(__FILE__, __LINE__, tlOss);
+				TLOG_CRITICAL(tlog, tlOss, "An error occured while reading data from an input stream");
 			}
 		}
+	}
 
-		if(status >= 0) {
-			//If all data was read successfully, dump it into the buffer
-			serializedData.resize(totalSize);
-			combinedChunks.read(serializedData.data(), totalSize);
-		}
+	if(status >= 0) {
+		status = read(serializedData.data(), serializedData.size());
+	}
 
+	return status;
+}
+
+int EasyGrade::Image::read(const unsigned char* data, size_t size) {
+	int status = 0;
+
+	if(data == nullptr || size == 0 || size > static_cast<size_t>(std::numeric_limits<int>::max())) {
+		status = -1;
+		TLOG_CRITICAL(tlog, tlOss, "Recieved " << size << " bytes of serialized image data, which cannot be decoded");
 	}
 
 	if(status >= 0) {
-		//Use OpenCV to decode the data from the input stream and store the resulting image
-		cv::imdecode(serializedData, cv::IMREAD_COLOR).copyTo(*imageData_ptr_);
-
-		if(imageData_ptr_->data) {
-			tlOss << "Successfully parsed image from stream";
-			tlog.debug(__FILE__, __LINE__, tlOss);
+		//Wrap the data in a header rather than copying it, and use OpenCV to decode it. OpenCV leaves the destination untouched when the data
+		//can't be decoded, so decode into a separate matrix and only replace this image's pixel data if decoding succeeded.
+		const cv::Mat serializedData(1, static_cast<int>(size), CV_8UC1, const_cast<unsigned char*>(data));
+		cv::Mat decodedImage;
+		cv::imdecode(serializedData, cv::IMREAD_COLOR, &decodedImage);
+
+		if(!decodedImage.empty()) {
+			*imageData_ptr_ = decodedImage;
+			TLOG_DEBUG(tlog, tlOss, "Successfully parsed image from stream");
 		} else {
 			status = -1;
-			tlOss << "Failed to parsed image";
-			tlog.critical(__FILE__, __LINE__, tlOss);
+			TLOG_CRITICAL(tlog, tlOss, "Failed to parsed image");
 		}
 	}
 
 	return status;
 }
 
+int EasyGrade::Image::read(const MappedFile& file) {
+	int status = 0;
+
+	if(!file.isOpen()) {
+		status = -1;
+		TLOG_CRITICAL(tlog, tlOss, "Recieved a file that has not been mapped");
+	} else {
+		status = read(file.data(), file.size());
+	}
+
+	return status;
+}
+
 bool EasyGrade::Image::empty() const {
 	return false;
 }
@@ -114,8 +146,7 @@ int EasyGrade::Image::write(std::ostream& os, const std::string& format) const {
 
 	if(os.fail()) {
 		status = -1;
-		tlOss << "An error occured while writing an image to an output stream";
-		tlog.critical(__FILE__, __LINE__, tlOss);
+		TLOG_CRITICAL(tlog, tlOss, "An error occured while writing an image to an output stream");
 	}
 
 	return status;
@@ -8,6 +8,8 @@ namespace cv {
 	class Mat;
 }
 
+class MappedFile;
+
 namespace EasyGrade {
 
 	class ImageOperation;
@@ -28,10 +30,23 @@ namespace EasyGrade {
 
 		///
 		/// <summary> Read a serialized image from an input stream. Image can be in any file format supported by OpenCV </summary>
-		/// <param name="is"> The stream from which to read image data </param>
+		/// <param name="is"> The stream from which to read image data. If the stream is seekable, the rest of it is read in one go. </param>
 		///
 		int read(std::istream& is);
 
+		///
+		/// <summary> Decode a serialized image held in memory, directly into this image's pixel data. The serialized data is not copied. </summary>
+		/// <param name="data"> Pointer to the serialized image. Only has to remain valid until this function returns. </param>
+		/// <param name="size"> The size of the serialized image in bytes </param>
+		///
+		int read(const unsigned char* data, size_t size);
+
+		///
+		/// <summary> Decode a serialized image from a memory-mapped file, without reading the file into a buffer first </summary>
+		/// <param name="file"> The mapped file containing the serialized image </param>
+		///
+		int read(const MappedFile& file);
+
 		///
 		/// <summary> Check whether or not the image is empty (i.e. contains no pixels) </summary>
 		///
@@ -0,0 +1,141 @@
+#include <sstream>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "MappedFile.hxx"
+#include "TextLogging.hxx"
+
+namespace {
+	thread_local std::ostringstream tlOss;
+	thread_local TextLogging tlog;
+}
+
+MappedFile::MappedFile() = default;
+
+MappedFile::~MappedFile() {
+	close();
+}
+
+int MappedFile::open(const std::string& filename) {
+	int status = 0;
+
+	close();
+	filename_ = filename;
+
+#ifdef _WIN32
+	fileHandle_ = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if(fileHandle_ == INVALID_HANDLE_VALUE) {
+		fileHandle_ = nullptr;
+		status = -1;
+		TLOG_CRITICAL(tlog, tlOss, "Failed to open file \"" << filename << "\" (error " << GetLastError() << ")");
+	}
+
+	LARGE_INTEGER fileSize;
+	if(status >= 0 && !GetFileSizeEx(fileHandle_, &fileSize)) {
+		status = -1;
+		TLOG_CRITICAL(tlog, tlOss, "Failed to get the size of file \"" << filename << "\" (error " << GetLastError() << ")");
+	}
+
+	//An empty file can't be mapped, but there is nothing to read from it anyway
+	if(status >= 0 && fileSize.QuadPart > 0) {
+		size_ = static_cast<size_t>(fileSize.QuadPart);
+		mappingHandle_ = CreateFileMappingA(fileHandle_, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if(mappingHandle_ == nullptr) {
+			status = -1;
+			TLOG_CRITICAL(tlog, tlOss, "Failed to map file \"" << filename << "\" (error " << GetLastError() << ")");
+		} else {
+			data_ = static_cast<const unsigned char*>(MapViewOfFile(mappingHandle_, FILE_MAP_READ, 0, 0, 0));
+			if(data_ == nullptr) {
+				status = -1;
+				TLOG_CRITICAL(tlog, tlOss, "Failed to map file \"" << filename << "\" (error " << GetLastError() << ")");
+			}
+		}
+	}
+#else
+	fileDescriptor_ = ::open(filename.c_str(), O_RDONLY);
+	if(fileDescriptor_ < 0) {
+		status = -1;
+		TLOG_CRITICAL(tlog, tlOss, "Failed to open file \"" << filename << "\"");
+	}
+
+	struct stat fileStatus;
+	if(status >= 0 && fstat(fileDescriptor_, &fileStatus) < 0) {
+		status = -1;
+		TLOG_CRITICAL(tlog, tlOss, "Failed to get the size of file \"" << filename << "\"");
+	}
+
+	//An empty file can't be mapped, but there is nothing to read from it anyway
+	if(status >= 0 && fileStatus.st_size > 0) {
+		size_ = static_cast<size_t>(fileStatus.st_size);
+		void* mapping = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fileDescriptor_, 0);
+		if(mapping == MAP_FAILED) {
+			status = -1;
+			TLOG_CRITICAL(tlog, tlOss, "Failed to map file \"" << filename << "\"");
+		} else {
+			data_ = static_cast<const unsigned char*>(mapping);
+			//Files are usually read from start to end, so ask for the pages ahead of the one being read to be loaded early
+			madvise(mapping, size_, MADV_SEQUENTIAL);
+		}
+	}
+#endif
+
+	if(status >= 0) {
+		isOpen_ = true;
+		TLOG_DEBUG(tlog, tlOss, "Mapped " << size_ << " bytes of file \"" << filename << "\"");
+	} else {
+		close();
+	}
+
+	return status;
+}
+
+void MappedFile::close() {
+#ifdef _WIN32
+	if(data_ != nullptr) {
+		UnmapViewOfFile(data_);
+	}
+	if(mappingHandle_ != nullptr) {
+		CloseHandle(mappingHandle_);
+		mappingHandle_ = nullptr;
+	}
+	if(fileHandle_ != nullptr) {
+		CloseHandle(fileHandle_);
+		fileHandle_ = nullptr;
+	}
+#else
+	if(data_ != nullptr) {
+		munmap(const_cast<unsigned char*>(data_), size_);
+	}
+	if(fileDescriptor_ >= 0) {
+		::close(fileDescriptor_);
+		fileDescriptor_ = -1;
+	}
+#endif
+
+	data_ = nullptr;
+	size_ = 0;
+	isOpen_ = false;
+}
+
+bool MappedFile::isOpen() const {
+	return isOpen_;
+}
+
+const unsigned char* MappedFile::data() const {
+	return data_;
+}
+
+size_t MappedFile::size() const {
+	return size_;
+}
+
+const std::string& MappedFile::getFilename() const {
+	return filename_;
+}
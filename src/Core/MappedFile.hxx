@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+///
+/// <summary> A file mapped read-only into memory. The file's contents can be read straight from the page cache without copying them into a
+///           buffer first, and only the parts that are actually read are loaded from disk. </summary>
+///
+class MappedFile {
+public:
+	MappedFile();
+
+	///
+	/// <summary> Unmap the file if it is mapped </summary>
+	///
+	~MappedFile();
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	///
+	/// <summary> Map a file into memory, unmapping any file that was mapped before </summary>
+	///
+	/// <param name="filename"> The file to map </param>
+	///
+	/// <returns> Integer status code. Negative if the file could not be opened or mapped, non-negative if no error occured. </returns>
+	///
+	int open(const std::string& filename);
+
+	///
+	/// <summary> Unmap the file. Pointers returned by MappedFile::data() are no longer valid afterwards. </summary>
+	///
+	void close();
+
+	bool isOpen() const;
+
+	///
+	/// <summary> Get a pointer to the contents of the file. Null if no file is mapped or the file is empty. </summary>
+	///
+	const unsigned char* data() const;
+
+	///
+	/// <summary> Get the size of the file in bytes </summary>
+	///
+	size_t size() const;
+
+	const std::string& getFilename() const;
+
+private:
+	std::string filename_{};
+	const unsigned char* data_{nullptr};
+	size_t size_{0};
+	bool isOpen_{false};
+
+#ifdef _WIN32
+	//Windows HANDLEs, stored as void* so that windows.h doesn't have to be included here
+	void* fileHandle_{nullptr};
+	void* mappingHandle_{nullptr};
+#else
+	int fileDescriptor_{-1};
+#endif
+};
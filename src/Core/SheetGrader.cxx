@@ -0,0 +1,186 @@
+#include <algorithm>
+#include <sstream>
+
+#include "SheetGrader.hxx"
+#include "TextLogging.hxx"
+
+namespace {
+	thread_local std::ostringstream tlOss;
+	thread_local TextLogging tlog;
+}
+
+SheetGrader::SheetGrader(const ExamConfig& examConfig) : examConfig_(examConfig) {}
+SheetGrader::~SheetGrader() = default;
+
+int SheetGrader::gradeSheet(const std::vector<std::string>& filenames, std::vector<QuestionResponse>& responses) const {
+	int status = 0;
+
+	if(filenames.size() != sidesPerSheet()) {
+		status = -1;
+		TLOG_CRITICAL(tlog, tlOss, "Expected " << sidesPerSheet() << " scanned images per sheet, but recieved " << filenames.size());
+	}
+
+	for(size_t i = 0; status >= 0 && i < filenames.size(); i++) {
+		//Nothing looks at the annotations when grading, so don't spend time keeping them
+		SheetScan scan;
+		scan.setAnnotationsEnabled(false);
+		if(loadSide(scan, filenames[i], i) < 0) {
+			status = -1;
+		}
+
+		if(status >= 0) {
+			status = alignSide(scan, i);
+		}
+
+		if(status >= 0) {
+			status = readSide(scan, i, responses);
+		}
+	}
+
+	return status;
+}
+
+int SheetGrader::loadSide(SheetScan& scan, const std::string& filename, int sideNumber) const {
+	return loadSide(scan, [&scan, &filename](const DecodeHints& hints) {
+		return scan.load(filename, hints);
+	}, sideNumber);
+}
+
+int SheetGrader::loadSide(SheetScan& scan, const TiffPageReader& archive, size_t pageIndex, int sideNumber) const {
+	return loadSide(scan, [&scan, &archive, pageIndex](const DecodeHints& hints) {
+		cv::Mat page;
+		int status = archive.readPage(pageIndex, page, SheetScan::decodeFlags(hints));
+		if(status >= 0) {
+			status = scan.load(page, hints);
+		}
+		return status;
+	}, sideNumber);
+}
+
+int SheetGrader::loadSide(SheetScan& scan, const std::function<int(const DecodeHints&)>& decode, int sideNumber) const {
+	DecodeHints hints = decodeHints();
+	int status = decode(hints);
+
+	//The layout is only known in normalized coordinates, so whether a reduced resolution is good enough can only be checked once the scan
+	//has been decoded and its size is known
+	if(status >= 0 && hints.reduction > 1 && !isResolutionSufficient(scan, sideNumber)) {
+		TLOG_INFO(tlog, tlOss, "Bubbles on side " << sideNumber << " are too small to check at 1/" << hints.reduction << " resolution, decoding the scan again at full resolution");
+		hints.reduction = 1;
+		status = decode(hints);
+	}
+
+	return status;
+}
+
+DecodeHints SheetGrader::decodeHints() const {
+	const ThreshParams& alignmentParams = examConfig_.getAlignmentAlgorithm().getThreshParams();
+	const ThreshParams& detectionParams = examConfig_.getDetectionAlgorithm().getThreshParams();
+
+	DecodeHints hints;
+
+	//A single channel (or grayscale) is enough only if both algorithms threshold the same one
+	if(alignmentParams.channel == detectionParams.channel) {
+		hints.channel = detectionParams.channel;
+		hints.grayscale = detectionParams.channel < 0;
+	}
+
+	hints.reduction = std::min(alignmentParams.decodeReduction, detectionParams.decodeReduction);
+
+	return hints;
+}
+
+bool SheetGrader::isResolutionSufficient(SheetScan& scan, int sideNumber) const {
+	bool isSufficient = true;
+
+	const EasyGrade::CompiledLayout& layout = examConfig_.getCompiledLayout();
+	//The scan hasn't been aligned yet, so the width of the sheet within it isn't known. Assume the narrowest sheet allowed for.
+	const float sheetWidth = static_cast<float>(scan.getSheetImage().cols) * MIN_SHEET_WIDTH_FRACTION;
+
+	if(sideNumber >= 0 && static_cast<size_t>(sideNumber) < layout.numSides()) {
+		const float* left = layout.bubbleLeft();
+		const float* top = layout.bubbleTop();
+		const float* right = layout.bubbleRight();
+		const float* bottom = layout.bubbleBottom();
+		for(size_t i = layout.firstBubble(sideNumber); isSufficient && i < layout.endBubble(sideNumber); i++) {
+			isSufficient = std::min(right[i] - left[i], bottom[i] - top[i]) * sheetWidth >= MIN_BUBBLE_SIZE;
+		}
+	}
+
+	return isSufficient;
+}
+
+int SheetGrader::alignSide(SheetScan& scan, int sideNumber) const {
+	int status = 0;
+
+	const DetectionParams& alignmentAlgorithm = examConfig_.getAlignmentAlgorithm();
+
+	const EasyGrade::SideLayout* side = examConfig_.getSheetLayout().sideLayout(sideNumber);
+	if(side == nullptr) {
+		status = -1;
+		TLOG_CRITICAL(tlog, tlOss, "Sheet layout \"" << examConfig_.getSheetLayout().getTitle() << "\" does not have a side " << sideNumber);
+	}
+
+	//Apply the initialization step of the alignment algorithm
+	if(status >= 0 && scan.setupAlgorithm(alignmentAlgorithm) < 0) {
+		status = -1;
+		TLOG_CRITICAL(tlog, tlOss, "Failed to initialize alignment algorithm \"" << alignmentAlgorithm.getName() << "\"");
+	}
+
+	//Apply the main step of the alignment algorithm
+	if(status >= 0 && scan.alignScan(alignmentAlgorithm, *side) < 0) {
+		status = -1;
+		TLOG_CRITICAL(tlog, tlOss, "Failed to align scan using alignment algorithm \"" << alignmentAlgorithm.getName() << "\"");
+	}
+
+	return status;
+}
+
+int SheetGrader::readSide(SheetScan& scan, int sideNumber, std::vector<QuestionResponse>& responses) const {
+	int status = 0;
+
+	const DetectionParams& detectionAlgorithm = examConfig_.getDetectionAlgorithm();
+
+	const EasyGrade::SideLayout* side = examConfig_.getSheetLayout().sideLayout(sideNumber);
+	if(side == nullptr) {
+		status = -1;
+		TLOG_CRITICAL(tlog, tlOss, "Sheet layout \"" << examConfig_.getSheetLayout().getTitle() << "\" does not have a side " << sideNumber);
+	}
+
+	//Apply the initialization step of the detection algorithm. This has to be done after alignment, since alignment changes the sheet image
+	if(status >= 0 && scan.setupAlgorithm(detectionAlgorithm, *side) < 0) {
+		status = -1;
+		TLOG_CRITICAL(tlog, tlOss, "Failed to initialize detection algorithm \"" << detectionAlgorithm.getName() << "\"");
+	}
+
+	//Check every bubble on the side at once, streaming through the compiled layout. Bubbles that could not be checked are reported by SheetScan
+	//and are treated as empty.
+	const EasyGrade::CompiledLayout& layout = examConfig_.getCompiledLayout();
+	std::vector<BubbleResult> results;
+	if(status >= 0 && scan.evaluateBubbles(layout, sideNumber, detectionAlgorithm, results) < 0) {
+		status = -1;
+	}
+
+	if(status >= 0 || !results.empty()) {
+		const size_t firstBubble = layout.firstBubble(sideNumber);
+		const uint32_t* bubbleAnswer = layout.bubbleAnswer();
+		for(size_t i = layout.firstQuestion(sideNumber); i < layout.endQuestion(sideNumber); i++) {
+			QuestionResponse response;
+			response.groupName = layout.questionGroupName(i);
+			response.questionNumber = layout.questionNumber(i);
+
+			for(size_t j = layout.questionFirstBubble(i); j < layout.questionEndBubble(i); j++) {
+				if(results[j - firstBubble].filled) {
+					response.answer += layout.answerText(bubbleAnswer[j]);
+				}
+			}
+
+			responses.push_back(response);
+		}
+	}
+
+	return status;
+}
+
+size_t SheetGrader::sidesPerSheet() const {
+	return examConfig_.getSheetLayout().numSides();
+}
@@ -0,0 +1,119 @@
+#pragma once
+
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "ExamConfig.hxx"
+#include "SheetScan.hxx"
+#include "TiffPageReader.hxx"
+
+///
+/// <summary> The response read from a single question on a scanned sheet </summary>
+///
+struct QuestionResponse {
+	std::string groupName{};
+	int questionNumber{-1};
+	//The answers of every filled in bubble on the question, in the order they appear in the layout. Empty if the question was left blank.
+	std::string answer{};
+};
+
+class SheetGrader {
+public:
+	///
+	/// <summary> Create a sheet grader that reads sheets using the algorithms and sheet layout of an exam configuration </summary>
+	/// <param name="examConfig"> The exam configuration to use. Must outlive this sheet grader. </param>
+	///
+	SheetGrader(const ExamConfig& examConfig);
+	~SheetGrader();
+
+	///
+	/// <summary> Load the scans of every side of a sheet and read the responses to every question on them </summary>
+	///
+	/// <param name="filenames"> The filenames of the scanned images, one per side of the sheet layout, in side order </param>
+	/// <param name="responses"> Vector to which the response to each question will be appended </param>
+	///
+	/// <returns> Integer status code. Negative if an error occured, non-negative if no error occured. </returns>
+	///
+	int gradeSheet(const std::vector<std::string>& filenames, std::vector<QuestionResponse>& responses) const;
+
+	///
+	/// <summary> Load the scan of one side of a sheet, decoding only as much of it as the exam's algorithms need </summary>
+	///
+	/// <param name="scan"> The scan to load the image into </param>
+	/// <param name="filename"> The filename of the scanned image </param>
+	/// <param name="sideNumber"> Which side of the sheet layout the scan is of </param>
+	///
+	/// <returns> Integer status code. Negative if an error occured, non-negative if no error occured. </returns>
+	///
+	int loadSide(SheetScan& scan, const std::string& filename, int sideNumber) const;
+
+	///
+	/// <summary> Load the scan of one side of a sheet from a page of a multi-page archive, decoding only as much of it as the exam's algorithms need </summary>
+	///
+	/// <param name="scan"> The scan to load the image into </param>
+	/// <param name="archive"> The archive the scan is in </param>
+	/// <param name="pageIndex"> Which page of the archive the scan is on </param>
+	/// <param name="sideNumber"> Which side of the sheet layout the scan is of </param>
+	///
+	/// <returns> Integer status code. Negative if an error occured, non-negative if no error occured. </returns>
+	///
+	int loadSide(SheetScan& scan, const TiffPageReader& archive, size_t pageIndex, int sideNumber) const;
+
+	///
+	/// <summary> Get how scans can be decoded without losing anything the exam's alignment and detection algorithms use </summary>
+	///
+	DecodeHints decodeHints() const;
+
+	///
+	/// <summary> Straighten and crop a freshly loaded scan using the exam's alignment algorithm </summary>
+	///
+	/// <param name="scan"> The scan to align </param>
+	/// <param name="sideNumber"> Which side of the sheet layout the scan is of </param>
+	///
+	/// <returns> Integer status code. Negative if an error occured, non-negative if no error occured. </returns>
+	///
+	int alignSide(SheetScan& scan, int sideNumber) const;
+
+	///
+	/// <summary> Read the responses to every question on one side of an aligned scan </summary>
+	///
+	/// <param name="scan"> The scan to read. Must already have been aligned with SheetGrader::alignSide() </param>
+	/// <param name="sideNumber"> Which side of the sheet layout the scan is of </param>
+	/// <param name="responses"> Vector to which the response to each question on the side will be appended </param>
+	///
+	/// <returns> Integer status code. Negative if an error occured, non-negative if no error occured. </returns>
+	///
+	int readSide(SheetScan& scan, int sideNumber, std::vector<QuestionResponse>& responses) const;
+
+	///
+	/// <summary> Get the number of scanned images that make up one sheet (i.e. the number of sides on the sheet layout) </summary>
+	///
+	size_t sidesPerSheet() const;
+
+private:
+	//The fewest pixels across the smallest bubble on a side for a scan decoded at a reduced resolution to be kept rather than decoded again
+	//at full resolution
+	static constexpr float MIN_BUBBLE_SIZE = 12.0f;
+	//The smallest fraction of a scan's width that the sheet is assumed to take up. Layout coordinates are relative to the aligned sheet,
+	//which is cropped out of the scan, so the whole scan's width overestimates how large the bubbles will be.
+	static constexpr float MIN_SHEET_WIDTH_FRACTION = 0.75f;
+
+	///
+	/// <summary> Load a scan using the decode hints of the exam's algorithms, decoding it again at full resolution if the smallest bubble on the
+	///           side would be too small to check reliably at the reduced resolution </summary>
+	///
+	/// <param name="scan"> The scan being loaded </param>
+	/// <param name="decode"> Decodes the scan into the SheetScan using the decode hints it is given </param>
+	/// <param name="sideNumber"> Which side of the sheet layout the scan is of </param>
+	///
+	int loadSide(SheetScan& scan, const std::function<int(const DecodeHints&)>& decode, int sideNumber) const;
+
+	///
+	/// <summary> Check that every bubble on a side will be at least MIN_BUBBLE_SIZE pixels across on a loaded scan once it has been aligned,
+	///           assuming the sheet takes up as little of the scan as MIN_SHEET_WIDTH_FRACTION allows </summary>
+	///
+	bool isResolutionSufficient(SheetScan& scan, int sideNumber) const;
+
+	const ExamConfig& examConfig_;
+};
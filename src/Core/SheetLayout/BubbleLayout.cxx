@@ -5,8 +5,8 @@
 #include "TextLogging.hxx"
 
 namespace {
-	std::ostringstream tlOss;
-	TextLogging tlog;
+	thread_local std::ostringstream tlOss;
+	thread_local TextLogging tlog;
 }
 
 EasyGrade::BubbleLayout::BubbleLayout() = default;
@@ -18,14 +18,12 @@ EasyGrade::BubbleLayout::BubbleLayout(const BubbleLayout& other) {
 
 int EasyGrade::BubbleLayout::removeChild(SheetLayoutElement* sheetLayoutElement) {
 	//Bubble layouts are always leaf elements; they never have any children. So this method should always return a positive number, indicating that the specified element is not its child
-	tlOss << "removeChild was called on a bubble layout, which will never have children. This is allowed, but may not have been intended.";
-	tlog.debug(__FILE__, __LINE__, tlOss);
+	TLOG_DEBUG(tlog, tlOss, "removeChild was called on a bubble layout, which will never have children. This is allowed, but may not have been intended.");
 	return 1;
 }
 
 EasyGrade::SheetLayoutElement* EasyGrade::BubbleLayout::childAt(size_t index) {
-	tlOss << "childAt was called on a bubble layout, which will never have children. This is allowed, but may not have been intended.";
-	tlog.debug(__FILE__, __LINE__, tlOss);
+	TLOG_DEBUG(tlog, tlOss, "childAt was called on a bubble layout, which will never have children. This is allowed, but may not have been intended.");
 	return nullptr;
 }
 
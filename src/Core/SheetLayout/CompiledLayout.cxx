@@ -0,0 +1,540 @@
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <sstream>
+
+#include "CompiledLayout.hxx"
+#include "TextLogging.hxx"
+
+namespace {
+	thread_local std::ostringstream tlOss;
+	thread_local TextLogging tlog;
+
+	const char MAGIC[8] = {'E', 'G', 'L', 'A', 'Y', 'O', 'U', 'T'};
+
+	//Written in the byte order of the machine that wrote the file, so that it reads back differently on a machine with the other byte order
+	const uint32_t BYTE_ORDER_MARK = 0x01020304;
+
+	//Every array starts this many bytes (or a multiple of it) from the start of the file
+	const uint64_t SECTION_ALIGNMENT = 16;
+
+	///
+	/// <summary> The start of a binary layout file </summary>
+	///
+	struct FileHeader {
+		char magic[8];
+		uint32_t version;
+		uint32_t byteOrderMark;
+		uint32_t numSides;
+		uint32_t numGroups;
+		uint32_t numQuestions;
+		uint32_t numBubbles;
+		uint32_t numMarks;
+		uint32_t numAnswers;
+		uint32_t stringsSize;
+		uint32_t titleOffset;
+		uint64_t fileSize;
+	};
+
+	//The arrays of a binary layout, in the order they follow the header in the file
+	enum Section {
+		SIDE_GROUP_START, SIDE_MARK_START, SIDE_IMAGE_NAME, GROUP_NAME, GROUP_QUESTION_START, QUESTION_GROUP, QUESTION_NUMBER, QUESTION_BUBBLE_START,
+		MARK_X, MARK_Y, BUBBLE_LEFT, BUBBLE_TOP, BUBBLE_RIGHT, BUBBLE_BOTTOM, BUBBLE_QUESTION, BUBBLE_ANSWER, ANSWER_TEXT, STRINGS, NUM_SECTIONS
+	};
+
+	///
+	/// <summary> Get the size in bytes of one of the arrays of a binary layout </summary>
+	///
+	uint64_t sectionSize(const FileHeader& header, int section) {
+		uint64_t length = 0;
+		switch(section) {
+		case SIDE_GROUP_START:
+		case SIDE_MARK_START:
+			length = static_cast<uint64_t>(header.numSides) + 1;
+			break;
+		case SIDE_IMAGE_NAME:
+			length = header.numSides;
+			break;
+		case GROUP_NAME:
+			length = header.numGroups;
+			break;
+		case GROUP_QUESTION_START:
+			length = static_cast<uint64_t>(header.numGroups) + 1;
+			break;
+		case QUESTION_GROUP:
+		case QUESTION_NUMBER:
+			length = header.numQuestions;
+			break;
+		case QUESTION_BUBBLE_START:
+			length = static_cast<uint64_t>(header.numQuestions) + 1;
+			break;
+		case MARK_X:
+		case MARK_Y:
+			length = header.numMarks;
+			break;
+		case ANSWER_TEXT:
+			length = header.numAnswers;
+			break;
+		case STRINGS:
+			//The strings are the only array of single bytes
+			return header.stringsSize;
+		default:
+			length = header.numBubbles;
+		}
+		return length * 4;
+	}
+
+	///
+	/// <summary> Work out where each array of a binary layout starts </summary>
+	///
+	/// <returns> The size of the whole file in bytes </returns>
+	///
+	uint64_t sectionOffsets(const FileHeader& header, uint64_t offsets[NUM_SECTIONS]) {
+		uint64_t offset = sizeof(FileHeader);
+		for(int section = 0; section < NUM_SECTIONS; section++) {
+			offset = (offset + SECTION_ALIGNMENT - 1) / SECTION_ALIGNMENT * SECTION_ALIGNMENT;
+			offsets[section] = offset;
+			offset += sectionSize(header, section);
+		}
+		return offset;
+	}
+
+	///
+	/// <summary> Check that an array of start indices begins at zero, never decreases and ends at the number of children </summary>
+	///
+	bool isValidStart(const uint32_t* start, uint32_t numParents, uint32_t numChildren) {
+		bool isValid = start[0] == 0 && start[numParents] == numChildren;
+		for(uint32_t i = 0; isValid && i < numParents; i++) {
+			isValid = start[i] <= start[i + 1];
+		}
+		return isValid;
+	}
+
+	///
+	/// <summary> Check that an array of parent indices agrees with the start indices of the parents </summary>
+	///
+	bool isValidParent(const uint32_t* parent, const uint32_t* start, uint32_t numParents) {
+		bool isValid = true;
+		for(uint32_t i = 0; isValid && i < numParents; i++) {
+			for(uint32_t j = start[i]; isValid && j < start[i + 1]; j++) {
+				isValid = parent[j] == i;
+			}
+		}
+		return isValid;
+	}
+
+	///
+	/// <summary> Check that every element of an array of string offsets is within the string block </summary>
+	///
+	bool isValidString(const uint32_t* offsets, uint32_t numOffsets, uint32_t stringsSize) {
+		bool isValid = true;
+		for(uint32_t i = 0; isValid && i < numOffsets; i++) {
+			isValid = offsets[i] < stringsSize;
+		}
+		return isValid;
+	}
+
+	///
+	/// <summary> Add a string to the string block of a binary layout, unless an identical string is already in it </summary>
+	///
+	/// <returns> The offset of the string in the string block </returns>
+	///
+	uint32_t addString(const std::string& str, std::string& strings, std::map<std::string, uint32_t>& offsets) {
+		auto offsetIter = offsets.find(str);
+		if(offsetIter == offsets.end()) {
+			offsetIter = offsets.emplace(str, static_cast<uint32_t>(strings.size())).first;
+			strings.append(str.c_str(), str.size() + 1);
+		}
+		return offsetIter->second;
+	}
+}
+
+EasyGrade::CompiledLayout::CompiledLayout() = default;
+EasyGrade::CompiledLayout::~CompiledLayout() = default;
+
+int EasyGrade::CompiledLayout::compile(const ScanSheetLayout& layout) {
+	int status = 0;
+
+	reset();
+
+	std::string strings;
+	std::map<std::string, uint32_t> stringOffsets;
+	std::map<std::string, uint32_t> answerCodes;
+
+	std::vector<uint32_t> sideGroupStart{0};
+	std::vector<uint32_t> sideMarkStart{0};
+	std::vector<uint32_t> sideImageName;
+	std::vector<uint32_t> groupName;
+	std::vector<uint32_t> groupQuestionStart{0};
+	std::vector<uint32_t> questionGroup;
+	std::vector<int32_t> questionNumber;
+	std::vector<uint32_t> questionBubbleStart{0};
+	std::vector<float> markX;
+	std::vector<float> markY;
+	std::vector<float> bubbleLeft;
+	std::vector<float> bubbleTop;
+	std::vector<float> bubbleRight;
+	std::vector<float> bubbleBottom;
+	std::vector<uint32_t> bubbleQuestion;
+	std::vector<uint32_t> bubbleAnswer;
+	std::vector<uint32_t> answerText;
+
+	const uint32_t titleOffset = addString(layout.getTitle(), strings, stringOffsets);
+
+	//Flatten the tree in layout order, recording where each element's children start
+	for(size_t i = 0; i < layout.numSides(); i++) {
+		const SideLayout* side = layout.sideLayout(i);
+		sideImageName.push_back(addString(side->getReferenceImageFilename(), strings, stringOffsets));
+
+		for(const AlignmentMark& alignmentMark : side->getAlignmentMarks()) {
+			markX.push_back(alignmentMark.x);
+			markY.push_back(alignmentMark.y);
+		}
+		sideMarkStart.push_back(static_cast<uint32_t>(markX.size()));
+
+		for(size_t j = 0; j < side->numChildren(); j++) {
+			const GroupLayout* group = side->groupAt(j);
+			groupName.push_back(addString(group->getName(), strings, stringOffsets));
+
+			for(size_t k = 0; k < group->numChildren(); k++) {
+				const QuestionLayout* question = group->questionAt(k);
+				questionGroup.push_back(static_cast<uint32_t>(groupName.size() - 1));
+				questionNumber.push_back(question->getQuestionNumber());
+
+				for(size_t l = 0; l < question->numChildren(); l++) {
+					const BubbleLayout* bubble = question->bubbleAt(l);
+					bubbleLeft.push_back(bubble->getLeftEdge());
+					bubbleTop.push_back(bubble->getTopEdge());
+					bubbleRight.push_back(bubble->getRightEdge());
+					bubbleBottom.push_back(bubble->getBottomEdge());
+					bubbleQuestion.push_back(static_cast<uint32_t>(questionNumber.size() - 1));
+
+					//Bubbles with the same answer share an answer code
+					auto codeIter = answerCodes.find(bubble->getAnswer());
+					if(codeIter == answerCodes.end()) {
+						codeIter = answerCodes.emplace(bubble->getAnswer(), static_cast<uint32_t>(answerText.size())).first;
+						answerText.push_back(addString(bubble->getAnswer(), strings, stringOffsets));
+					}
+					bubbleAnswer.push_back(codeIter->second);
+				}
+				questionBubbleStart.push_back(static_cast<uint32_t>(bubbleLeft.size()));
+			}
+			groupQuestionStart.push_back(static_cast<uint32_t>(questionGroup.size()));
+		}
+		sideGroupStart.push_back(static_cast<uint32_t>(groupName.size()));
+	}
+
+	FileHeader header{};
+	std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+	header.version = FORMAT_VERSION;
+	header.byteOrderMark = BYTE_ORDER_MARK;
+	header.numSides = static_cast<uint32_t>(sideImageName.size());
+	header.numGroups = static_cast<uint32_t>(groupName.size());
+	header.numQuestions = static_cast<uint32_t>(questionGroup.size());
+	header.numBubbles = static_cast<uint32_t>(bubbleLeft.size());
+	header.numMarks = static_cast<uint32_t>(markX.size());
+	header.numAnswers = static_cast<uint32_t>(answerText.size());
+	header.stringsSize = static_cast<uint32_t>(strings.size());
+	header.titleOffset = titleOffset;
+
+	uint64_t offsets[NUM_SECTIONS];
+	header.fileSize = sectionOffsets(header, offsets);
+
+	//Lay the arrays out exactly as they are in a file, so that compiled and mapped layouts are read the same way
+	ownedData_.assign(static_cast<size_t>((header.fileSize + sizeof(uint64_t) - 1) / sizeof(uint64_t)), 0);
+	unsigned char* data = reinterpret_cast<unsigned char*>(ownedData_.data());
+	std::memcpy(data, &header, sizeof(header));
+
+	const void* sources[NUM_SECTIONS] = {
+		sideGroupStart.data(), sideMarkStart.data(), sideImageName.data(), groupName.data(), groupQuestionStart.data(), questionGroup.data(),
+		questionNumber.data(), questionBubbleStart.data(), markX.data(), markY.data(), bubbleLeft.data(), bubbleTop.data(), bubbleRight.data(),
+		bubbleBottom.data(), bubbleQuestion.data(), bubbleAnswer.data(), answerText.data(), strings.data()
+	};
+	for(int section = 0; section < NUM_SECTIONS; section++) {
+		const uint64_t size = sectionSize(header, section);
+		if(size > 0) {
+			std::memcpy(data + offsets[section], sources[section], static_cast<size_t>(size));
+		}
+	}
+
+	status = attach(data, static_cast<size_t>(header.fileSize));
+
+	if(status >= 0) {
+		TLOG_INFO(tlog, tlOss, "Compiled sheet layout \"" << layout.getTitle() << "\" (" << header.numBubbles << " bubbles, " << header.fileSize << " bytes)");
+	} else {
+		reset();
+		TLOG_CRITICAL(tlog, tlOss, "Failed to compile sheet layout \"" << layout.getTitle() << "\"");
+	}
+
+	return status;
+}
+
+int EasyGrade::CompiledLayout::open(const std::string& filename) {
+	int status = 0;
+
+	reset();
+
+	if(mappedFile_.open(filename) < 0) {
+		status = -1;
+	}
+
+	if(status >= 0 && attach(mappedFile_.data(), mappedFile_.size()) < 0) {
+		status = -1;
+		TLOG_CRITICAL(tlog, tlOss, "\"" << filename << "\" is not a valid binary layout file");
+	}
+
+	if(status >= 0) {
+		TLOG_INFO(tlog, tlOss, "Mapped binary layout file \"" << filename << "\" (" << views_.numBubbles << " bubbles)");
+	} else {
+		reset();
+	}
+
+	return status;
+}
+
+int EasyGrade::CompiledLayout::save(const std::string& filename) const {
+	int status = 0;
+
+	std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+	if(!file.is_open()) {
+		status = -1;
+		TLOG_CRITICAL(tlog, tlOss, "Failed to open \"" << filename << "\" for writing");
+	}
+
+	if(status >= 0 && views_.data == nullptr) {
+		status = -1;
+		TLOG_CRITICAL(tlog, tlOss, "Unable to write \"" << filename << "\", no layout has been compiled");
+	}
+
+	if(status >= 0 && !file.write(reinterpret_cast<const char*>(views_.data), views_.size)) {
+		status = -1;
+		TLOG_CRITICAL(tlog, tlOss, "Failed to write binary layout file \"" << filename << "\"");
+	}
+
+	return status;
+}
+
+void EasyGrade::CompiledLayout::expand(ScanSheetLayout& layout) const {
+	layout.reset();
+	layout.setTitle(getTitle());
+
+	for(uint32_t i = 0; i < views_.numSides; i++) {
+		layout.newSide();
+		SideLayout* side = layout.sideLayout(i);
+		side->setReferenceImageFilename(views_.strings + views_.sideImageName[i]);
+
+		for(uint32_t j = views_.sideMarkStart[i]; j < views_.sideMarkStart[i + 1]; j++) {
+			AlignmentMark alignmentMark;
+			alignmentMark.x = views_.markX[j];
+			alignmentMark.y = views_.markY[j];
+			side->addAlignmentMark(alignmentMark);
+		}
+
+		for(uint32_t j = views_.sideGroupStart[i]; j < views_.sideGroupStart[i + 1]; j++) {
+			GroupLayout* group = side->newGroup();
+			group->setName(views_.strings + views_.groupName[j]);
+
+			for(uint32_t k = views_.groupQuestionStart[j]; k < views_.groupQuestionStart[j + 1]; k++) {
+				QuestionLayout* question = group->newQuestion(views_.questionNumber[k]);
+
+				for(uint32_t l = views_.questionBubbleStart[k]; l < views_.questionBubbleStart[k + 1]; l++) {
+					BubbleLayout* bubble = question->newBubble();
+					bubble->setAnswer(answerText(views_.bubbleAnswer[l]));
+					bubble->setLeftEdge(views_.bubbleLeft[l]);
+					bubble->setTopEdge(views_.bubbleTop[l]);
+					bubble->setRightEdge(views_.bubbleRight[l]);
+					bubble->setBottomEdge(views_.bubbleBottom[l]);
+				}
+			}
+		}
+	}
+
+	layout.refreshIndex();
+}
+
+void EasyGrade::CompiledLayout::reset() {
+	views_ = Views();
+	ownedData_.clear();
+	mappedFile_.close();
+}
+
+bool EasyGrade::CompiledLayout::isCompiledLayoutFile(const std::string& filename) {
+	std::ifstream file(filename, std::ios::binary);
+	char magic[sizeof(MAGIC)];
+	return file.read(magic, sizeof(magic)) && std::memcmp(magic, MAGIC, sizeof(MAGIC)) == 0;
+}
+
+int EasyGrade::CompiledLayout::attach(const unsigned char* data, size_t size) {
+	int status = 0;
+
+	FileHeader header{};
+	if(data == nullptr || size < sizeof(FileHeader)) {
+		status = -1;
+		TLOG_CRITICAL(tlog, tlOss, "Binary layout is too small (" << size << " bytes) to hold a header");
+	} else {
+		std::memcpy(&header, data, sizeof(header));
+	}
+
+	if(status >= 0 && std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0) {
+		status = -1;
+		TLOG_CRITICAL(tlog, tlOss, "Binary layout does not start with the binary layout signature");
+	} else if(status >= 0 && header.byteOrderMark != BYTE_ORDER_MARK) {
+		status = -1;
+		TLOG_CRITICAL(tlog, tlOss, "Binary layout was written on a machine with a different byte order");
+	} else if(status >= 0 && header.version != FORMAT_VERSION) {
+		status = -1;
+		TLOG_CRITICAL(tlog, tlOss, "Binary layout has format version " << header.version << ", but only version " << FORMAT_VERSION << " is supported");
+	}
+
+	uint64_t offsets[NUM_SECTIONS];
+	if(status >= 0 && (header.fileSize != size || sectionOffsets(header, offsets) != size)) {
+		status = -1;
+		TLOG_CRITICAL(tlog, tlOss, "Binary layout is " << size << " bytes, which does not match the size of the arrays it says it holds");
+	}
+
+	Views views;
+	if(status >= 0) {
+		views.data = data;
+		views.size = size;
+		views.numSides = header.numSides;
+		views.numGroups = header.numGroups;
+		views.numQuestions = header.numQuestions;
+		views.numBubbles = header.numBubbles;
+		views.numMarks = header.numMarks;
+		views.numAnswers = header.numAnswers;
+		views.sideGroupStart = reinterpret_cast<const uint32_t*>(data + offsets[SIDE_GROUP_START]);
+		views.sideMarkStart = reinterpret_cast<const uint32_t*>(data + offsets[SIDE_MARK_START]);
+		views.sideImageName = reinterpret_cast<const uint32_t*>(data + offsets[SIDE_IMAGE_NAME]);
+		views.groupName = reinterpret_cast<const uint32_t*>(data + offsets[GROUP_NAME]);
+		views.groupQuestionStart = reinterpret_cast<const uint32_t*>(data + offsets[GROUP_QUESTION_START]);
+		views.questionGroup = reinterpret_cast<const uint32_t*>(data + offsets[QUESTION_GROUP]);
+		views.questionNumber = reinterpret_cast<const int32_t*>(data + offsets[QUESTION_NUMBER]);
+		views.questionBubbleStart = reinterpret_cast<const uint32_t*>(data + offsets[QUESTION_BUBBLE_START]);
+		views.markX = reinterpret_cast<const float*>(data + offsets[MARK_X]);
+		views.markY = reinterpret_cast<const float*>(data + offsets[MARK_Y]);
+		views.bubbleLeft = reinterpret_cast<const float*>(data + offsets[BUBBLE_LEFT]);
+		views.bubbleTop = reinterpret_cast<const float*>(data + offsets[BUBBLE_TOP]);
+		views.bubbleRight = reinterpret_cast<const float*>(data + offsets[BUBBLE_RIGHT]);
+		views.bubbleBottom = reinterpret_cast<const float*>(data + offsets[BUBBLE_BOTTOM]);
+		views.bubbleQuestion = reinterpret_cast<const uint32_t*>(data + offsets[BUBBLE_QUESTION]);
+		views.bubbleAnswer = reinterpret_cast<const uint32_t*>(data + offsets[BUBBLE_ANSWER]);
+		views.answerText = reinterpret_cast<const uint32_t*>(data + offsets[ANSWER_TEXT]);
+		views.strings = reinterpret_cast<const char*>(data + offsets[STRINGS]);
+		views.stringsSize = header.stringsSize;
+		views.titleOffset = header.titleOffset;
+	}
+
+	//Check every index once here, so that the accessors can use them without checking them again
+	if(status >= 0) {
+		const bool isTreeValid = isValidStart(views.sideGroupStart, views.numSides, views.numGroups) &&
+			isValidStart(views.sideMarkStart, views.numSides, views.numMarks) &&
+			isValidStart(views.groupQuestionStart, views.numGroups, views.numQuestions) &&
+			isValidStart(views.questionBubbleStart, views.numQuestions, views.numBubbles) &&
+			isValidParent(views.questionGroup, views.groupQuestionStart, views.numGroups) &&
+			isValidParent(views.bubbleQuestion, views.questionBubbleStart, views.numQuestions);
+		if(!isTreeValid) {
+			status = -1;
+			TLOG_CRITICAL(tlog, tlOss, "Binary layout has element indices that do not form a valid layout tree");
+		}
+	}
+
+	if(status >= 0) {
+		bool areStringsValid = views.stringsSize > 0 && views.strings[views.stringsSize - 1] == '\0' && views.titleOffset < views.stringsSize &&
+			isValidString(views.sideImageName, views.numSides, views.stringsSize) &&
+			isValidString(views.groupName, views.numGroups, views.stringsSize) &&
+			isValidString(views.answerText, views.numAnswers, views.stringsSize);
+		for(uint32_t i = 0; areStringsValid && i < views.numBubbles; i++) {
+			areStringsValid = views.bubbleAnswer[i] < views.numAnswers;
+		}
+		if(!areStringsValid) {
+			status = -1;
+			TLOG_CRITICAL(tlog, tlOss, "Binary layout refers to strings or answers that it does not hold");
+		}
+	}
+
+	if(status >= 0) {
+		views_ = views;
+	}
+
+	return status;
+}
+
+const char* EasyGrade::CompiledLayout::getTitle() const {
+	return views_.strings != nullptr ? views_.strings + views_.titleOffset : "";
+}
+
+size_t EasyGrade::CompiledLayout::numSides() const {
+	return views_.numSides;
+}
+
+size_t EasyGrade::CompiledLayout::numGroups() const {
+	return views_.numGroups;
+}
+
+size_t EasyGrade::CompiledLayout::numQuestions() const {
+	return views_.numQuestions;
+}
+
+size_t EasyGrade::CompiledLayout::numBubbles() const {
+	return views_.numBubbles;
+}
+
+size_t EasyGrade::CompiledLayout::firstQuestion(size_t sideNumber) const {
+	return views_.groupQuestionStart[views_.sideGroupStart[sideNumber]];
+}
+
+size_t EasyGrade::CompiledLayout::endQuestion(size_t sideNumber) const {
+	return views_.groupQuestionStart[views_.sideGroupStart[sideNumber + 1]];
+}
+
+size_t EasyGrade::CompiledLayout::firstBubble(size_t sideNumber) const {
+	return views_.questionBubbleStart[firstQuestion(sideNumber)];
+}
+
+size_t EasyGrade::CompiledLayout::endBubble(size_t sideNumber) const {
+	return views_.questionBubbleStart[endQuestion(sideNumber)];
+}
+
+size_t EasyGrade::CompiledLayout::questionFirstBubble(size_t questionIndex) const {
+	return views_.questionBubbleStart[questionIndex];
+}
+
+size_t EasyGrade::CompiledLayout::questionEndBubble(size_t questionIndex) const {
+	return views_.questionBubbleStart[questionIndex + 1];
+}
+
+int EasyGrade::CompiledLayout::questionNumber(size_t questionIndex) const {
+	return views_.questionNumber[questionIndex];
+}
+
+const char* EasyGrade::CompiledLayout::questionGroupName(size_t questionIndex) const {
+	return views_.strings + views_.groupName[views_.questionGroup[questionIndex]];
+}
+
+const float* EasyGrade::CompiledLayout::bubbleLeft() const {
+	return views_.bubbleLeft;
+}
+
+const float* EasyGrade::CompiledLayout::bubbleTop() const {
+	return views_.bubbleTop;
+}
+
+const float* EasyGrade::CompiledLayout::bubbleRight() const {
+	return views_.bubbleRight;
+}
+
+const float* EasyGrade::CompiledLayout::bubbleBottom() const {
+	return views_.bubbleBottom;
+}
+
+const uint32_t* EasyGrade::CompiledLayout::bubbleQuestion() const {
+	return views_.bubbleQuestion;
+}
+
+const uint32_t* EasyGrade::CompiledLayout::bubbleAnswer() const {
+	return views_.bubbleAnswer;
+}
+
+const char* EasyGrade::CompiledLayout::answerText(uint32_t answerCode) const {
+	return views_.strings + views_.answerText[answerCode];
+}
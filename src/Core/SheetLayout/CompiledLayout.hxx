@@ -0,0 +1,180 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "MappedFile.hxx"
+#include "ScanSheetLayout.hxx"
+
+namespace EasyGrade {
+
+	///
+	/// <summary> A sheet layout flattened into contiguous arrays, for reading sheets rather than editing them. Bubbles are stored in layout order
+	///           (side, group, question, bubble) as separate arrays of each edge, of the question they belong to and of their answer, so that
+	///           every bubble on a side can be visited with a linear pass over memory. </summary>
+	///
+	/// <note> The arrays are laid out exactly as they are in the binary layout file format, so a layout file can be mapped into memory and used
+	///        as it is, without parsing it. Files are written in the byte order of the machine writing them and are rejected by machines with a
+	///        different byte order. </note>
+	///
+	class CompiledLayout {
+	public:
+		//Version of the binary layout file format. Files written with a different version are rejected.
+		static constexpr uint32_t FORMAT_VERSION = 1;
+
+		CompiledLayout();
+		~CompiledLayout();
+
+		CompiledLayout(const CompiledLayout&) = delete;
+		CompiledLayout& operator=(const CompiledLayout&) = delete;
+
+		///
+		/// <summary> Flatten a sheet layout, replacing whatever this compiled layout held before </summary>
+		///
+		/// <param name="layout"> The sheet layout to flatten </param>
+		///
+		/// <returns> Integer status code. Negative if an error occured, non-negative if no error occured. </returns>
+		///
+		int compile(const ScanSheetLayout& layout);
+
+		///
+		/// <summary> Map a binary layout file into memory and use it as this compiled layout. The file stays mapped until this compiled layout is
+		///           reset, destroyed or replaced. </summary>
+		///
+		/// <param name="filename"> The binary layout file to open </param>
+		///
+		/// <returns> Integer status code. Negative if the file could not be opened or is not a valid layout file, non-negative if no error occured. </returns>
+		///
+		int open(const std::string& filename);
+
+		///
+		/// <summary> Write this compiled layout to a binary layout file </summary>
+		///
+		/// <param name="filename"> The file to write </param>
+		///
+		/// <returns> Integer status code. Negative if an error occured, non-negative if no error occured. </returns>
+		///
+		int save(const std::string& filename) const;
+
+		///
+		/// <summary> Rebuild the tree of layout elements that this compiled layout was flattened from </summary>
+		///
+		/// <param name="layout"> The sheet layout to replace the contents of </param>
+		///
+		void expand(ScanSheetLayout& layout) const;
+
+		///
+		/// <summary> Clear this compiled layout, unmapping its file if it has one </summary>
+		///
+		void reset();
+
+		///
+		/// <summary> Check whether a file starts like a binary layout file (rather than e.g. an XML sheet layout) </summary>
+		///
+		static bool isCompiledLayoutFile(const std::string& filename);
+
+		const char* getTitle() const;
+
+		size_t numSides() const;
+		size_t numGroups() const;
+		size_t numQuestions() const;
+		size_t numBubbles() const;
+
+		///
+		/// <summary> Get the index of the first question on a side. The side's questions run up to (but not including) the first question of the next side. </summary>
+		///
+		size_t firstQuestion(size_t sideNumber) const;
+		size_t endQuestion(size_t sideNumber) const;
+
+		///
+		/// <summary> Get the index of the first bubble on a side. The side's bubbles run up to (but not including) the first bubble of the next side. </summary>
+		///
+		size_t firstBubble(size_t sideNumber) const;
+		size_t endBubble(size_t sideNumber) const;
+
+		///
+		/// <summary> Get the index of the first bubble on a question. The question's bubbles run up to (but not including) the first bubble of the next question. </summary>
+		///
+		size_t questionFirstBubble(size_t questionIndex) const;
+		size_t questionEndBubble(size_t questionIndex) const;
+
+		int questionNumber(size_t questionIndex) const;
+		const char* questionGroupName(size_t questionIndex) const;
+
+		//Edges of every bubble, in normalized coordinates
+		const float* bubbleLeft() const;
+		const float* bubbleTop() const;
+		const float* bubbleRight() const;
+		const float* bubbleBottom() const;
+
+		//Index of the question each bubble belongs to
+		const uint32_t* bubbleQuestion() const;
+
+		//Answer code of each bubble. Bubbles with the same answer have the same code.
+		const uint32_t* bubbleAnswer() const;
+
+		///
+		/// <summary> Get the answer that an answer code stands for </summary>
+		///
+		const char* answerText(uint32_t answerCode) const;
+
+	private:
+		///
+		/// <summary> Check that a block of memory holds a valid binary layout and point this compiled layout's arrays into it </summary>
+		///
+		/// <param name="data"> The binary layout. Must be at least 4 byte aligned and must outlive this compiled layout's use of it. </param>
+		/// <param name="size"> The size of the binary layout in bytes </param>
+		///
+		/// <returns> Integer status code. Negative if the memory does not hold a valid binary layout, non-negative if no error occured. </returns>
+		///
+		int attach(const unsigned char* data, size_t size);
+
+		//Storage for layouts compiled in memory. 64 bit elements keep every array aligned.
+		std::vector<uint64_t> ownedData_{};
+		//Storage for layouts mapped from a file
+		MappedFile mappedFile_{};
+
+		///
+		/// <summary> Where the arrays of the current layout are, and how long they are </summary>
+		///
+		struct Views {
+			const unsigned char* data{nullptr};
+			size_t size{0};
+
+			uint32_t numSides{0};
+			uint32_t numGroups{0};
+			uint32_t numQuestions{0};
+			uint32_t numBubbles{0};
+			uint32_t numMarks{0};
+			uint32_t numAnswers{0};
+
+			//Each *Start array has one more element than there are parents; the children of parent i run from start[i] to start[i + 1]
+			const uint32_t* sideGroupStart{nullptr};
+			const uint32_t* sideMarkStart{nullptr};
+			const uint32_t* sideImageName{nullptr};
+			const uint32_t* groupName{nullptr};
+			const uint32_t* groupQuestionStart{nullptr};
+			const uint32_t* questionGroup{nullptr};
+			const int32_t* questionNumber{nullptr};
+			const uint32_t* questionBubbleStart{nullptr};
+			const float* markX{nullptr};
+			const float* markY{nullptr};
+			const float* bubbleLeft{nullptr};
+			const float* bubbleTop{nullptr};
+			const float* bubbleRight{nullptr};
+			const float* bubbleBottom{nullptr};
+			const uint32_t* bubbleQuestion{nullptr};
+			const uint32_t* bubbleAnswer{nullptr};
+			const uint32_t* answerText{nullptr};
+			//Every string in the layout, each terminated by a null character. Strings are referred to by their offset into this block.
+			const char* strings{nullptr};
+			uint32_t stringsSize{0};
+			uint32_t titleOffset{0};
+		};
+
+		Views views_{};
+	};
+
+}
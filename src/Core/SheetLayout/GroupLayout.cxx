@@ -4,16 +4,19 @@
 #include <algorithm>
 
 namespace {
-	static std::ostringstream tlOss;
-	static TextLogging tlog;
+	thread_local std::ostringstream tlOss;
+	thread_local TextLogging tlog;
 }
 
 EasyGrade::GroupLayout::GroupLayout() = default;
 EasyGrade::GroupLayout::~GroupLayout() = default;
 
-EasyGrade::GroupLayout::GroupLayout(const GroupLayout& other) {
+EasyGrade::GroupLayout::GroupLayout(LayoutArena* arena) : arena_(arena) {}
+
+EasyGrade::GroupLayout::GroupLayout(const GroupLayout& other, LayoutArena* arena) : arena_(arena) {
 	name_ = other.getName();
-	for(int i = 0; i < other.numChildren(); i++) {
+	questions_.reserve(other.numChildren());
+	for(size_t i = 0; i < other.numChildren(); i++) {
 		addQuestion(other.questionAt(i));
 	}
 }
@@ -24,8 +27,7 @@ int EasyGrade::GroupLayout::removeChild(SheetLayoutElement * sheetLayoutElement)
 	//Iterate over all of the questions in reverse order (so that deletions don't change the indices of children that haven't been checked yet
 	for(int i = numChildren() - 1; i >= 0; i--) {
 		if(static_cast<SheetLayoutElement*>(questionAt(i)) == sheetLayoutElement) {
-			tlOss << "Removing question " << *questionAt(i) << " from question group " << *this << "\"";
-			tlog.debug(__FILE__, __LINE__, tlOss);
+			TLOG_DEBUG(tlog, tlOss, "Removing question " << *questionAt(i) << " from question group " << *this << "\"");
 			//If this is the child being searched for, remove it and set the return status acordingly
 			questions_.erase(questions_.begin() + i);
 			if(status > 0) {
@@ -62,17 +64,33 @@ void EasyGrade::GroupLayout::setName(const std::string & name) {
 }
 
 void EasyGrade::GroupLayout::addQuestion(const QuestionLayout* question) {
-	//Search through the list of questions to find the position where this one belongs (or until the end of the list is found)
-	size_t i = 0;
-	while(i < numChildren() && *question > *questions_[i]) {
-		i++;
+	insertQuestion(makeElement<QuestionLayout>(arena_, *question, arena_));
+}
+
+EasyGrade::QuestionLayout* EasyGrade::GroupLayout::addQuestion(std::unique_ptr<QuestionLayout> question) {
+	return insertQuestion(adoptElement(std::move(question)));
+}
+
+EasyGrade::QuestionLayout* EasyGrade::GroupLayout::newQuestion(int questionNumber) {
+	ElementPtr<QuestionLayout> question = makeElement<QuestionLayout>(arena_, arena_);
+	question->setQuestionNumber(questionNumber);
+	return insertQuestion(std::move(question));
+}
+
+EasyGrade::QuestionLayout* EasyGrade::GroupLayout::insertQuestion(ElementPtr<QuestionLayout> question) {
+	//Search backwards from the end of the list of questions to find the position where this one belongs (before any questions with the
+	//same number). Questions are usually added in order, in which case this stops straight away.
+	size_t i = numChildren();
+	while(i > 0 && !(*question > *questions_[i - 1])) {
+		i--;
 	}
 	//Insert the new question
-	questions_.insert(questions_.begin() + i, std::make_unique<QuestionLayout>(*question));
+	questions_.insert(questions_.begin() + i, std::move(question));
 
 	// Set the parent of the new question
 	questionAt(i)->setParent(this);
 
+	return questionAt(i);
 }
 
 EasyGrade::QuestionLayout* EasyGrade::GroupLayout::questionAt(size_t index) {
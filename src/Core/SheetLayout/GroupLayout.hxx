@@ -11,7 +11,18 @@ namespace EasyGrade {
 	class GroupLayout : public SheetLayoutElement {
 	public:
 		GroupLayout();
-		GroupLayout(const GroupLayout& other);
+
+		///
+		/// <summary> Create a question group layout whose questions (and their bubbles) are allocated from an arena </summary>
+		/// <param name="arena"> The arena to allocate questions from. May be null, in which case each question is allocated on its own. </param>
+		///
+		GroupLayout(LayoutArena* arena);
+
+		///
+		/// <summary> Copy a question group layout, allocating the copies of its questions from an arena </summary>
+		/// <param name="arena"> The arena to allocate questions from. May be null, in which case each question is allocated on its own. </param>
+		///
+		GroupLayout(const GroupLayout& other, LayoutArena* arena = nullptr);
 		~GroupLayout();
 
 		///
@@ -54,6 +65,20 @@ namespace EasyGrade {
 		///
 		void addQuestion(const QuestionLayout* question);
 
+		///
+		/// <summary> Add a question layout to this question group, taking ownership of it rather than copying it </summary>
+		/// <param name="question"> The question to add </param>
+		/// <returns> A pointer to the added question </returns>
+		///
+		QuestionLayout* addQuestion(std::unique_ptr<QuestionLayout> question);
+
+		///
+		/// <summary> Add a new question without any bubbles to this question group, allocated from the group's arena </summary>
+		/// <param name="questionNumber"> The number of the new question </param>
+		/// <returns> A pointer to the added question </returns>
+		///
+		QuestionLayout* newQuestion(int questionNumber);
+
 		///
 		/// <summary> Get a pointer to the i'th question in this group </summary>
 		/// <param name="index"> The index of the question to get </param>
@@ -110,8 +135,14 @@ namespace EasyGrade {
 		std::unique_ptr<SheetLayoutElement> clonePtr() const;
 	private:
 		std::string name_{};
-		std::vector<std::unique_ptr<QuestionLayout>> questions_{};
+		///
+		/// <summary> Insert a question in order of question number </summary>
+		///
+		QuestionLayout* insertQuestion(ElementPtr<QuestionLayout> question);
+
+		std::vector<ElementPtr<QuestionLayout>> questions_{};
 		SheetLayoutElement* parent_{nullptr};
+		LayoutArena* arena_{nullptr};
 	};
 
 }
\ No newline at end of file
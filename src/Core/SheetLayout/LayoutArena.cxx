@@ -0,0 +1,32 @@
+#include "LayoutArena.hxx"
+
+EasyGrade::LayoutArena::LayoutArena() = default;
+EasyGrade::LayoutArena::~LayoutArena() = default;
+
+void* EasyGrade::LayoutArena::allocate(size_t size, size_t alignment) {
+	//Round the start of the allocation up to the requested alignment. Blocks themselves are allocated with new[], which aligns them for any type.
+	size_t offset = (blockUsed_ + alignment - 1) & ~(alignment - 1);
+
+	if(blocks_.empty() || offset + size > blockSize_) {
+		blockSize_ = size > BLOCK_SIZE ? size : BLOCK_SIZE;
+		//The block is left uninitialized, since every element constructs itself
+		blocks_.push_back(std::unique_ptr<unsigned char[]>(new unsigned char[blockSize_]));
+		offset = 0;
+	}
+
+	blockUsed_ = offset + size;
+	bytesAllocated_ += size;
+
+	return blocks_.back().get() + offset;
+}
+
+void EasyGrade::LayoutArena::release() {
+	blocks_.clear();
+	blockUsed_ = 0;
+	blockSize_ = 0;
+	bytesAllocated_ = 0;
+}
+
+size_t EasyGrade::LayoutArena::bytesAllocated() const {
+	return bytesAllocated_;
+}
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <utility>
+#include <vector>
+
+namespace EasyGrade {
+
+	///
+	/// <summary> Allocates sheet layout elements one after another in large blocks. The elements of a layout end up next to each other in memory,
+	///           in the order they were created, and the memory of the whole layout is given back in one step rather than element by element. </summary>
+	///
+	/// <note> Memory is only given back when the arena is released or destroyed, so an element removed from a layout leaves a gap until then.
+	///        Every element allocated from the arena must have been destroyed before then. </note>
+	///
+	class LayoutArena {
+	public:
+		LayoutArena();
+		~LayoutArena();
+
+		LayoutArena(const LayoutArena&) = delete;
+		LayoutArena& operator=(const LayoutArena&) = delete;
+
+		///
+		/// <summary> Allocate uninitialized memory from the arena </summary>
+		///
+		/// <param name="size"> The number of bytes to allocate </param>
+		/// <param name="alignment"> The alignment of the memory. Must be a power of two no larger than alignof(std::max_align_t). </param>
+		///
+		void* allocate(size_t size, size_t alignment);
+
+		///
+		/// <summary> Give back all of the memory allocated from the arena </summary>
+		///
+		void release();
+
+		///
+		/// <summary> Get the number of bytes allocated from the arena since it was last released </summary>
+		///
+		size_t bytesAllocated() const;
+
+	private:
+		//Size of the blocks memory is allocated from. Anything larger than this gets a block to itself.
+		static constexpr size_t BLOCK_SIZE = 64 * 1024;
+
+		std::vector<std::unique_ptr<unsigned char[]>> blocks_{};
+		//How much of the last block has been used, and how large it is
+		size_t blockUsed_{0};
+		size_t blockSize_{0};
+		size_t bytesAllocated_{0};
+	};
+
+	///
+	/// <summary> Deletes a sheet layout element: freeing it if it was allocated on its own, or only destroying it if it lives in a LayoutArena </summary>
+	///
+	template<typename T>
+	struct ElementDeleter {
+		bool isInArena{false};
+
+		void operator()(T* element) const {
+			if(isInArena) {
+				element->~T();
+			} else {
+				delete element;
+			}
+		}
+	};
+
+	///
+	/// <summary> Owning pointer to a sheet layout element that may or may not live in a LayoutArena </summary>
+	///
+	template<typename T>
+	using ElementPtr = std::unique_ptr<T, ElementDeleter<T>>;
+
+	///
+	/// <summary> Create a sheet layout element in an arena, or on its own if there is no arena </summary>
+	///
+	/// <param name="arena"> The arena to create the element in. May be null. </param>
+	/// <param name="args"> The arguments to construct the element with </param>
+	///
+	template<typename T, typename... Args>
+	ElementPtr<T> makeElement(LayoutArena* arena, Args&&... args) {
+		if(arena == nullptr) {
+			return ElementPtr<T>(new T(std::forward<Args>(args)...), ElementDeleter<T>{false});
+		}
+		void* memory = arena->allocate(sizeof(T), alignof(T));
+		return ElementPtr<T>(new(memory) T(std::forward<Args>(args)...), ElementDeleter<T>{true});
+	}
+
+	///
+	/// <summary> Take ownership of a sheet layout element that was allocated on its own </summary>
+	///
+	template<typename T>
+	ElementPtr<T> adoptElement(std::unique_ptr<T> element) {
+		return ElementPtr<T>(element.release(), ElementDeleter<T>{false});
+	}
+
+}
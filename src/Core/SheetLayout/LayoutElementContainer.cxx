@@ -18,7 +18,7 @@ void EasyGrade::LayoutElementContainer::remove(size_t index) {
 
 void EasyGrade::LayoutElementContainer::remove(const SheetLayoutElement* element) {
 	//Iterate over all of the layout elements until the desired one is found and delete it
-	for(std::vector<std::unique_ptr<SheetLayoutElement> >::iterator& it = layoutElements_.begin(); it != layoutElements_.end(); it++) {
+	for(std::vector<std::unique_ptr<SheetLayoutElement> >::iterator it = layoutElements_.begin(); it != layoutElements_.end(); it++) {
 		if(it->get() == element) {
 			layoutElements_.erase(it);
 			//Note: it is important to break the loop after removing the element, as all iterators into a vector may become invalid when it is modified.
@@ -42,3 +42,16 @@ size_t EasyGrade::LayoutElementContainer::size() const {
 bool EasyGrade::LayoutElementContainer::empty() const {
 	return layoutElements_.empty();
 }
+
+const EasyGrade::SpatialIndex& EasyGrade::LayoutElementContainer::spatialIndex() const {
+	return spatialIndex_;
+}
+
+void EasyGrade::LayoutElementContainer::refreshSpatialIndex() {
+	std::vector<Rectangle> boxes;
+	boxes.reserve(size());
+	for(const auto& layoutElement : layoutElements_) {
+		boxes.push_back(layoutElement->boundingBox());
+	}
+	spatialIndex_.build(boxes);
+}
@@ -12,6 +12,7 @@
 #include <vector>
 
 #include "SheetLayoutElement.hxx"
+#include "SpatialIndex.hxx"
 
 namespace EasyGrade {
 
@@ -53,10 +54,23 @@ namespace EasyGrade {
 		///
 		bool empty() const;
 
+		///
+		/// <summary> Get the spatial index of the bounding boxes of the elements in this container. Elements are identified by their index in this container. </summary>
+		///
+		/// <note> The spatial index is not updated as elements are added, removed or moved, it has to be refreshed with refreshSpatialIndex() </note>
+		///
+		const SpatialIndex& spatialIndex() const;
+
+		///
+		/// <summary> Rebuild the spatial index of the elements in this container </summary>
+		///
+		void refreshSpatialIndex();
+
 		//TODO: implement an iterator that traverses all of the elements in this container AND their children
 
 	private:
 		std::vector<std::unique_ptr<SheetLayoutElement> > layoutElements_;
+		SpatialIndex spatialIndex_{};
 	};
 
 }
\ No newline at end of file
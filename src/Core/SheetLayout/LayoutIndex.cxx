@@ -0,0 +1,140 @@
+#include "LayoutIndex.hxx"
+#include "ScanSheetLayout.hxx"
+
+EasyGrade::LayoutIndex::LayoutIndex() = default;
+EasyGrade::LayoutIndex::~LayoutIndex() = default;
+
+void EasyGrade::LayoutIndex::build(const ScanSheetLayout& layout) {
+	clear();
+
+	sideQuestionStart_.reserve(layout.numSides() + 1);
+	sideBubbleStart_.reserve(layout.numSides() + 1);
+	sideBubbleGrids_.resize(layout.numSides());
+
+	for(size_t i = 0; i < layout.numSides(); i++) {
+		const SideLayout* side = layout.sideLayout(i);
+		sideQuestionStart_.push_back(questions_.size());
+		sideBubbleStart_.push_back(bubbles_.size());
+
+		for(size_t j = 0; j < side->numChildren(); j++) {
+			const GroupLayout* group = side->groupAt(j);
+			for(size_t k = 0; k < group->numChildren(); k++) {
+				const QuestionLayout* question = group->questionAt(k);
+				questions_.push_back(question);
+				questionBubbleStart_.push_back(bubbles_.size());
+
+				for(size_t l = 0; l < question->numChildren(); l++) {
+					bubbles_.push_back(question->bubbleAt(l));
+				}
+			}
+		}
+
+		std::vector<Rectangle> boxes;
+		boxes.reserve(bubbles_.size() - sideBubbleStart_.back());
+		for(size_t j = sideBubbleStart_.back(); j < bubbles_.size(); j++) {
+			boxes.push_back(bubbles_[j]->boundingBox());
+		}
+		sideBubbleGrids_[i].build(boxes);
+	}
+
+	sideQuestionStart_.push_back(questions_.size());
+	sideBubbleStart_.push_back(bubbles_.size());
+	questionBubbleStart_.push_back(bubbles_.size());
+}
+
+void EasyGrade::LayoutIndex::clear() {
+	questions_.clear();
+	bubbles_.clear();
+	sideQuestionStart_.clear();
+	sideBubbleStart_.clear();
+	questionBubbleStart_.clear();
+	sideBubbleGrids_.clear();
+}
+
+size_t EasyGrade::LayoutIndex::numSides() const {
+	return sideBubbleStart_.empty() ? 0 : sideBubbleStart_.size() - 1;
+}
+
+size_t EasyGrade::LayoutIndex::numQuestions() const {
+	return questions_.size();
+}
+
+size_t EasyGrade::LayoutIndex::numBubbles() const {
+	return bubbles_.size();
+}
+
+const EasyGrade::QuestionLayout* EasyGrade::LayoutIndex::questionAt(size_t questionIndex) const {
+	const QuestionLayout* question = nullptr;
+	if(questionIndex < numQuestions()) {
+		question = questions_[questionIndex];
+	}
+	return question;
+}
+
+const EasyGrade::BubbleLayout* EasyGrade::LayoutIndex::bubbleAt(size_t bubbleIndex) const {
+	const BubbleLayout* bubble = nullptr;
+	if(bubbleIndex < numBubbles()) {
+		bubble = bubbles_[bubbleIndex];
+	}
+	return bubble;
+}
+
+size_t EasyGrade::LayoutIndex::questionFirstBubble(size_t questionIndex) const {
+	return questionBubbleStart_[questionIndex];
+}
+
+size_t EasyGrade::LayoutIndex::questionEndBubble(size_t questionIndex) const {
+	return questionBubbleStart_[questionIndex + 1];
+}
+
+size_t EasyGrade::LayoutIndex::firstQuestion(size_t sideNumber) const {
+	return sideQuestionStart_[sideNumber];
+}
+
+size_t EasyGrade::LayoutIndex::endQuestion(size_t sideNumber) const {
+	return sideQuestionStart_[sideNumber + 1];
+}
+
+size_t EasyGrade::LayoutIndex::firstBubble(size_t sideNumber) const {
+	return sideBubbleStart_[sideNumber];
+}
+
+size_t EasyGrade::LayoutIndex::endBubble(size_t sideNumber) const {
+	return sideBubbleStart_[sideNumber + 1];
+}
+
+EasyGrade::ElementRange<EasyGrade::QuestionLayout> EasyGrade::LayoutIndex::questions() const {
+	return ElementRange<QuestionLayout>(questions_.data(), questions_.data() + questions_.size());
+}
+
+EasyGrade::ElementRange<EasyGrade::BubbleLayout> EasyGrade::LayoutIndex::bubbles() const {
+	return ElementRange<BubbleLayout>(bubbles_.data(), bubbles_.data() + bubbles_.size());
+}
+
+EasyGrade::ElementRange<EasyGrade::QuestionLayout> EasyGrade::LayoutIndex::sideQuestions(size_t sideNumber) const {
+	return ElementRange<QuestionLayout>(questions_.data() + firstQuestion(sideNumber), questions_.data() + endQuestion(sideNumber));
+}
+
+EasyGrade::ElementRange<EasyGrade::BubbleLayout> EasyGrade::LayoutIndex::sideBubbles(size_t sideNumber) const {
+	return ElementRange<BubbleLayout>(bubbles_.data() + firstBubble(sideNumber), bubbles_.data() + endBubble(sideNumber));
+}
+
+EasyGrade::ElementRange<EasyGrade::BubbleLayout> EasyGrade::LayoutIndex::questionBubbles(size_t questionIndex) const {
+	return ElementRange<BubbleLayout>(bubbles_.data() + questionFirstBubble(questionIndex), bubbles_.data() + questionEndBubble(questionIndex));
+}
+
+const EasyGrade::SpatialIndex& EasyGrade::LayoutIndex::sideBubbleGrid(size_t sideNumber) const {
+	return sideBubbleGrids_[sideNumber];
+}
+
+const EasyGrade::BubbleLayout* EasyGrade::LayoutIndex::bubbleContaining(size_t sideNumber, float x, float y) const {
+	const BubbleLayout* bubble = nullptr;
+	if(sideNumber < numSides()) {
+		std::vector<size_t> ids;
+		sideBubbleGrid(sideNumber).queryPoint(x, y, ids);
+		if(!ids.empty()) {
+			bubble = bubbles_[firstBubble(sideNumber) + ids.front()];
+		}
+	}
+	return bubble;
+}
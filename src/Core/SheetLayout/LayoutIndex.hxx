@@ -0,0 +1,177 @@
+#pragma once
+
+#include <cstddef>
+#include <iterator>
+#include <vector>
+
+#include "SideLayout.hxx"
+#include "SpatialIndex.hxx"
+
+namespace EasyGrade {
+
+	class ScanSheetLayout;
+
+	///
+	/// <summary> A run of sheet layout elements of one type (e.g. every bubble of a question), stored one after another in a LayoutIndex </summary>
+	///
+	template<typename T>
+	class ElementRange {
+	public:
+		class iterator {
+		public:
+			//Type aliases required for C++ iterator standard
+			using iterator_category = std::random_access_iterator_tag;
+			using value_type = T;
+			using difference_type = std::ptrdiff_t;
+			using pointer = const T*;
+			using reference = const T&;
+
+			iterator() = default;
+			explicit iterator(const T* const* position) : position_(position) {}
+
+			reference operator*() const { return **position_; }
+			pointer operator->() const { return *position_; }
+			reference operator[](difference_type n) const { return *position_[n]; }
+
+			iterator& operator++() { ++position_; return *this; }
+			iterator operator++(int) { iterator old = *this; ++position_; return old; }
+			iterator& operator--() { --position_; return *this; }
+			iterator operator--(int) { iterator old = *this; --position_; return old; }
+			iterator& operator+=(difference_type n) { position_ += n; return *this; }
+			iterator& operator-=(difference_type n) { position_ -= n; return *this; }
+
+			friend iterator operator+(iterator it, difference_type n) { return it += n; }
+			friend iterator operator+(difference_type n, iterator it) { return it += n; }
+			friend iterator operator-(iterator it, difference_type n) { return it -= n; }
+			friend difference_type operator-(const iterator& lhs, const iterator& rhs) { return lhs.position_ - rhs.position_; }
+
+			friend bool operator==(const iterator& lhs, const iterator& rhs) { return lhs.position_ == rhs.position_; }
+			friend bool operator!=(const iterator& lhs, const iterator& rhs) { return lhs.position_ != rhs.position_; }
+			friend bool operator<(const iterator& lhs, const iterator& rhs) { return lhs.position_ < rhs.position_; }
+			friend bool operator>(const iterator& lhs, const iterator& rhs) { return lhs.position_ > rhs.position_; }
+			friend bool operator<=(const iterator& lhs, const iterator& rhs) { return lhs.position_ <= rhs.position_; }
+			friend bool operator>=(const iterator& lhs, const iterator& rhs) { return lhs.position_ >= rhs.position_; }
+		private:
+			const T* const* position_{nullptr};
+		};
+
+		ElementRange() = default;
+		ElementRange(const T* const* first, const T* const* last) : first_(first), last_(last) {}
+
+		iterator begin() const { return iterator(first_); }
+		iterator end() const { return iterator(last_); }
+		size_t size() const { return static_cast<size_t>(last_ - first_); }
+		bool empty() const { return first_ == last_; }
+
+		///
+		/// <summary> Get an element of the range. The index is not checked. </summary>
+		///
+		const T& operator[](size_t index) const { return *first_[index]; }
+
+	private:
+		const T* const* first_{nullptr};
+		const T* const* last_{nullptr};
+	};
+
+	///
+	/// <summary> Flat, read-only index of the questions and bubbles of a sheet layout, in layout order (side, group, question, bubble). Finding
+	///           the nth bubble, the bubbles of a question or the bubbles of a side takes constant time, and visiting them is a walk along an array
+	///           rather than down the layout tree. </summary>
+	///
+	/// <note> The index holds pointers into the layout it was built from, so it has to be rebuilt whenever questions or bubbles are added to
+	///        or removed from that layout. The spatial index of each side holds copies of its bubbles' bounding boxes, so it also has to be
+	///        rebuilt after a bubble is moved or resized; until then, sideBubbleGrid() and bubbleContaining() answer for the old positions. </note>
+	///
+	class LayoutIndex {
+	public:
+		LayoutIndex();
+		~LayoutIndex();
+
+		///
+		/// <summary> Index a sheet layout, replacing whatever this index held before </summary>
+		///
+		void build(const ScanSheetLayout& layout);
+
+		///
+		/// <summary> Empty this index </summary>
+		///
+		void clear();
+
+		size_t numSides() const;
+		size_t numQuestions() const;
+		size_t numBubbles() const;
+
+		///
+		/// <summary> Get a question by its position in the layout, counting from the first question of the first side </summary>
+		/// <returns> A pointer to the question, or a null pointer if the index is out of range </returns>
+		///
+		const QuestionLayout* questionAt(size_t questionIndex) const;
+
+		///
+		/// <summary> Get a bubble by its position in the layout, counting from the first bubble of the first side </summary>
+		/// <returns> A pointer to the bubble, or a null pointer if the index is out of range </returns>
+		///
+		const BubbleLayout* bubbleAt(size_t bubbleIndex) const;
+
+		///
+		/// <summary> Get the index of the first bubble of a question. The question's bubbles run up to (but not including) the first bubble of the next question. </summary>
+		///
+		size_t questionFirstBubble(size_t questionIndex) const;
+		size_t questionEndBubble(size_t questionIndex) const;
+
+		///
+		/// <summary> Get the index of the first question on a side. The side's questions run up to (but not including) the first question of the next side. </summary>
+		///
+		size_t firstQuestion(size_t sideNumber) const;
+		size_t endQuestion(size_t sideNumber) const;
+
+		///
+		/// <summary> Get the index of the first bubble on a side. The side's bubbles run up to (but not including) the first bubble of the next side. </summary>
+		///
+		size_t firstBubble(size_t sideNumber) const;
+		size_t endBubble(size_t sideNumber) const;
+
+		ElementRange<QuestionLayout> questions() const;
+		ElementRange<BubbleLayout> bubbles() const;
+
+		///
+		/// <summary> Get the questions or bubbles on one side. The side number is not checked. </summary>
+		///
+		ElementRange<QuestionLayout> sideQuestions(size_t sideNumber) const;
+		ElementRange<BubbleLayout> sideBubbles(size_t sideNumber) const;
+
+		///
+		/// <summary> Get the bubbles of one question. The question index is not checked. </summary>
+		///
+		ElementRange<BubbleLayout> questionBubbles(size_t questionIndex) const;
+
+		///
+		/// <summary> Get the spatial index of the bubbles on one side, for finding bubbles by position. Bubbles are identified by their position
+		///           on the side, i.e. the bubble with id i is sideBubbles(sideNumber)[i]. The side number is not checked. </summary>
+		///
+		const SpatialIndex& sideBubbleGrid(size_t sideNumber) const;
+
+		///
+		/// <summary> Find the bubble on a side that contains a point </summary>
+		///
+		/// <param name="sideNumber"> The side to search </param>
+		/// <param name="x"> The x coordinate of the point, in normalized coordinates </param>
+		/// <param name="y"> The y coordinate of the point, in normalized coordinates </param>
+		///
+		/// <returns> A pointer to the first bubble in layout order that contains the point, or a null pointer if there is none (or no such side) </returns>
+		///
+		const BubbleLayout* bubbleContaining(size_t sideNumber, float x, float y) const;
+
+	private:
+		std::vector<const QuestionLayout*> questions_{};
+		std::vector<const BubbleLayout*> bubbles_{};
+
+		//Each *Start array has one more element than there are parents; the children of parent i run from start[i] to start[i + 1]
+		std::vector<size_t> sideQuestionStart_{};
+		std::vector<size_t> sideBubbleStart_{};
+		std::vector<size_t> questionBubbleStart_{};
+
+		std::vector<SpatialIndex> sideBubbleGrids_{};
+	};
+
+}
@@ -5,16 +5,19 @@
 #include "QuestionLayout.hxx"
 
 namespace {
-	static std::ostringstream tlOss;
-	static TextLogging tlog;
+	thread_local std::ostringstream tlOss;
+	thread_local TextLogging tlog;
 }
 
 
 EasyGrade::QuestionLayout::QuestionLayout() = default;
 EasyGrade::QuestionLayout::~QuestionLayout() = default;
-EasyGrade::QuestionLayout::QuestionLayout(const QuestionLayout& other) {
+EasyGrade::QuestionLayout::QuestionLayout(LayoutArena* arena) : arena_(arena) {}
+
+EasyGrade::QuestionLayout::QuestionLayout(const QuestionLayout& other, LayoutArena* arena) : arena_(arena) {
 	questionNumber_ = other.getQuestionNumber();
-	for(int i = 0; i < other.numChildren(); i++) {
+	bubbles_.reserve(other.numChildren());
+	for(size_t i = 0; i < other.numChildren(); i++) {
 		addBubble(other.bubbleAt(i));
 	}
 }
@@ -25,8 +28,7 @@ int EasyGrade::QuestionLayout::removeChild(SheetLayoutElement* sheetLayoutElemen
 	//Iterate over all of the bubbles in reverse order (so that deletions don't change the indices of children that haven't been checked yet
 	for(int i = numChildren() - 1; i >= 0; i--) {
 		if(static_cast<SheetLayoutElement*>(bubbleAt(i)) == sheetLayoutElement) {
-			tlOss << "Removing bubble " << *bubbleAt(i) << " from question " << *this << "\"";
-			tlog.debug(__FILE__, __LINE__, tlOss);
+			TLOG_DEBUG(tlog, tlOss, "Removing bubble " << *bubbleAt(i) << " from question " << *this << "\"");
 			//If this is the child being searched for, remove it and set the return status acordingly
 			bubbles_.erase(bubbles_.begin() + i);
 			if(status > 0) {
@@ -36,8 +38,7 @@ int EasyGrade::QuestionLayout::removeChild(SheetLayoutElement* sheetLayoutElemen
 	}
 
 	if(status == 1) {
-		tlOss << "No bubbles on question " << *this << " match the element to be removed";
-		tlog.critical(__FILE__, __LINE__, tlOss);
+		TLOG_CRITICAL(tlog, tlOss, "No bubbles on question " << *this << " match the element to be removed");
 	}
 
 	return status;
@@ -71,11 +72,23 @@ void EasyGrade::QuestionLayout::setQuestionNumber(const int questionNumber) {
 }
 
 void EasyGrade::QuestionLayout::addBubble(const BubbleLayout* bubble) {
-	bubbles_.push_back(std::make_unique<BubbleLayout>(*bubble));
+	bubbles_.push_back(makeElement<BubbleLayout>(arena_, *bubble));
 	//Set the parent of the new bubble to this question
 	bubbles_.back()->setParent(this);
 }
 
+EasyGrade::BubbleLayout* EasyGrade::QuestionLayout::addBubble(std::unique_ptr<BubbleLayout> bubble) {
+	bubbles_.push_back(adoptElement(std::move(bubble)));
+	bubbles_.back()->setParent(this);
+	return bubbles_.back().get();
+}
+
+EasyGrade::BubbleLayout* EasyGrade::QuestionLayout::newBubble() {
+	bubbles_.push_back(makeElement<BubbleLayout>(arena_));
+	bubbles_.back()->setParent(this);
+	return bubbles_.back().get();
+}
+
 EasyGrade::BubbleLayout* EasyGrade::QuestionLayout::bubbleAt(size_t index) {
 	BubbleLayout* bubble = nullptr;
 	if(index < numChildren()) {
@@ -120,6 +133,6 @@ bool EasyGrade::QuestionLayout::operator>(const QuestionLayout & rhs) const {
 	return questionNumber_ > rhs.getQuestionNumber();
 }
 
-bool EasyGrade::CompareQuestionPtr::operator()(const std::unique_ptr<QuestionLayout>& lhs, const std::unique_ptr<QuestionLayout>& rhs) {
+bool EasyGrade::CompareQuestionPtr::operator()(const ElementPtr<QuestionLayout>& lhs, const ElementPtr<QuestionLayout>& rhs) {
 	return *lhs < *rhs;
 }
@@ -2,6 +2,7 @@
 
 #include "SheetLayoutElement.hxx"
 #include "BubbleLayout.hxx"
+#include "LayoutArena.hxx"
 
 #include <vector>
 
@@ -10,7 +11,18 @@ namespace EasyGrade {
 	class QuestionLayout : public SheetLayoutElement {
 	public:
 		QuestionLayout();
-		QuestionLayout(const QuestionLayout& other);
+
+		///
+		/// <summary> Create a question layout whose bubbles are allocated from an arena </summary>
+		/// <param name="arena"> The arena to allocate bubbles from. May be null, in which case each bubble is allocated on its own. </param>
+		///
+		QuestionLayout(LayoutArena* arena);
+
+		///
+		/// <summary> Copy a question layout, allocating the copies of its bubbles from an arena </summary>
+		/// <param name="arena"> The arena to allocate bubbles from. May be null, in which case each bubble is allocated on its own. </param>
+		///
+		QuestionLayout(const QuestionLayout& other, LayoutArena* arena = nullptr);
 		~QuestionLayout();
 
 		///
@@ -53,6 +65,19 @@ namespace EasyGrade {
 		///
 		void addBubble(const BubbleLayout* bubble);
 
+		///
+		/// <summary> Add a bubble to this question layout, taking ownership of it rather than copying it </summary>
+		/// <param name="bubble"> The bubble to add </param>
+		/// <returns> A pointer to the added bubble </returns>
+		///
+		BubbleLayout* addBubble(std::unique_ptr<BubbleLayout> bubble);
+
+		///
+		/// <summary> Add a new, blank bubble to this question layout, allocated from the question's arena </summary>
+		/// <returns> A pointer to the added bubble </returns>
+		///
+		BubbleLayout* newBubble();
+
 		///
 		/// <summary> Get a pointer to one of the bubble layouts owned by this question by its index </summary>
 		/// <param name="index"> The index of the bubble to get. In general, bubbles are not stored in any particular order </param>
@@ -102,13 +127,14 @@ namespace EasyGrade {
 		bool operator>(const QuestionLayout& rhs) const;
 	private:
 		int questionNumber_{-1};
-		std::vector<std::unique_ptr<BubbleLayout>> bubbles_{};
+		std::vector<ElementPtr<BubbleLayout>> bubbles_{};
 		SheetLayoutElement* parent_{nullptr};
+		LayoutArena* arena_{nullptr};
 	};
 
 	//Predicate used to sort unique_ptrs to QuestionLayouts
 	struct CompareQuestionPtr {
-		bool operator()(const std::unique_ptr<QuestionLayout>& lhs, const std::unique_ptr<QuestionLayout>& rhs);
+		bool operator()(const ElementPtr<QuestionLayout>& lhs, const ElementPtr<QuestionLayout>& rhs);
 	};
 
 }
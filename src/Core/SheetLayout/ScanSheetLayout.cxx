@@ -1,4 +1,8 @@
 
+#include <cerrno>
+#include <cmath>
+#include <cstdlib>
+#include <limits>
 #include <sstream>
 
 #include "pugixml.hpp"
@@ -7,8 +11,64 @@
 #include "TextLogging.hxx"
 
 namespace {
-	std::ostringstream tlOss;
-	TextLogging tlog;
+	thread_local std::ostringstream tlOss;
+	thread_local TextLogging tlog;
+
+	///
+	/// <summary> A bubble attribute naming one of the bubble's edges, and the setter for that edge </summary>
+	///
+	struct BubbleEdge {
+		const char* name;
+		void (EasyGrade::BubbleLayout::*set)(float);
+	};
+
+	//The edges are set in this order, since setting an edge only moves that edge
+	const BubbleEdge BUBBLE_EDGES[] = {
+		{"left", &EasyGrade::BubbleLayout::setLeftEdge},
+		{"top", &EasyGrade::BubbleLayout::setTopEdge},
+		{"right", &EasyGrade::BubbleLayout::setRightEdge},
+		{"bottom", &EasyGrade::BubbleLayout::setBottomEdge}
+	};
+
+	///
+	/// <summary> Read an attribute as a finite number. Unlike pugi::xml_attribute::as_float(), attributes that are empty or have anything after the
+	///           number are rejected rather than read as whatever prefix of them is a number. </summary>
+	///
+	/// <returns> Integer status code. Negative if the attribute is missing or malformed, non-negative if no error occured. </returns>
+	///
+	int parseFloat(const pugi::xml_attribute& attr, float& value) {
+		int status = -1;
+		if(attr) {
+			const char* str = attr.value();
+			char* end = nullptr;
+			const float parsed = std::strtof(str, &end);
+			if(end != str && *end == '\0' && std::isfinite(parsed)) {
+				value = parsed;
+				status = 0;
+			}
+		}
+		return status;
+	}
+
+	///
+	/// <summary> Read an attribute as an integer, rejecting attributes that are empty, have anything after the number or are out of range </summary>
+	///
+	/// <returns> Integer status code. Negative if the attribute is missing or malformed, non-negative if no error occured. </returns>
+	///
+	int parseInt(const pugi::xml_attribute& attr, int& value) {
+		int status = -1;
+		if(attr) {
+			const char* str = attr.value();
+			char* end = nullptr;
+			errno = 0;
+			const long parsed = std::strtol(str, &end, 10);
+			if(end != str && *end == '\0' && errno == 0 && parsed >= std::numeric_limits<int>::min() && parsed <= std::numeric_limits<int>::max()) {
+				value = static_cast<int>(parsed);
+				status = 0;
+			}
+		}
+		return status;
+	}
 }
 
 EasyGrade::ScanSheetLayout::ScanSheetLayout() = default;
@@ -32,6 +92,13 @@ void EasyGrade::ScanSheetLayout::writeXml(std::ostream& os) {
 			sideNode.append_attribute("bg-image") = side.getReferenceImageFilename().c_str();
 		}
 
+		//Add nodes for each alignment mark
+		for(const AlignmentMark& alignmentMark : side.getAlignmentMarks()) {
+			pugi::xml_node markNode = sideNode.append_child("alignment-mark");
+			markNode.append_attribute("x") = alignmentMark.x;
+			markNode.append_attribute("y") = alignmentMark.y;
+		}
+
 		//Add nodes for each question group
 		for(size_t i = 0; i < side.numChildren(); i++) {
 			const GroupLayout* group_ptr = side.groupAt(i);
@@ -84,12 +151,10 @@ int EasyGrade::ScanSheetLayout::readXml(std::istream& is) {
 	pugi::xml_document doc;
 	pugi::xml_parse_result result = doc.load(is);
 	if(result) {
-		tlOss << "Successfully parsed XML from stream";
-		tlog.debug(__FILE__, __LINE__, tlOss);
+		TLOG_DEBUG(tlog, tlOss, "Successfully parsed XML from stream");
 	} else {
 		status = -1;
-		tlOss << "Failed to parse XML from input stream. PugiXML error message: " << result.description();
-		tlog.critical(__FILE__, __LINE__, tlOss);
+		TLOG_CRITICAL(tlog, tlOss, "Failed to parse XML from input stream. PugiXML error message: " << result.description());
 	}
 
 	//Load sheet title
@@ -99,8 +164,7 @@ int EasyGrade::ScanSheetLayout::readXml(std::istream& is) {
 		sheetNode = doc.first_child();
 		if(std::string(sheetNode.name()) != "sheet") {
 			status = -1;
-			tlOss << "Failed to read sheet layout. XML document does not appear to be a template. Root node type: \"" << sheetNode.name() << "\"";
-			tlog.critical(__FILE__, __LINE__, tlOss);
+			TLOG_CRITICAL(tlog, tlOss, "Failed to read sheet layout. XML document does not appear to be a template. Root node type: \"" << sheetNode.name() << "\"");
 		}
 	}
 
@@ -111,8 +175,7 @@ int EasyGrade::ScanSheetLayout::readXml(std::istream& is) {
 			title_ = sheetTitleAttr.value();
 		} else {
 			title_ = "";
-			tlOss << "XML sheet layout does not have a name.";
-			tlog.warning(__FILE__, __LINE__, tlOss);
+			TLOG_WARNING(tlog, tlOss, "XML sheet layout does not have a name.");
 		}
 	}
 
@@ -120,142 +183,131 @@ int EasyGrade::ScanSheetLayout::readXml(std::istream& is) {
 
 	if(status >= 0 && !sheetNode.child("side")) {
 		status = 1;
-		tlOss << "XML sheet layout does not contain any side layouts.";
-		tlog.warning(__FILE__, __LINE__, tlOss);
+		TLOG_WARNING(tlog, tlOss, "XML sheet layout does not contain any side layouts.");
 	}
 
 	if(status == 0) {
+		//Count the sides first so that the side layouts never have to be moved as more are added
+		size_t numSideNodes = 0;
+		for(pugi::xml_node sideNode = sheetNode.child("side"); sideNode; sideNode = sideNode.next_sibling("side")) {
+			numSideNodes++;
+		}
+		sheetSides_.reserve(numSideNodes);
+
+		//Each element is built where it will stay: sides in place in the list of sides, and everything else in this layout's arena, in the
+		//order it appears in the XML, handed to its parent as soon as it is created rather than being copied in once it is complete
 		for(pugi::xml_node sideNode = sheetNode.child("side"); sideNode; sideNode = sideNode.next_sibling("side")) {
 
 			//Create a side layout with the appropriate side number
-			SideLayout currentSide(sheetSides_.size());
+			sheetSides_.emplace_back(static_cast<int>(sheetSides_.size()), &arena_);
+			SideLayout& currentSide = sheetSides_.back();
 
 			//Set background image (if one is specified)
-			pugi::xml_attribute bgImageAttr;
-			bgImageAttr = sideNode.attribute("bg-image");
+			pugi::xml_attribute bgImageAttr = sideNode.attribute("bg-image");
 			if(bgImageAttr) {
 				currentSide.setReferenceImageFilename(bgImageAttr.value());
 			}
 
+			//Add alignment marks to side layout
+			for(pugi::xml_node markNode = sideNode.child("alignment-mark"); markNode; markNode = markNode.next_sibling("alignment-mark")) {
+				AlignmentMark alignmentMark;
+				if(parseFloat(markNode.attribute("x"), alignmentMark.x) >= 0 && parseFloat(markNode.attribute("y"), alignmentMark.y) >= 0) {
+					currentSide.addAlignmentMark(alignmentMark);
+				} else {
+					status = -1;
+					TLOG_CRITICAL(tlog, tlOss, "Side " << currentSide.getSideNumber() << " of \"" << title_ << "\" has an alignment mark with missing or malformed x and y coordinates");
+				}
+			}
+
 			//Add question groups to side layout
 			for(pugi::xml_node groupNode = sideNode.child("group"); groupNode; groupNode = groupNode.next_sibling("group")) {
 
-				//Create a new QuestionGroupLayout to be populated and then added to the SheetLayout.
-				GroupLayout currentQuestionGroup;
+				GroupLayout* currentQuestionGroup = currentSide.newGroup();
 
 				//Set question group name
 				pugi::xml_attribute groupNameAttr = groupNode.attribute("name");
 				if(groupNameAttr) {
-					currentQuestionGroup.setName(groupNameAttr.value());
+					currentQuestionGroup->setName(groupNameAttr.value());
 				} else {
-					status = 1;
-					tlOss << "Encountered a question group without a name attribute in XML sheet layout \"" << title_ << "\"";
-					tlog.warning(__FILE__, __LINE__, tlOss);
+					//Only a warning, so don't hide any error found earlier
+					if(status == 0) {
+						status = 1;
+					}
+					TLOG_WARNING(tlog, tlOss, "Encountered a question group without a name attribute in XML sheet layout \"" << title_ << "\"");
 				}
 
 				//Iterate over all of the questions on this group in the XML and add a question layout for each
 
 				if(!groupNode.child("question")) {
-					tlOss << "Question group \"" << currentQuestionGroup.getName() << "\" does not contain any questions.";
-					tlog.warning(__FILE__, __LINE__, tlOss);
+					TLOG_WARNING(tlog, tlOss, "Question group \"" << currentQuestionGroup->getName() << "\" does not contain any questions.");
 				}
 
 				for(pugi::xml_node questionNode = groupNode.child("question"); questionNode; questionNode = questionNode.next_sibling("question")) {
-					QuestionLayout currentQuestion;
-
-					//If the question number is specified, use that. If not, it should be 1 more than the previous one in the group, unless this is the first question in the group, in which case it should be 0.
+					//If the question number is specified, use that. If not, it should be 1 more than the previous one in the group, unless this is the first question in the group, in which case it should be 1.
+					int questionNumber = -1;
 					pugi::xml_attribute questionNumberAttr = questionNode.attribute("number");
 					if(questionNumberAttr) {
-						currentQuestion.setQuestionNumber(questionNumberAttr.as_int());
+						if(parseInt(questionNumberAttr, questionNumber) < 0) {
+							status = -1;
+							TLOG_CRITICAL(tlog, tlOss, "Question group \"" << currentQuestionGroup->getName() << "\" has a question with a malformed number: \"" << questionNumberAttr.value() << "\"");
+						}
 					} else {
-						if(currentQuestionGroup.numChildren() == 0) {
-							currentQuestion.setQuestionNumber(1);
+						if(currentQuestionGroup->numChildren() == 0) {
+							questionNumber = 1;
 						} else {
 							//Note that, because the questions in the XML are always sorted, the previous question will always have the current max question number.
-							currentQuestion.setQuestionNumber(currentQuestionGroup.maxQuestionNumber() + 1);
+							questionNumber = currentQuestionGroup->maxQuestionNumber() + 1;
 						}
 					}
 
+					//The group keeps its questions sorted, so the question is only added once its number is known
+					QuestionLayout* currentQuestion = currentQuestionGroup->newQuestion(questionNumber);
+
 					//Iterate over all of the bubbles on this question in the XML and add a bubble layout for each
 
 					if(!questionNode.child("bubble")) {
-						status = 1;
-						tlOss << "Question " << currentQuestion.getQuestionNumber() << " in \"" << currentQuestionGroup.getName() << "\" does not contain any bubbles.";
-						tlog.critical(__FILE__, __LINE__, tlOss);
+						if(status == 0) {
+							status = 1;
+						}
+						TLOG_CRITICAL(tlog, tlOss, "Question " << currentQuestion->getQuestionNumber() << " in \"" << currentQuestionGroup->getName() << "\" does not contain any bubbles.");
 					}
 
 					for(pugi::xml_node bubbleNode = questionNode.child("bubble"); bubbleNode; bubbleNode = bubbleNode.next_sibling("bubble")) {
-						struct BubbleLayout currentBubble;
+						BubbleLayout* currentBubble = currentQuestion->newBubble();
 
 						//Set bubble name
 						pugi::xml_attribute bubbleContentAttr = bubbleNode.attribute("content");
 						if(bubbleContentAttr) {
-							currentBubble.setAnswer(bubbleContentAttr.value());
-						} else {
-							status = -1;
-							tlOss << "Question " << currentQuestion.getQuestionNumber() << " in \"" << currentQuestionGroup.getName() << "\" has a bubble that does not specify its answer";
-							tlog.critical(__FILE__, __LINE__, tlOss);
-						}
-
-						//Set bubble left bound
-						pugi::xml_attribute bubbleLeftAttr = bubbleNode.attribute("left");
-						if(bubbleLeftAttr) {
-							currentBubble.setLeftEdge(bubbleLeftAttr.as_float(-1.0));
-						} else {
-							status = -1;
-							tlOss << "Question " << currentQuestion.getQuestionNumber() << " in \"" << currentQuestionGroup.getName() << "\" has a bubble that does not specify its left coordinate";
-							tlog.critical(__FILE__, __LINE__, tlOss);
-						}
-
-						//Set bubble top bound
-						pugi::xml_attribute bubbleTopAttr = bubbleNode.attribute("top");
-						if(bubbleTopAttr) {
-							currentBubble.setTopEdge(bubbleTopAttr.as_float(-1.0));
+							currentBubble->setAnswer(bubbleContentAttr.value());
 						} else {
 							status = -1;
-							tlOss << "Question " << currentQuestion.getQuestionNumber() << " in \"" << currentQuestionGroup.getName() << "\" has a bubble that does not specify its top coordinate";
-							tlog.critical(__FILE__, __LINE__, tlOss);
+							TLOG_CRITICAL(tlog, tlOss, "Question " << currentQuestion->getQuestionNumber() << " in \"" << currentQuestionGroup->getName() << "\" has a bubble that does not specify its answer");
 						}
 
-						//Set bubble right bound
-						pugi::xml_attribute bubbleRightAttr = bubbleNode.attribute("right");
-						if(bubbleRightAttr) {
-							currentBubble.setRightEdge(bubbleRightAttr.as_float(-1.0));
-						} else {
-							status = -1;
-							tlOss << "Question " << currentQuestion.getQuestionNumber() << " in \"" << currentQuestionGroup.getName() << "\" has a bubble that does not specify its right coordinate";
-							tlog.critical(__FILE__, __LINE__, tlOss);
-						}
-
-						//Set bubble bottom bound
-						pugi::xml_attribute bubbleBottomAttr = bubbleNode.attribute("bottom");
-						if(bubbleBottomAttr) {
-							currentBubble.setBottomEdge(bubbleBottomAttr.as_float(-1.0));
-						} else {
-							status = -1;
-							tlOss << "Question " << currentQuestion.getQuestionNumber() << " in \"" << currentQuestionGroup.getName() << "\" has a bubble that does not specify its bottom coordinate";
-							tlog.critical(__FILE__, __LINE__, tlOss);
+						//Set bubble bounds
+						for(const BubbleEdge& edge : BUBBLE_EDGES) {
+							pugi::xml_attribute edgeAttr = bubbleNode.attribute(edge.name);
+							float coordinate = 0;
+							if(parseFloat(edgeAttr, coordinate) >= 0) {
+								(currentBubble->*edge.set)(coordinate);
+							} else if(edgeAttr) {
+								status = -1;
+								TLOG_CRITICAL(tlog, tlOss, "Question " << currentQuestion->getQuestionNumber() << " in \"" << currentQuestionGroup->getName() << "\" has a bubble with a malformed " << edge.name << " coordinate: \"" << edgeAttr.value() << "\"");
+							} else {
+								status = -1;
+								TLOG_CRITICAL(tlog, tlOss, "Question " << currentQuestion->getQuestionNumber() << " in \"" << currentQuestionGroup->getName() << "\" has a bubble that does not specify its " << edge.name << " coordinate");
+							}
 						}
-
-						//Add bubble to question
-						currentQuestion.addBubble(&currentBubble);
 					}
-
-					//Add question to group
-					currentQuestionGroup.addQuestion(&currentQuestion);
 				}
-
-				//Add group to sheet
-				currentSide.addGroup(&currentQuestionGroup);
 			}
-			//Add side layout to sheet
-			sheetSides_.push_back(currentSide);
 		}
 	}
 
+	refreshIndex();
+
 	if(status >= 0) {
-		tlOss << "Successfully parsed sheet layout from XML";
-		tlog.info(__FILE__, __LINE__, tlOss);
+		TLOG_INFO(tlog, tlOss, "Successfully parsed sheet layout from XML");
 	}
 
 	return status;
@@ -263,7 +315,10 @@ int EasyGrade::ScanSheetLayout::readXml(std::istream& is) {
 
 void EasyGrade::ScanSheetLayout::reset() {
 	title_ = "";
+	index_.clear();
+	//The sides have to be destroyed before the memory their elements live in is given back
 	sheetSides_.clear();
+	arena_.release();
 }
 
 EasyGrade::SideLayout* EasyGrade::ScanSheetLayout::sideLayout(int sideNumber) {
@@ -274,15 +329,24 @@ EasyGrade::SideLayout* EasyGrade::ScanSheetLayout::sideLayout(int sideNumber) {
 	return side;
 }
 
+const EasyGrade::SideLayout* EasyGrade::ScanSheetLayout::sideLayout(int sideNumber) const {
+	const SideLayout* side = nullptr;
+	if(sideNumber < numSides()) {
+		side = &sheetSides_[sideNumber];
+	}
+	return side;
+}
+
 void EasyGrade::ScanSheetLayout::newSide() {
-	sheetSides_.push_back(SideLayout(numSides()));
+	sheetSides_.emplace_back(static_cast<int>(numSides()), &arena_);
+	refreshIndex();
 }
 
-size_t EasyGrade::ScanSheetLayout::numSides() {
+size_t EasyGrade::ScanSheetLayout::numSides() const {
 	return sheetSides_.size();
 }
 
-const std::string& EasyGrade::ScanSheetLayout::getTitle() {
+const std::string& EasyGrade::ScanSheetLayout::getTitle() const {
 	return title_;
 }
 
@@ -290,6 +354,14 @@ void EasyGrade::ScanSheetLayout::setTitle(const std::string & title) {
 	title_ = title;
 }
 
+const EasyGrade::LayoutIndex& EasyGrade::ScanSheetLayout::index() const {
+	return index_;
+}
+
+void EasyGrade::ScanSheetLayout::refreshIndex() {
+	index_.build(*this);
+}
+
 EasyGrade::ScanSheetLayout::iterator EasyGrade::ScanSheetLayout::begin() {
 	return ScanSheetLayout::iterator(*this, 0, -1, -1, -1);
 }
@@ -304,7 +376,19 @@ EasyGrade::ScanSheetLayout::iterator EasyGrade::ScanSheetLayout::end() {
 ///////////////////////////////////////////////////////
 
 EasyGrade::ScanSheetLayout::iterator::iterator(ScanSheetLayout& scanSheet, int sideIndex, int groupIndex, int questionIndex, int bubbleIndex) :
-	scanSheet_(scanSheet), sideIndex_(sideIndex), groupIndex_(groupIndex), questionIndex_(questionIndex), bubbleIndex_(bubbleIndex) {
+	scanSheet_(&scanSheet) {
+	//Walk down to the requested element once, so that every later step can start from the cached side, group and question
+	enterSide(sideIndex);
+	if(side_ != nullptr && groupIndex >= 0) {
+		enterGroup(groupIndex);
+		if(group_ != nullptr && questionIndex >= 0) {
+			enterQuestion(questionIndex);
+			if(question_ != nullptr && bubbleIndex >= 0) {
+				bubbleIndex_ = bubbleIndex;
+			}
+		}
+	}
+	updateTarget();
 }
 
 EasyGrade::SheetLayoutElement& EasyGrade::ScanSheetLayout::iterator::operator*() {
@@ -329,80 +413,168 @@ EasyGrade::ScanSheetLayout::iterator EasyGrade::ScanSheetLayout::iterator::opera
 	return old;
 }
 
+EasyGrade::ScanSheetLayout::iterator EasyGrade::ScanSheetLayout::iterator::operator--(int) {
+	ScanSheetLayout::iterator old = *this;
+	--*this;
+	return old;
+}
+
 EasyGrade::ScanSheetLayout::iterator& EasyGrade::ScanSheetLayout::iterator::operator++() {
 	//A negative index indicates that this iterator points to the parent of that level. e.g. if bubbleIndex is negative but questionIndex is not, this iterator points to a questionIndex.
+	//Each step moves to the first child of the current element if it has one, and otherwise to whatever follows it.
 
-	if(sideIndex_ >= scanSheet_.numSides()) {
+	if(side_ == nullptr) {
 		//If the iterator is already past the end of the tree, don't keep advancing it.
-		tlOss << "Tried to advance scan sheet layout iterator that is already at the end of the layout tree";
-		tlog.debug(__FILE__, __LINE__, tlOss);
+		TLOG_DEBUG(tlog, tlOss, "Tried to advance scan sheet layout iterator that is already at the end of the layout tree");
 	} else if(groupIndex_ < 0) {
-		//iterator points to a side layout, and should now point to its first question group
-		groupIndex_ = 0;
+		//Iterator points to a side layout
+		if(side_->numChildren() > 0) {
+			enterGroup(0);
+		} else {
+			nextSide();
+		}
 	} else if(questionIndex_ < 0) {
-		//Iterator points to a group layout, and should now point to its first question
-		questionIndex_ = 0;
+		//Iterator points to a group layout
+		if(group_->numChildren() > 0) {
+			enterQuestion(0);
+		} else {
+			nextGroup();
+		}
 	} else if(bubbleIndex_ < 0) {
-		//Iterator points to a question layout, and should now point to its first bubble
-		bubbleIndex_ = 0;
-	} else {
-		//Iterator points to a bubble layout, and should now point to the next bubble
+		//Iterator points to a question layout
+		if(question_->numChildren() > 0) {
+			bubbleIndex_ = 0;
+		} else {
+			nextQuestion();
+		}
+	} else if(bubbleIndex_ + 1 < static_cast<int>(question_->numChildren())) {
+		//Iterator points to a bubble layout that is not the last of its question
 		bubbleIndex_++;
+	} else {
+		nextQuestion();
 	}
 
-	//If any indeces have overflowed (e.g. if bubbleIndex is greater than the number of bubbles in the current QuestionLayout), reset them and advance the next index.
-	//Note: checking that the parent index is not negative first prevents accessing a null parent. Checking that the current index is not negative prevents accessing a parent before the parent index
-	//      has been checked for overflow; this prevents accessing a null parent if there are no parents. (e.g. questionIndex was just set to 0, but this group has no questions)
+	updateTarget();
+	return *this;
+}
+
+EasyGrade::ScanSheetLayout::iterator& EasyGrade::ScanSheetLayout::iterator::operator--() {
+	//Each step moves to the last descendant of the previous sibling of the current element if it has one, and otherwise to its parent
 
-	//Check if bubbleIndex has overflowed
-	if(questionIndex_ >= 0 && bubbleIndex_ >= 0 && bubbleIndex_ >= scanSheet_.sideLayout(sideIndex_)->groupAt(groupIndex_)->questionAt(questionIndex_)->numChildren()) {
-		bubbleIndex_ = -1;
-		questionIndex_++;
+	if(side_ == nullptr) {
+		//Iterator is at the end, and should now point to the last element in the tree
+		if(scanSheet_->numSides() > 0) {
+			enterSide(static_cast<int>(scanSheet_->numSides()) - 1);
+			enterLastDescendant();
+		} else {
+			TLOG_DEBUG(tlog, tlOss, "Tried to move scan sheet layout iterator back from the end of an empty layout tree");
+		}
+	} else if(bubbleIndex_ >= 0) {
+		//Iterator points to a bubble layout, and should now point to the previous bubble or to its question
+		bubbleIndex_--;
+	} else if(questionIndex_ >= 0) {
+		if(questionIndex_ > 0) {
+			enterQuestion(questionIndex_ - 1);
+			enterLastDescendant();
+		} else {
+			enterGroup(groupIndex_);
+		}
+	} else if(groupIndex_ >= 0) {
+		if(groupIndex_ > 0) {
+			enterGroup(groupIndex_ - 1);
+			enterLastDescendant();
+		} else {
+			enterSide(sideIndex_);
+		}
+	} else if(sideIndex_ > 0) {
+		enterSide(sideIndex_ - 1);
+		enterLastDescendant();
+	} else {
+		TLOG_DEBUG(tlog, tlOss, "Tried to move scan sheet layout iterator back from the start of the layout tree");
 	}
 
-	//Check if questionIndex has overflowed
-	if(groupIndex_ >= 0 && questionIndex_ >= 0 && questionIndex_ >= scanSheet_.sideLayout(sideIndex_)->groupAt(groupIndex_)->numChildren()) {
-		bubbleIndex_ = -1;
-		questionIndex_ = -1;
-		groupIndex_++;
+	updateTarget();
+	return *this;
+}
+
+void EasyGrade::ScanSheetLayout::iterator::enterSide(int sideIndex) {
+	//Side indices past the last side are left alone; an iterator with a sideIndex 1 past the last one is intended to be used as the "end" iterator
+	sideIndex_ = sideIndex;
+	groupIndex_ = -1;
+	questionIndex_ = -1;
+	bubbleIndex_ = -1;
+	side_ = scanSheet_->sideLayout(sideIndex);
+	group_ = nullptr;
+	question_ = nullptr;
+}
+
+void EasyGrade::ScanSheetLayout::iterator::enterGroup(int groupIndex) {
+	groupIndex_ = groupIndex;
+	questionIndex_ = -1;
+	bubbleIndex_ = -1;
+	group_ = side_->groupAt(groupIndex);
+	question_ = nullptr;
+}
+
+void EasyGrade::ScanSheetLayout::iterator::enterQuestion(int questionIndex) {
+	questionIndex_ = questionIndex;
+	bubbleIndex_ = -1;
+	question_ = group_->questionAt(questionIndex);
+}
+
+void EasyGrade::ScanSheetLayout::iterator::nextQuestion() {
+	if(questionIndex_ + 1 < static_cast<int>(group_->numChildren())) {
+		enterQuestion(questionIndex_ + 1);
+	} else {
+		nextGroup();
 	}
+}
 
-	//Check if groupIndex has overflowed. sideIndex is never negative
-	if(groupIndex_ >= 0 && groupIndex_ >= scanSheet_.sideLayout(sideIndex_)->numChildren()) {
-		bubbleIndex_ = -1;
-		questionIndex_ = -1;
-		groupIndex_ = -1;
-		sideIndex_++;
+void EasyGrade::ScanSheetLayout::iterator::nextGroup() {
+	if(groupIndex_ + 1 < static_cast<int>(side_->numChildren())) {
+		enterGroup(groupIndex_ + 1);
+	} else {
+		nextSide();
 	}
+}
 
-	//Overflows of sideIndex are left alone; an iterator with a sideIndex 1 past the last one is intended to be used as the "end" iterator
+void EasyGrade::ScanSheetLayout::iterator::nextSide() {
+	enterSide(sideIndex_ + 1);
+}
+
+void EasyGrade::ScanSheetLayout::iterator::enterLastDescendant() {
+	if(groupIndex_ < 0 && side_->numChildren() > 0) {
+		enterGroup(static_cast<int>(side_->numChildren()) - 1);
+	}
+	if(groupIndex_ >= 0 && questionIndex_ < 0 && group_->numChildren() > 0) {
+		enterQuestion(static_cast<int>(group_->numChildren()) - 1);
+	}
+	if(questionIndex_ >= 0 && bubbleIndex_ < 0 && question_->numChildren() > 0) {
+		bubbleIndex_ = static_cast<int>(question_->numChildren()) - 1;
+	}
+}
 
-	//Set target to the appropriate value
-	if(sideIndex_ >= scanSheet_.numSides()) {
+void EasyGrade::ScanSheetLayout::iterator::updateTarget() {
+	if(side_ == nullptr) {
 		//Iterator has reached end, target is null
 		target_ = nullptr;
-	} else if(groupIndex_ < 0) {
-		//Iterator now points to a side layout
-		target_ = scanSheet_.sideLayout(sideIndex_);
-	} else if(questionIndex_ < 0) {
-		//Iterator now points to a group layout
-		target_ = scanSheet_.sideLayout(sideIndex_)->groupAt(groupIndex_);
+	} else if(group_ == nullptr) {
+		target_ = side_;
+	} else if(question_ == nullptr) {
+		target_ = group_;
 	} else if(bubbleIndex_ < 0) {
-		//Iterator now points to a question layout
-		target_ = scanSheet_.sideLayout(sideIndex_)->groupAt(groupIndex_)->questionAt(questionIndex_);
+		target_ = question_;
 	} else {
-		//Iterator now points to a bubble layout
-		target_ = scanSheet_.sideLayout(sideIndex_)->groupAt(groupIndex_)->questionAt(questionIndex_)->bubbleAt(bubbleIndex_);
+		target_ = question_->bubbleAt(bubbleIndex_);
 	}
-	return *this;
 }
 
 bool EasyGrade::operator==(const ScanSheetLayout::iterator& lhs, const ScanSheetLayout::iterator& rhs) {
-	return &lhs.scanSheet_ == &rhs.scanSheet_ &&
+	return lhs.scanSheet_ == rhs.scanSheet_ &&
 		lhs.sideIndex_ == rhs.sideIndex_ &&
 		lhs.groupIndex_ == rhs.groupIndex_ &&
 		lhs.questionIndex_ == rhs.questionIndex_ &&
-		lhs.bubbleIndex_ == lhs.bubbleIndex_;
+		lhs.bubbleIndex_ == rhs.bubbleIndex_;
 }
 
 bool EasyGrade::operator!=(const ScanSheetLayout::iterator& lhs, const ScanSheetLayout::iterator& rhs) {
@@ -4,6 +4,8 @@
 #include <vector>
 
 #include "SideLayout.hxx"
+#include "LayoutArena.hxx"
+#include "LayoutIndex.hxx"
 
 namespace EasyGrade {
 
@@ -12,19 +14,32 @@ namespace EasyGrade {
 		ScanSheetLayout();
 		~ScanSheetLayout();
 
+		///
+		/// <summary> Visits every element of a sheet layout depth first: each side, then each of its groups, each question of a group and each
+		///           bubble of a question, in order </summary>
+		///
+		/// <note> The iterator keeps pointers to the side, group and question it is in, so stepping it only looks at the elements next to it
+		///        rather than walking down from the top of the layout. Adding or removing elements invalidates it. </note>
+		///
 		class iterator {
 		public:
 			//Type aliases required for C++ iterator standard
-			using iterator_category = std::forward_iterator_tag;
+			using iterator_category = std::bidirectional_iterator_tag;
 			using value_type = SheetLayoutElement;
-			using difference_type = size_t;
+			using difference_type = std::ptrdiff_t;
 			using pointer = SheetLayoutElement * ;
 			using reference = SheetLayoutElement & ;
 
+			///
+			/// <summary> Create an iterator pointing at an element of a layout. A negative index means the iterator points at the parent of that
+			///           level, e.g. a negative bubble index with a non-negative question index points at the question. </summary>
+			///
 			iterator(ScanSheetLayout& scanSheet, int sideIndex, int groupIndex, int questionIndex, int bubbleIndex);
 
 			ScanSheetLayout::iterator& operator++();
 			ScanSheetLayout::iterator operator++(int);
+			ScanSheetLayout::iterator& operator--();
+			ScanSheetLayout::iterator operator--(int);
 			SheetLayoutElement& operator*();
 			const SheetLayoutElement& operator*() const;
 			SheetLayoutElement* operator->();
@@ -32,15 +47,35 @@ namespace EasyGrade {
 			friend bool operator==(const ScanSheetLayout::iterator& lhs, const ScanSheetLayout::iterator& rhs);
 			friend bool operator!=(const ScanSheetLayout::iterator& lhs, const ScanSheetLayout::iterator& rhs);
 		private:
+			//Move to another side, group or question, pointing at it rather than at any of its children
+			void enterSide(int sideIndex);
+			void enterGroup(int groupIndex);
+			void enterQuestion(int questionIndex);
+
+			//Move past the last descendant of the current element, to whatever comes after it
+			void nextQuestion();
+			void nextGroup();
+			void nextSide();
+
+			//Move down to the last descendant of the current element
+			void enterLastDescendant();
+
+			void updateTarget();
+
 			//State variables used to keep track of where in the layout tree this index is
-			ScanSheetLayout& scanSheet_;
-			int sideIndex_;
-			int groupIndex_;
-			int questionIndex_;
-			int bubbleIndex_;
+			ScanSheetLayout* scanSheet_{nullptr};
+			int sideIndex_{-1};
+			int groupIndex_{-1};
+			int questionIndex_{-1};
+			int bubbleIndex_{-1};
+
+			//The side, group and question this iterator is in, or null for levels it is above
+			SideLayout* side_{nullptr};
+			GroupLayout* group_{nullptr};
+			QuestionLayout* question_{nullptr};
 
 			//Cache of the current sheet layout element, so that dereferencing this iterator is cheaper
-			SheetLayoutElement* target_;
+			SheetLayoutElement* target_{nullptr};
 		};
 
 		///
@@ -68,6 +103,13 @@ namespace EasyGrade {
 		///
 		SideLayout* sideLayout(int sideNumber);
 
+		///
+		/// <summary> Get the layout for one side of the scan sheet </summary>
+		/// <param name="sideNumber"> which side to get the layout for </param>
+		/// <returns> A pointer to the corrisponding side layout </returns>
+		///
+		const SideLayout* sideLayout(int sideNumber) const;
+
 		///
 		/// <summary> Add a new side layout to this scanner sheet layout </summary>
 		///
@@ -76,24 +118,44 @@ namespace EasyGrade {
 		///
 		/// <summary> Get the number of side on this sheet layout </summary>
 		///
-		size_t numSides();
+		size_t numSides() const;
 
 		///
 		/// <summary> Get the title of this sheet layout </summary>
 		///
-		const std::string& getTitle();
+		const std::string& getTitle() const;
 
 		///
 		/// <summary> Set the title of this sheet layout </summary>
 		///
 		void setTitle(const std::string& title);
 
+		///
+		/// <summary> Get the flat index of this layout's questions and bubbles, for finding e.g. the nth bubble or the bubbles of a question in
+		///           constant time </summary>
+		///
+		/// <note> The index is built when the layout is read and has to be refreshed with refreshIndex() after questions or bubbles are added to
+		///        or removed from the layout by any other means, and before looking bubbles up by position after any have moved. </note>
+		///
+		const LayoutIndex& index() const;
+
+		///
+		/// <summary> Rebuild the flat index of this layout's questions and bubbles </summary>
+		///
+		void refreshIndex();
+
 		ScanSheetLayout::iterator begin();
 		ScanSheetLayout::iterator end();
 
 	private:
 		std::string title_{};
+		//Every element read into this layout is allocated from here. It is declared before the sides so that it outlives them.
+		LayoutArena arena_{};
 		std::vector<SideLayout> sheetSides_{};
+		LayoutIndex index_{};
 	};
 
+	bool operator==(const ScanSheetLayout::iterator& lhs, const ScanSheetLayout::iterator& rhs);
+	bool operator!=(const ScanSheetLayout::iterator& lhs, const ScanSheetLayout::iterator& rhs);
+
 }
\ No newline at end of file
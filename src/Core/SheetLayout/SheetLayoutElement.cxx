@@ -4,8 +4,8 @@
 #include <sstream>
 
 namespace {
-	std::ostringstream tlOss;
-	TextLogging tlog;
+	thread_local std::ostringstream tlOss;
+	thread_local TextLogging tlog;
 }
 
 std::string EasyGrade::SheetLayoutElement::toString() const {
@@ -19,6 +19,8 @@ namespace EasyGrade {
 
 	class SheetLayoutElement {
 	public:
+		//Layout elements are owned and deleted through pointers to this interface (e.g. by LayoutElementContainer)
+		virtual ~SheetLayoutElement() = default;
 
 		///
 		/// <summary> Get a pointer to a child of this sheet layout element </summary>
@@ -5,21 +5,31 @@
 #include "SideLayout.hxx"
 
 namespace {
-	std::ostringstream tlOss;
-	TextLogging tlog;
+	thread_local std::ostringstream tlOss;
+	thread_local TextLogging tlog;
 }
 
 EasyGrade::SideLayout::SideLayout() = default;
 
-EasyGrade::SideLayout::SideLayout(int sideNumber) : sideNumber_(sideNumber) {}
+EasyGrade::SideLayout::SideLayout(int sideNumber, LayoutArena* arena) : sideNumber_(sideNumber), arena_(arena) {}
 
-EasyGrade::SideLayout::SideLayout(const SideLayout& other) : sideNumber_(other.getSideNumber()) {
+EasyGrade::SideLayout::SideLayout(const SideLayout& other, LayoutArena* arena) : sideNumber_(other.getSideNumber()), arena_(arena) {
 	referenceImage_ = other.getReferenceImageFilename();
-	for(int i = 0; i < other.numChildren(); i++) {
+	alignmentMarks_ = other.getAlignmentMarks();
+	questionGroups_.reserve(other.numChildren());
+	for(size_t i = 0; i < other.numChildren(); i++) {
 		addGroup(other.groupAt(i));
 	}
 }
 
+EasyGrade::SideLayout::SideLayout(SideLayout&& other) noexcept : sideNumber_(other.getSideNumber()), questionGroups_(std::move(other.questionGroups_)),
+	referenceImage_(std::move(other.referenceImage_)), alignmentMarks_(std::move(other.alignmentMarks_)), arena_(other.arena_) {
+	//The groups themselves don't move, but they now belong to this side layout
+	for(auto& group : questionGroups_) {
+		group->setParent(this);
+	}
+}
+
 EasyGrade::SideLayout::~SideLayout() = default;
 
 int EasyGrade::SideLayout::removeChild(SheetLayoutElement* sheetLayoutElement) {
@@ -29,8 +39,7 @@ int EasyGrade::SideLayout::removeChild(SheetLayoutElement* sheetLayoutElement) {
 	for(int i = numChildren() - 1; i >= 0; i--) {
 		if(static_cast<SheetLayoutElement*>(groupAt(i)) == sheetLayoutElement) {
 			//If this is the child being searched for, remove it and set the return status acordingly
-			tlOss << "Removing question group " << *groupAt(i) << " from side \"" << *this << "\"";
-			tlog.debug(__FILE__, __LINE__, tlOss);
+			TLOG_DEBUG(tlog, tlOss, "Removing question group " << *groupAt(i) << " from side \"" << *this << "\"");
 			questionGroups_.erase(questionGroups_.begin() + i);
 			if(status > 0) {
 				status = 0;
@@ -50,11 +59,23 @@ EasyGrade::Rectangle EasyGrade::SideLayout::boundingBox() const {
 }
 
 void EasyGrade::SideLayout::addGroup(const GroupLayout* questionGroup) {
-	questionGroups_.push_back(std::make_unique<GroupLayout>(*questionGroup));
+	questionGroups_.push_back(makeElement<GroupLayout>(arena_, *questionGroup, arena_));
 	//Set the parent of the newly added group to this side layout
 	questionGroups_.back()->setParent(this);
 }
 
+EasyGrade::GroupLayout* EasyGrade::SideLayout::addGroup(std::unique_ptr<GroupLayout> questionGroup) {
+	questionGroups_.push_back(adoptElement(std::move(questionGroup)));
+	questionGroups_.back()->setParent(this);
+	return questionGroups_.back().get();
+}
+
+EasyGrade::GroupLayout* EasyGrade::SideLayout::newGroup() {
+	questionGroups_.push_back(makeElement<GroupLayout>(arena_, arena_));
+	questionGroups_.back()->setParent(this);
+	return questionGroups_.back().get();
+}
+
 EasyGrade::GroupLayout* EasyGrade::SideLayout::groupAt(size_t index) {
 	GroupLayout* group = nullptr;
 	if(index < numChildren()) {
@@ -91,6 +112,18 @@ void EasyGrade::SideLayout::setReferenceImageFilename(const std::string& filenam
 	referenceImage_ = filename;
 }
 
+const std::vector<EasyGrade::AlignmentMark>& EasyGrade::SideLayout::getAlignmentMarks() const {
+	return alignmentMarks_;
+}
+
+void EasyGrade::SideLayout::addAlignmentMark(const AlignmentMark& alignmentMark) {
+	alignmentMarks_.push_back(alignmentMark);
+}
+
+void EasyGrade::SideLayout::clearAlignmentMarks() {
+	alignmentMarks_.clear();
+}
+
 void EasyGrade::SideLayout::print(std::ostream & os) const {
 	if(sideNumber_ < 0) {
 		os << "Unknown Side";
@@ -8,11 +8,35 @@
 
 namespace EasyGrade {
 
+	///
+	/// <summary> Where the center of one of the printed alignment (timing) marks is on a side, in normalized coordinates </summary>
+	///
+	struct AlignmentMark {
+		float x{0};
+		float y{0};
+	};
+
 	class SideLayout : public SheetLayoutElement {
 	public:
 		SideLayout();
-		SideLayout(int sideNumber);
-		SideLayout(const SideLayout& other);
+
+		///
+		/// <summary> Create a side layout whose question groups (and everything in them) are allocated from an arena </summary>
+		/// <param name="sideNumber"> The number of the side </param>
+		/// <param name="arena"> The arena to allocate question groups from. May be null, in which case each question group is allocated on its own. </param>
+		///
+		SideLayout(int sideNumber, LayoutArena* arena = nullptr);
+
+		///
+		/// <summary> Copy a side layout, allocating the copies of its question groups from an arena </summary>
+		/// <param name="arena"> The arena to allocate question groups from. May be null, in which case each question group is allocated on its own. </param>
+		///
+		SideLayout(const SideLayout& other, LayoutArena* arena = nullptr);
+
+		///
+		/// <summary> Take the question groups of another side layout without copying them </summary>
+		///
+		SideLayout(SideLayout&& other) noexcept;
 		~SideLayout();
 
 		///
@@ -37,6 +61,19 @@ namespace EasyGrade {
 		///
 		void addGroup(const GroupLayout* questionGroup);
 
+		///
+		/// <summary> Add a question group to this side layout, taking ownership of it rather than copying it </summary>
+		/// <param name="questionGroup"> The question group to add </param>
+		/// <returns> A pointer to the added question group </returns>
+		///
+		GroupLayout* addGroup(std::unique_ptr<GroupLayout> questionGroup);
+
+		///
+		/// <summary> Add a new, empty question group to this side layout, allocated from the side's arena </summary>
+		/// <returns> A pointer to the added question group </returns>
+		///
+		GroupLayout* newGroup();
+
 		///
 		/// <summary> Get a pointer to a question group layout on this side layout </summary>
 		/// <param name="index"> The index of the question group to get </param>
@@ -79,6 +116,22 @@ namespace EasyGrade {
 		///
 		void setReferenceImageFilename(const std::string& filename);
 
+		///
+		/// <summary> Get where the alignment marks are on this side. Used by alignment algorithms that map every mark onto the layout. </summary>
+		///
+		const std::vector<AlignmentMark>& getAlignmentMarks() const;
+
+		///
+		/// <summary> Add an alignment mark to this side layout </summary>
+		/// <param name="alignmentMark"> Where the center of the mark is, in normalized coordinates </param>
+		///
+		void addAlignmentMark(const AlignmentMark& alignmentMark);
+
+		///
+		/// <summary> Remove every alignment mark from this side layout </summary>
+		///
+		void clearAlignmentMarks();
+
 		///
 		/// <summary> Print a short description of this sheet side layout to an output stream </summary>
 		/// <param name="oss"> The output stream to print to </param>
@@ -95,8 +148,10 @@ namespace EasyGrade {
 		std::unique_ptr<SheetLayoutElement> clonePtr() const;
 	private:
 		const int sideNumber_{-1};
-		std::vector<std::unique_ptr<GroupLayout>> questionGroups_{};
+		std::vector<ElementPtr<GroupLayout>> questionGroups_{};
 		std::string referenceImage_{};
+		std::vector<AlignmentMark> alignmentMarks_{};
+		LayoutArena* arena_{nullptr};
 	};
 
 }
\ No newline at end of file
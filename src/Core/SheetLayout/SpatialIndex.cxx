@@ -0,0 +1,132 @@
+#include <algorithm>
+#include <cmath>
+
+#include "SpatialIndex.hxx"
+
+namespace {
+	//Upper limit on the number of cells along each side of the grid, so that a few far flung rectangles can't make the grid huge
+	constexpr int MAX_GRID_SIZE = 1024;
+}
+
+EasyGrade::SpatialIndex::SpatialIndex() = default;
+EasyGrade::SpatialIndex::~SpatialIndex() = default;
+
+void EasyGrade::SpatialIndex::build(const std::vector<Rectangle>& boxes) {
+	clear();
+
+	boxes_ = boxes;
+
+	//Cover every non-empty rectangle with the grid
+	Rectangle bounds;
+	size_t numBoxes = 0;
+	for(const Rectangle& box : boxes_) {
+		if(!box.empty()) {
+			bounds.combineUnion(box);
+			numBoxes++;
+		}
+	}
+
+	if(numBoxes > 0) {
+		//Aim for about one rectangle per cell, with cells about as tall as they are wide
+		const float aspect = bounds.getWidth() / bounds.getHeight();
+		const float gridSize = std::sqrt(static_cast<float>(numBoxes));
+		numColumns_ = std::min(std::max(static_cast<int>(std::ceil(gridSize * std::sqrt(aspect))), 1), MAX_GRID_SIZE);
+		numRows_ = std::min(std::max(static_cast<int>(std::ceil(gridSize / std::sqrt(aspect))), 1), MAX_GRID_SIZE);
+		left_ = bounds.getLeftEdge();
+		top_ = bounds.getTopEdge();
+		cellWidth_ = bounds.getWidth() / numColumns_;
+		cellHeight_ = bounds.getHeight() / numRows_;
+
+		//Count the rectangles overlapping each cell, then place them, so that every cell's list is contiguous
+		cellStart_.assign(static_cast<size_t>(numColumns_) * numRows_ + 1, 0);
+		for(const Rectangle& box : boxes_) {
+			if(!box.empty()) {
+				for(int y = row(box.getTopEdge()); y <= row(box.getBottomEdge()); y++) {
+					for(int x = column(box.getLeftEdge()); x <= column(box.getRightEdge()); x++) {
+						cellStart_[static_cast<size_t>(y) * numColumns_ + x + 1]++;
+					}
+				}
+			}
+		}
+		for(size_t i = 1; i < cellStart_.size(); i++) {
+			cellStart_[i] += cellStart_[i - 1];
+		}
+
+		std::vector<size_t> cellFill(cellStart_.begin(), cellStart_.end() - 1);
+		cellBoxes_.resize(cellStart_.back());
+		for(size_t i = 0; i < boxes_.size(); i++) {
+			const Rectangle& box = boxes_[i];
+			if(!box.empty()) {
+				for(int y = row(box.getTopEdge()); y <= row(box.getBottomEdge()); y++) {
+					for(int x = column(box.getLeftEdge()); x <= column(box.getRightEdge()); x++) {
+						cellBoxes_[cellFill[static_cast<size_t>(y) * numColumns_ + x]++] = i;
+					}
+				}
+			}
+		}
+	}
+}
+
+void EasyGrade::SpatialIndex::clear() {
+	boxes_.clear();
+	left_ = 0.0f;
+	top_ = 0.0f;
+	cellWidth_ = 1.0f;
+	cellHeight_ = 1.0f;
+	numColumns_ = 0;
+	numRows_ = 0;
+	cellStart_.clear();
+	cellBoxes_.clear();
+}
+
+size_t EasyGrade::SpatialIndex::size() const {
+	return boxes_.size();
+}
+
+void EasyGrade::SpatialIndex::query(const Rectangle& area, std::vector<size_t>& ids) const {
+	ids.clear();
+
+	if(numColumns_ > 0 && !area.empty()) {
+		for(int y = row(area.getTopEdge()); y <= row(area.getBottomEdge()); y++) {
+			for(int x = column(area.getLeftEdge()); x <= column(area.getRightEdge()); x++) {
+				const size_t cell = static_cast<size_t>(y) * numColumns_ + x;
+				for(size_t i = cellStart_[cell]; i < cellStart_[cell + 1]; i++) {
+					const Rectangle& box = boxes_[cellBoxes_[i]];
+					//A rectangle spanning several of the cells searched is only reported from one of them: the cell holding the top left corner of its
+					//overlap with the area
+					if(column(std::max(box.getLeftEdge(), area.getLeftEdge())) == x && row(std::max(box.getTopEdge(), area.getTopEdge())) == y &&
+					   area.doesIntersect(box)) {
+						ids.push_back(cellBoxes_[i]);
+					}
+				}
+			}
+		}
+		std::sort(ids.begin(), ids.end());
+	}
+}
+
+void EasyGrade::SpatialIndex::queryPoint(float x, float y, std::vector<size_t>& ids) const {
+	ids.clear();
+
+	if(numColumns_ > 0) {
+		const size_t cell = static_cast<size_t>(row(y)) * numColumns_ + column(x);
+		for(size_t i = cellStart_[cell]; i < cellStart_[cell + 1]; i++) {
+			const Rectangle& box = boxes_[cellBoxes_[i]];
+			if(x >= box.getLeftEdge() && x < box.getRightEdge() && y >= box.getTopEdge() && y < box.getBottomEdge()) {
+				ids.push_back(cellBoxes_[i]);
+			}
+		}
+		//Cells list their rectangles in ascending order already
+	}
+}
+
+int EasyGrade::SpatialIndex::column(float x) const {
+	//Clamp before converting to an integer, so that coordinates far outside of the grid (or NaN) can't overflow
+	const float position = std::floor((x - left_) / cellWidth_);
+	return position >= 0.0f ? static_cast<int>(std::min(position, static_cast<float>(numColumns_ - 1))) : 0;
+}
+
+int EasyGrade::SpatialIndex::row(float y) const {
+	const float position = std::floor((y - top_) / cellHeight_);
+	return position >= 0.0f ? static_cast<int>(std::min(position, static_cast<float>(numRows_ - 1))) : 0;
+}
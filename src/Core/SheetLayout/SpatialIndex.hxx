@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include "Rectangle.hxx"
+
+namespace EasyGrade {
+
+	///
+	/// <summary> Uniform grid over a set of rectangles (e.g. the bounding boxes of bubbles), for finding the rectangles that overlap an area or
+	///           contain a point without testing every one of them. Rectangles are identified by their position in the list the index was built
+	///           from. </summary>
+	///
+	/// <note> The grid has about as many cells as there are rectangles, so a query only looks at the rectangles near it. The index does not
+	///        follow changes to the rectangles it was built from; it has to be rebuilt when they move, are added or are removed. </note>
+	///
+	class SpatialIndex {
+	public:
+		SpatialIndex();
+		~SpatialIndex();
+
+		///
+		/// <summary> Index a list of rectangles, replacing whatever this index held before. Empty rectangles are never found by queries. </summary>
+		///
+		/// <param name="boxes"> The rectangles to index. Each is identified by its position in this list. </param>
+		///
+		void build(const std::vector<Rectangle>& boxes);
+
+		///
+		/// <summary> Empty this index </summary>
+		///
+		void clear();
+
+		///
+		/// <summary> Get the number of rectangles this index was built from </summary>
+		///
+		size_t size() const;
+
+		///
+		/// <summary> Find every rectangle that intersects an area, in the same sense as Rectangle::doesIntersect() </summary>
+		///
+		/// <param name="area"> The area to search </param>
+		/// <param name="ids"> Output parameter in which the positions of the rectangles that were found are placed, in ascending order </param>
+		///
+		void query(const Rectangle& area, std::vector<size_t>& ids) const;
+
+		///
+		/// <summary> Find every rectangle that contains a point. Rectangles contain their left and top edges but not their right and bottom edges. </summary>
+		///
+		/// <param name="x"> The x coordinate of the point </param>
+		/// <param name="y"> The y coordinate of the point </param>
+		/// <param name="ids"> Output parameter in which the positions of the rectangles that were found are placed, in ascending order </param>
+		///
+		void queryPoint(float x, float y, std::vector<size_t>& ids) const;
+
+	private:
+		//Get the column or row of the cell that a coordinate falls in. Coordinates outside of the grid are put in the nearest cell.
+		int column(float x) const;
+		int row(float y) const;
+
+		std::vector<Rectangle> boxes_{};
+
+		//Area covered by the grid, and the size of each cell
+		float left_{0.0f};
+		float top_{0.0f};
+		float cellWidth_{1.0f};
+		float cellHeight_{1.0f};
+		int numColumns_{0};
+		int numRows_{0};
+
+		//The rectangles overlapping cell i (cells are numbered row by row) are cellBoxes_[cellStart_[i]] to cellBoxes_[cellStart_[i + 1] - 1]
+		std::vector<size_t> cellStart_{};
+		std::vector<size_t> cellBoxes_{};
+	};
+
+}
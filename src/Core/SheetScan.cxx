@@ -1,13 +1,18 @@
 
+#include <algorithm>
+#include <complex>
+#include <limits>
 #include <sstream>
-#include <QDebug>
+
+#include <opencv2/core/hal/intrin.hpp>
 
 #include "SheetScan.hxx"
+#include "ThresholdKernel.hxx"
 #include "TextLogging.hxx"
 
 namespace {
-	std::ostringstream tlOss;
-	TextLogging tlog;
+	thread_local std::ostringstream tlOss;
+	thread_local TextLogging tlog;
 }
 
 SheetScan::SheetScan() = default;
@@ -16,39 +21,97 @@ SheetScan::~SheetScan() = default;
 SheetScan::SheetScan(const SheetScan& other) {
 	sheetImage_ = other.sheetImage_.clone();
 	annotatedImage_ = other.annotatedImage_.clone();
+	isAnnotationEnabled_ = other.isAnnotationEnabled_;
 	processedImageCache_ = other.processedImageCache_.clone();
+	layoutTransform_ = other.layoutTransform_.clone();
+	decodedChannel_ = other.decodedChannel_;
+	decodeReduction_ = other.decodeReduction_;
+
+	processedRegions_.resize(other.processedRegions_.size());
+	for(size_t i = 0; i < processedRegions_.size(); i++) {
+		const ProcessedRegion& otherRegion = other.processedRegions_[i];
+		processedRegions_[i].bounds = otherRegion.bounds;
+		processedRegions_[i].integral = otherRegion.integral.clone();
+		//Keep sharing data with the processed image cache if the region did before
+		if(otherRegion.image.data == other.processedImageCache_.data) {
+			processedRegions_[i].image = processedImageCache_;
+		} else {
+			processedRegions_[i].image = otherRegion.image.clone();
+		}
+	}
 }
 
 SheetScan::SheetScan(const cv::Mat& sheetImage) {
 	sheetImage_ = sheetImage;
 }
 
-int SheetScan::load(const std::string& filename) {
+int SheetScan::load(const std::string& filename, const DecodeHints& hints) {
 	int status = 0;
 
-	sheetImage_ = cv::imread(filename, CV_LOAD_IMAGE_COLOR);
+	const cv::Mat image = cv::imread(filename, decodeFlags(hints));
 
-	if(sheetImage_.data) {
-		tlOss << "Successfully oped image \"" << filename << "\"";
-		tlog.info(__FILE__, __LINE__, tlOss);
+	if(image.data) {
+		TLOG_INFO(tlog, tlOss, "Successfully oped image \"" << filename << "\"");
+		status = load(image, hints);
 	} else {
 		status = -1;
-		tlOss << "Failed to open image \"" << filename << "\"";
-		tlog.critical(__FILE__, __LINE__, tlOss);
+		sheetImage_.release();
+		layoutTransform_.release();
+		TLOG_CRITICAL(tlog, tlOss, "Failed to open image \"" << filename << "\"");
+	}
+
+	return status;
+}
+
+int SheetScan::load(const cv::Mat& sheetImage, const DecodeHints& hints) {
+	int status = 0;
+
+	if(sheetImage.empty() || sheetImage.type() != (hints.grayscale ? CV_8UC1 : CV_8UC3)) {
+		status = -1;
+		TLOG_CRITICAL(tlog, tlOss, "Recieved a sheet image that is empty or is not an 8 bit " << (hints.grayscale ? "grayscale" : "BGR") << " image");
+	} else if(!hints.grayscale && hints.channel >= sheetImage.channels()) {
+		status = -1;
+		TLOG_CRITICAL(tlog, tlOss, "Unable to keep channel " << hints.channel << " of a sheet image with " << sheetImage.channels() << " channels");
 	}
 
 	if(status >= 0) {
+		//Only keep the channel that the algorithms will use, if they all use the same one
+		if(!hints.grayscale && hints.channel >= 0) {
+			cv::extractChannel(sheetImage, sheetImage_, hints.channel);
+		} else {
+			sheetImage_ = sheetImage;
+		}
+		decodedChannel_ = hints.grayscale ? -1 : hints.channel;
+		decodeReduction_ = hints.reduction;
+		layoutTransform_.release();
 		resetAnnotations();
 	}
 
 	return status;
 }
 
+int SheetScan::decodeFlags(const DecodeHints& hints) {
+	int flags;
+	switch(hints.reduction) {
+	case 2:
+		flags = hints.grayscale ? cv::IMREAD_REDUCED_GRAYSCALE_2 : cv::IMREAD_REDUCED_COLOR_2;
+		break;
+	case 4:
+		flags = hints.grayscale ? cv::IMREAD_REDUCED_GRAYSCALE_4 : cv::IMREAD_REDUCED_COLOR_4;
+		break;
+	case 8:
+		flags = hints.grayscale ? cv::IMREAD_REDUCED_GRAYSCALE_8 : cv::IMREAD_REDUCED_COLOR_8;
+		break;
+	default:
+		flags = hints.grayscale ? cv::IMREAD_GRAYSCALE : cv::IMREAD_COLOR;
+	}
+	return flags;
+}
+
 int SheetScan::saveSheetImage(const std::string& filename) {
 	int status = 0;
 	if(savePng(sheetImage_, filename) < 0) {
-		tlOss << "Failed to save sheet image \"" << filename << "\"";
-		tlog.critical(__FILE__, __LINE__, tlOss);
+		TLOG_CRITICAL(tlog, tlOss, "Failed to save sheet image \"" << filename << "\"");
 		status = -1;
 	}
 	return status;
@@ -57,8 +120,7 @@ int SheetScan::saveSheetImage(const std::string& filename) {
 int SheetScan::saveAnnotated(const std::string& filename) {
 	int status = 0;
 	if(savePng(annotatedImage_, filename) < 0) {
-		tlOss << "Failed to save annotated image \"" << filename << "\"";
-		tlog.critical(__FILE__, __LINE__, tlOss);
+		TLOG_CRITICAL(tlog, tlOss, "Failed to save annotated image \"" << filename << "\"");
 		status = -1;
 	}
 	return status;
@@ -66,9 +128,19 @@ int SheetScan::saveAnnotated(const std::string& filename) {
 
 int SheetScan::saveProcessedCache(const std::string & filename) {
 	int status = 0;
-	if(savePng(processedImageCache_, filename) < 0) {
-		tlOss << "Failed to save processed image cache \"" << filename << "\"";
-		tlog.critical(__FILE__, __LINE__, tlOss);
+
+	//If only parts of the image were processed, save them on a black background
+	cv::Mat processedImage = processedImageCache_;
+	if(processedImage.empty() && !processedRegions_.empty()) {
+		processedImage = cv::Mat::zeros(sheetImage_.rows, sheetImage_.cols, CV_8UC1);
+		for(const ProcessedRegion& region : processedRegions_) {
+			cv::Mat destination = processedImage(region.bounds);
+			region.image.copyTo(destination);
+		}
+	}
+
+	if(savePng(processedImage, filename) < 0) {
+		TLOG_CRITICAL(tlog, tlOss, "Failed to save processed image cache \"" << filename << "\"");
 		status = -1;
 	}
 	return status;
@@ -88,21 +160,72 @@ bool SheetScan::empty() {
 	return !sheetImage_.data;
 }
 
+void SheetScan::clear() {
+	sheetImage_.release();
+	processedImageCache_.release();
+	processedRegions_.clear();
+	ellipseMaskCache_.clear();
+	annotatedImage_.release();
+	layoutTransform_.release();
+	decodedChannel_ = -1;
+	decodeReduction_ = 1;
+}
+
 int SheetScan::setupAlgorithm(const DetectionParams& detectionParams) {
 	int status = 0;
 
-	switch(detectionParams.getFilterType()) {
-
-	//Algorithms that use threshold as an initialization step
-	case FilterType::THRESH_FRAC:
-	case FilterType::THRESH_CONTOUR:
-	case FilterType::THRESH_HCIRCLES:
-		status = threshold(detectionParams);
-		break;
-	default:
+	if(!detectionParams.isCompiled()) {
 		status = -1;
-		tlOss << "Encountered unhandled filter type: " << detectionParams.getFilterType();
-		tlog.warning(__FILE__, __LINE__, tlOss);
+		TLOG_CRITICAL(tlog, tlOss, "Parameters of \"" << detectionParams.getName() << "\" have not been successfully compiled");
+	}
+
+	if(status >= 0) {
+		switch(detectionParams.getFilterType()) {
+
+		//Algorithms that use threshold as an initialization step
+		case FilterType::THRESH_FRAC:
+			status = threshold(detectionParams);
+			if(status >= 0 && detectionParams.getThreshFracParams().useIntegral) {
+				TLOG_DEBUG(tlog, tlOss, "Building summed-area table of thresholded image.");
+				buildIntegral();
+			}
+			break;
+		case FilterType::THRESH_CONTOUR:
+		case FilterType::THRESH_HOMOGRAPHY:
+		case FilterType::THRESH_HCIRCLES:
+			status = threshold(detectionParams);
+			break;
+		default:
+			status = -1;
+			TLOG_WARNING(tlog, tlOss, "Encountered unhandled filter type: " << detectionParams.getFilterType());
+		}
+	}
+
+	return status;
+}
+
+int SheetScan::setupAlgorithm(const DetectionParams& detectionParams, const EasyGrade::SideLayout& side) {
+	int status = 0;
+
+	//Only THRESH_FRAC checks bubbles one at a time, so it is the only algorithm that can skip the parts of the image without bubbles
+	if(detectionParams.isCompiled() && detectionParams.getFilterType() == FilterType::THRESH_FRAC && detectionParams.getThreshFracParams().roiPadding >= 0) {
+		std::vector<cv::Rect> regions = layoutRegions(side, detectionParams.getThreshFracParams().roiPadding);
+		TLOG_DEBUG(tlog, tlOss, "Thresholding " << regions.size() << " regions around the question groups of side " << side.getSideNumber() << ".");
+
+		//A side with no question groups has no regions, but threshold() would take that to mean the whole image
+		if(regions.empty()) {
+			processedImageCache_.release();
+			processedRegions_.clear();
+		} else {
+			status = threshold(detectionParams, regions);
+		}
+
+		if(status >= 0 && detectionParams.getThreshFracParams().useIntegral) {
+			TLOG_DEBUG(tlog, tlOss, "Building summed-area table of thresholded image.");
+			buildIntegral();
+		}
+	} else {
+		status = setupAlgorithm(detectionParams);
 	}
 
 	return status;
@@ -111,14 +234,20 @@ int SheetScan::setupAlgorithm(const DetectionParams& detectionParams) {
 int SheetScan::isCircleFilled(const cv::Vec3f& circle, const DetectionParams & detectionParams) {
 	int status = 0;
 
-	switch(detectionParams.getFilterType()) {
-	case FilterType::THRESH_FRAC:
-		status = isCircleFilledFrac(circle, detectionParams);
-		break;
-	default:
+	if(!detectionParams.isCompiled()) {
 		status = -1;
-		tlOss << "Encountered unhandled filter type: " << detectionParams.getFilterType();
-		tlog.warning(__FILE__, __LINE__, tlOss);
+		TLOG_CRITICAL(tlog, tlOss, "Parameters of \"" << detectionParams.getName() << "\" have not been successfully compiled");
+	}
+
+	if(status >= 0) {
+		switch(detectionParams.getFilterType()) {
+		case FilterType::THRESH_FRAC:
+			status = isCircleFilledFrac(circle, detectionParams);
+			break;
+		default:
+			status = -1;
+			TLOG_WARNING(tlog, tlOss, "Encountered unhandled filter type: " << detectionParams.getFilterType());
+		}
 	}
 
 	return status;
@@ -127,14 +256,20 @@ int SheetScan::isCircleFilled(const cv::Vec3f& circle, const DetectionParams & d
 int SheetScan::findCircles(std::vector<cv::Vec3f>& circles, const DetectionParams & detectionParams) {
 	int status = 0;
 
-	switch(detectionParams.getFilterType()) {
-	case FilterType::THRESH_HCIRCLES:
-		status = findCirclesHough(circles, detectionParams);
-		break;
-	default:
+	if(!detectionParams.isCompiled()) {
 		status = -1;
-		tlOss << "Encountered unhandled filter type: " << detectionParams.getFilterType();
-		tlog.warning(__FILE__, __LINE__, tlOss);
+		TLOG_CRITICAL(tlog, tlOss, "Parameters of \"" << detectionParams.getName() << "\" have not been successfully compiled");
+	}
+
+	if(status >= 0) {
+		switch(detectionParams.getFilterType()) {
+		case FilterType::THRESH_HCIRCLES:
+			status = findCirclesHough(circles, detectionParams);
+			break;
+		default:
+			status = -1;
+			TLOG_WARNING(tlog, tlOss, "Encountered unhandled filter type: " << detectionParams.getFilterType());
+		}
 	}
 
 	return status;
@@ -143,364 +278,515 @@ int SheetScan::findCircles(std::vector<cv::Vec3f>& circles, const DetectionParam
 int SheetScan::alignScan(const DetectionParams& detectionParams) {
 	int status = 0;
 
-	switch(detectionParams.getFilterType()) {
-	case FilterType::THRESH_CONTOUR:
-		status = alignScanContour(detectionParams);
-		break;
-	default:
+	if(!detectionParams.isCompiled()) {
 		status = -1;
-		tlOss << "Encountered unhandled filter type: " << detectionParams.getFilterType();
-		tlog.warning(__FILE__, __LINE__, tlOss);
+		TLOG_CRITICAL(tlog, tlOss, "Parameters of \"" << detectionParams.getName() << "\" have not been successfully compiled");
+	}
+
+	if(status >= 0) {
+		switch(detectionParams.getFilterType()) {
+		case FilterType::THRESH_CONTOUR:
+			status = alignScanContour(detectionParams);
+			break;
+		case FilterType::THRESH_HOMOGRAPHY:
+			status = -1;
+			TLOG_CRITICAL(tlog, tlOss, "Alignment algorithm \"" << detectionParams.getName() << "\" needs the side layout the scan is of.");
+			break;
+		default:
+			status = -1;
+			TLOG_WARNING(tlog, tlOss, "Encountered unhandled filter type: " << detectionParams.getFilterType());
+		}
 	}
 
 	return status;
 }
 
+int SheetScan::alignScan(const DetectionParams& detectionParams, const EasyGrade::SideLayout& side) {
+	int status = 0;
+
+	if(detectionParams.isCompiled() && detectionParams.getFilterType() == FilterType::THRESH_HOMOGRAPHY) {
+		status = alignScanHomography(detectionParams, side);
+	} else if(detectionParams.isCompiled() && detectionParams.getFilterType() == FilterType::THRESH_CONTOUR) {
+		//If the layout lists its alignment marks, every one of them should be found, not just the two the alignment is based on
+		status = alignScanContour(detectionParams, std::max<size_t>(2, side.getAlignmentMarks().size()));
+	} else {
+		status = alignScan(detectionParams);
+	}
+
+	return status;
+}
+
+bool SheetScan::hasLayoutTransform() const {
+	return !layoutTransform_.empty();
+}
+
 //------------------------------//
 //    THRESH_FRAC Algorithm     //
 //------------------------------//
 
-int SheetScan::threshold(const DetectionParams& detectionParams) {
+int SheetScan::threshold(const DetectionParams& detectionParams, const std::vector<cv::Rect>& regions) {
 	int status = 0;
 
+	ThreshParams params = detectionParams.getThreshParams();
+
+	processedImageCache_.release();
+	processedRegions_.clear();
+
 	//Extract highest contrast channel (as specified by the configuration parameters) if channel property is
 	//specified. Otherwise just use the whole image converted to grayscale. For example, if the pre-printed
 	//circles on the sheet are green, then they will be least visible on the green channel, increasing the
 	//contrast between empty circles and filled in answer bubbles.
 
-	if(detectionParams.hasParam("channel")) {
-		//Check that channel parameter is an int
-		if(!detectionParams.isInt("channel")) {
+	if(sheetImage_.channels() == 1) {
+		//The scan was decoded as a single channel, which is only usable if it is the one this algorithm would have extracted
+		if(params.channel != decodedChannel_) {
 			status = -1;
-			tlOss << "Channel property on \"" << detectionParams.getName() << "\" configuration must be an integer";
-			tlog.critical(__FILE__, __LINE__, tlOss);
+			TLOG_CRITICAL(tlog, tlOss, "Sheet image was decoded as " << (decodedChannel_ >= 0 ? "channel " + std::to_string(decodedChannel_) : "grayscale") << ", but \"" << detectionParams.getName() << "\" thresholds " << (params.channel >= 0 ? "channel " + std::to_string(params.channel) : "grayscale"));
+		} else {
+			TLOG_DEBUG(tlog, tlOss, "Sheet image was already decoded as a single channel, using it as it is.");
+			params.channel = 0;
 		}
-
+	} else if(params.channel >= 0) {
 		//Check that channel number is a valid index
-		int channelNumber;
-		if(status >= 0) {
-			channelNumber = detectionParams.getAsInt("channel");
-			if(channelNumber >= sheetImage_.channels()) {
-				status = -1;
-				tlOss << "Channel property on \"" << detectionParams.getName() << "\" configuration must be between 0 and " << sheetImage_.channels();
-				tlog.critical(__FILE__, __LINE__, tlOss);
-			}
-		}
-
-		//Extract specified channel
-		if(status >= 0) {
-			tlOss << "Extracting channel number " << channelNumber << " from sheet image.";
-			tlog.debug(__FILE__, __LINE__, tlOss);
-
-			cv::extractChannel(sheetImage_, processedImageCache_, channelNumber);
+		if(params.channel >= sheetImage_.channels()) {
+			status = -1;
+			TLOG_CRITICAL(tlog, tlOss, "Channel property on \"" << detectionParams.getName() << "\" configuration must be between 0 and " << sheetImage_.channels());
+		} else {
+			TLOG_DEBUG(tlog, tlOss, "Extracting channel number " << params.channel << " from sheet image.");
 		}
 	} else {
 		//Rather than extracting one channel, convert the image to grayscale
-		tlOss << "No channel number specified; converting image to grayscale.";
-		tlog.debug(__FILE__, __LINE__, tlOss);
-
-		cv::cvtColor(sheetImage_, processedImageCache_, CV_BGR2GRAY);
+		TLOG_DEBUG(tlog, tlOss, "No channel number specified; converting image to grayscale.");
 	}
 
-	//If specified in the filter config, blur image to reduce artifacts
+	//If specified in the filter config, blur image to reduce artifacts. Then apply a threshold filter to the image (i.e. all pixels
+	//darker than their surroundings by more than the specified value become black, all other pixels become white) and, if specified
+	//in the algorithm config, invert the resulting image. All of these steps are done together, one strip of the image at a time.
 
 	if(status >= 0) {
-		if(detectionParams.hasParam("preblur")) {
-			//Check that preblue parameter is a float
-			if(!detectionParams.isFloat("preblur")) {
-				status = -1;
-				tlOss << "Preblur property on \"" << detectionParams.getName() << "\" configuration must be a number";
-				tlog.critical(__FILE__, __LINE__, tlOss);
-			}
-
-			//Check that preblur ammount is a non-negative number
-			float preblurAmmount;
-			if(status >= 0) {
-				preblurAmmount = detectionParams.getAsFloat("preblur");
-				if(preblurAmmount < 0) {
-					status = -1;
-					tlOss << "Preblur property on \"" << detectionParams.getName() << "\" must be a non-negative number.";
-					tlog.critical(__FILE__, __LINE__, tlOss);
-				}
-			}
+		if(params.preblur > 0) {
+			TLOG_DEBUG(tlog, tlOss, "Applying " << ThresholdKernel::scaleKernelSize(params.preblur, decodeReduction_) << "px blur to image.");
+		} else {
+			TLOG_DEBUG(tlog, tlOss, "No preblur specified in detection parameters, using unblurred image.");
+		}
+		TLOG_DEBUG(tlog, tlOss, "Applying threshold with median offset of " << params.threshold << (params.invert ? " and inverting image." : "."));
 
-			if(status >= 0) {
-				tlOss << "Applying " << preblurAmmount << "px blur to image.";
-				tlog.debug(__FILE__, __LINE__, tlOss);
+		if(regions.empty()) {
+			ThresholdKernel::apply(sheetImage_, params, processedImageCache_, decodeReduction_);
 
-				cv::Size blurSize(preblurAmmount, preblurAmmount);
-				cv::GaussianBlur(processedImageCache_, processedImageCache_, blurSize, 0);
-			}
+			ProcessedRegion region;
+			region.bounds = cv::Rect(0, 0, sheetImage_.cols, sheetImage_.rows);
+			region.image = processedImageCache_;
+			processedRegions_.push_back(region);
 		} else {
-			tlOss << "No preblur specified in detection parameters, using unblurred image.";
-			tlog.debug(__FILE__, __LINE__, tlOss);
+			//Only process the requested regions. Each region comes out exactly as it would if the whole image had been processed.
+			for(const cv::Rect& bounds : regions) {
+				ProcessedRegion region;
+				region.bounds = bounds;
+				ThresholdKernel::apply(sheetImage_, params, bounds, region.image, decodeReduction_);
+				processedRegions_.push_back(region);
+			}
 		}
 	}
 
-	//Apply a threshold filter to the image (i.e. all pixels darker than the specified value become black, all
-	//pixels brighter than the specified value become while).
+	return status;
+}
 
-	if(status >= 0) {
-		if(detectionParams.hasParam("threshold")) {
-			//Check that threshold parameter is a float
-			if(!detectionParams.isFloat("threshold")) {
-				status = -1;
-				tlOss << "Threshold property on \"" << detectionParams.getName() << "\" configuration must be a number";
-				tlog.critical(__FILE__, __LINE__, tlOss);
-			}
+std::vector<cv::Rect> SheetScan::layoutRegions(const EasyGrade::SideLayout& side, float padding) {
+	const cv::Rect imageBounds(0, 0, sheetImage_.cols, sheetImage_.rows);
 
-			//Check that threshold median offset is a non-negative number
-			float threshold;
-			if(status >= 0) {
-				threshold = detectionParams.getAsFloat("threshold");
-				if(threshold < 0) {
-					status = -1;
-					tlOss << "Threshold property on \"" << detectionParams.getName() << "\" must be a non-negative number.";
-					tlog.critical(__FILE__, __LINE__, tlOss);
-				}
+	std::vector<cv::Rect> regions;
+	for(size_t i = 0; i < side.numChildren(); i++) {
+		const EasyGrade::Rectangle boundingBox = side.groupAt(i)->boundingBox();
+		if(!boundingBox.empty()) {
+			const cv::Rect region = imageRegion(boundingBox.getLeftEdge() - padding, boundingBox.getTopEdge() - padding, boundingBox.getRightEdge() + padding, boundingBox.getBottomEdge() + padding) & imageBounds;
+			if(region.area() > 0) {
+				regions.push_back(region);
 			}
+		}
+	}
 
-			if(status >= 0) {
-				tlOss << "Applying threshold with median offset of " << threshold << ".";
-				tlog.debug(__FILE__, __LINE__, tlOss);
+	//Merge overlapping regions, so that no part of the image is processed twice and every bubble lies within a single region
+	mergeOverlapping(regions);
 
-				cv::adaptiveThreshold(processedImageCache_, processedImageCache_, 255, CV_ADAPTIVE_THRESH_MEAN_C, CV_THRESH_BINARY, 75, threshold);
+	return regions;
+}
+
+void SheetScan::mergeOverlapping(std::vector<cv::Rect>& rects) {
+	//Merging two rectangles can make the result overlap a rectangle that has already been checked, so start over after each merge
+	bool isMerged = true;
+	while(isMerged) {
+		isMerged = false;
+		for(size_t i = 0; i < rects.size() && !isMerged; i++) {
+			for(size_t j = i + 1; j < rects.size() && !isMerged; j++) {
+				if((rects[i] & rects[j]).area() > 0) {
+					rects[i] |= rects[j];
+					rects.erase(rects.begin() + j);
+					isMerged = true;
+				}
 			}
-		} else {
-			status = -1;
-			tlOss << "No threshold parameter specified in detection parameters.";
-			tlog.critical(__FILE__, __LINE__, tlOss);
 		}
 	}
+}
+
+int SheetScan::isCircleFilledFrac(const cv::Vec3f & circle, const DetectionParams & detectionParams) {
+	int status = 0;
 
-	//If specified in the algorithm config, invert the resulting image
+	const ThreshFracParams& params = detectionParams.getThreshFracParams();
 
+	//Isolate section of image surrounding the circle to be scanned. Unless the detection configuration asks for only the circle itself to be
+	//measured, the whole square surrounding the circle is checked.
+	cv::Rect rect;
+	const int processedRegion = fracRegion(circle, rect);
+	if(processedRegion < 0) {
+		status = -1;
+	}
+
+	//Check whether the fraction of pixels in the detection region is above the level specified in the detection configuration.
 	if(status >= 0) {
-		if(detectionParams.hasParam("invert")) {
-			tlOss << "Inverting image";
-			tlog.debug(__FILE__, __LINE__, tlOss);
-			cv::bitwise_not(processedImageCache_, processedImageCache_);
+		if(fracFilled(rect, processedRegion, params.measureEllipse) >= params.fraction) {
+			status = 1;
 		} else {
-			tlOss << "Not inverting image.";
-			tlog.debug(__FILE__, __LINE__, tlOss);
+			status = 0;
 		}
 	}
 
 	return status;
 }
 
-int SheetScan::isCircleFilledFrac(const cv::Vec3f & circle, const DetectionParams & detectionParams) {
+int SheetScan::evaluateBubbles(const EasyGrade::SideLayout& side, const DetectionParams& detectionParams, std::vector<BubbleResult>& results) {
+	//Collect the side's bubbles in layout order, then check them exactly as the bubbles of an indexed layout are checked
+	std::vector<const EasyGrade::BubbleLayout*> bubbles;
+	for(size_t i = 0; i < side.numChildren(); i++) {
+		const EasyGrade::GroupLayout* group = side.groupAt(i);
+		for(size_t j = 0; j < group->numChildren(); j++) {
+			const EasyGrade::QuestionLayout* question = group->questionAt(j);
+			for(size_t k = 0; k < question->numChildren(); k++) {
+				bubbles.push_back(question->bubbleAt(k));
+			}
+		}
+	}
+
+	return evaluateBubbleRange(EasyGrade::ElementRange<EasyGrade::BubbleLayout>(bubbles.data(), bubbles.data() + bubbles.size()), detectionParams, results);
+}
+
+int SheetScan::evaluateBubbles(const EasyGrade::ScanSheetLayout& layout, int sideNumber, const DetectionParams& detectionParams, std::vector<BubbleResult>& results) {
 	int status = 0;
 
-	if(!detectionParams.isFloat("fraction")) {
+	results.clear();
+
+	const EasyGrade::LayoutIndex& index = layout.index();
+	if(sideNumber < 0 || static_cast<size_t>(sideNumber) >= index.numSides()) {
 		status = -1;
-		tlOss << "Fraction property on \"" << detectionParams.getName() << "\" configuration must be a number";
-		tlog.critical(__FILE__, __LINE__, tlOss);
+		TLOG_CRITICAL(tlog, tlOss, "Sheet layout \"" << layout.getTitle() << "\" does not have a side " << sideNumber);
 	}
 
-	//Check that preblur ammount is a non-negative number
-	float fraction;
 	if(status >= 0) {
-		fraction = detectionParams.getAsFloat("fraction");
-		if(fraction < 0 || fraction > 1) {
-			status = -1;
-			tlOss << "Fraction property on \"" << detectionParams.getName() << "\" must be between 0 and 1.";
-			tlog.critical(__FILE__, __LINE__, tlOss);
-		}
+		status = evaluateBubbleRange(index.sideBubbles(sideNumber), detectionParams, results);
 	}
-	 
-	if(status >= 0) {
-		//Convert circle position/radius to absolute coordinates
-
-		cv::Point absoluteCenter(cvRound(absolute(circle[0])), cvRound(absolute(circle[1])));
-		int absoluteRadius = cvRound(absolute(circle[2]));
 
-		//Isolate section of image surrounding the circle to be scanned.
+	return status;
+}
 
-		cv::Rect rect(absoluteCenter.x - absoluteRadius, absoluteCenter.y - absoluteRadius, 2 * absoluteRadius, 2 * absoluteRadius);
-		cv::Mat detectionRegion = processedImageCache_(rect);
+int SheetScan::evaluateBubbles(const EasyGrade::CompiledLayout& layout, int sideNumber, const DetectionParams& detectionParams, std::vector<BubbleResult>& results) {
+	int status = checkBubbleParams(detectionParams);
 
-		//Count number of pixels surrounding the circle. Note that the current implementation doesn't actually check a circular region, but a square one
-		//surrounding the circle.
+	results.clear();
 
-		double p = (double)cv::countNonZero(detectionRegion) / (double)(detectionRegion.cols * detectionRegion.rows);
+	if(sideNumber < 0 || static_cast<size_t>(sideNumber) >= layout.numSides()) {
+		status = -1;
+		TLOG_CRITICAL(tlog, tlOss, "Sheet layout \"" << layout.getTitle() << "\" does not have a side " << sideNumber);
+	}
 
-		//Check whether the fraction of pixels in the detection region is above the level specified in the detection configuration.
+	const ThreshFracParams& params = detectionParams.getThreshFracParams();
 
-		if(p >= fraction) {
-			status = 1;
-		} else {
-			status = 0;
+	//Find the region of every bubble on the side, streaming straight through the layout's edge arrays
+	std::vector<cv::Rect> regions;
+	std::vector<int> processedRegions;
+	if(status >= 0) {
+		const size_t firstBubble = layout.firstBubble(sideNumber);
+		const size_t endBubble = layout.endBubble(sideNumber);
+		const float* left = layout.bubbleLeft();
+		const float* top = layout.bubbleTop();
+		const float* right = layout.bubbleRight();
+		const float* bottom = layout.bubbleBottom();
+
+		regions.resize(endBubble - firstBubble);
+		processedRegions.resize(endBubble - firstBubble);
+		for(size_t i = firstBubble; i < endBubble; i++) {
+			cv::Rect& region = regions[i - firstBubble];
+			processedRegions[i - firstBubble] = bubbleRegion(left[i], top[i], right[i], bottom[i], params.measureEllipse, region);
+			if(processedRegions[i - firstBubble] < 0) {
+				status = -1;
+				const size_t question = layout.bubbleQuestion()[i];
+				TLOG_CRITICAL(tlog, tlOss, "Failed to check bubble \"" << layout.answerText(layout.bubbleAnswer()[i]) << "\" on question " << layout.questionNumber(question) << " in \"" << layout.questionGroupName(question) << "\"");
+				region = cv::Rect();
+			}
 		}
 	}
 
+	measureBubbles(regions, processedRegions, params, results);
+
 	return status;
 }
-//-------------------------------------//
-//     CONTOUR alignment algorithm     //
-//-------------------------------------//
 
-int SheetScan::alignScanContour(const DetectionParams& detectionParams) {
+int SheetScan::checkBubbleParams(const DetectionParams& detectionParams) {
 	int status = 0;
 
-	// Get the tollerance to be used when approximating contours as polygons
-	if(!detectionParams.isFloat("alignment-approx-tollerance")) {
+	//Validate the parameters once for the whole side rather than once per bubble
+	if(!detectionParams.isCompiled()) {
+		status = -1;
+		TLOG_CRITICAL(tlog, tlOss, "Parameters of \"" << detectionParams.getName() << "\" have not been successfully compiled");
+	} else if(detectionParams.getFilterType() != FilterType::THRESH_FRAC) {
 		status = -1;
-		tlOss << "Poligon approximation tollerance (alignment-approx-tollerance) property on \"" << detectionParams.getName() << "\" configuration must exist and be a number";
-		tlog.critical(__FILE__, __LINE__, tlOss);
+		TLOG_WARNING(tlog, tlOss, "Encountered unhandled filter type: " << detectionParams.getFilterType());
 	}
 
-	float tollerance;
+	return status;
+}
+
+int SheetScan::evaluateBubbleRange(const EasyGrade::ElementRange<EasyGrade::BubbleLayout>& bubbles, const DetectionParams& detectionParams, std::vector<BubbleResult>& results) {
+	int status = checkBubbleParams(detectionParams);
+
+	results.clear();
+
+	const ThreshFracParams& params = detectionParams.getThreshFracParams();
+
+	//Find the region of every bubble, walking the flat run of bubbles rather than the layout tree
+	std::vector<cv::Rect> regions;
+	std::vector<int> processedRegions;
 	if(status >= 0) {
-		tollerance = detectionParams.getAsFloat("alignment-approx-tollerance");
-		if(tollerance < 0) {
-			status = -1;
-			tlOss << "Poligon approximation tollerance (alignment-approx-tollerance) property on \"" << detectionParams.getName() << "\" must be a non-negative number.";
-			tlog.critical(__FILE__, __LINE__, tlOss);
-		} else {
-			tlOss << "Poligon approximation tollerance set to " << tollerance;
-			tlog.debug(__FILE__, __LINE__, tlOss);
+		regions.resize(bubbles.size());
+		processedRegions.resize(bubbles.size());
+		for(size_t i = 0; i < bubbles.size(); i++) {
+			const EasyGrade::BubbleLayout& bubble = bubbles[i];
+			processedRegions[i] = bubbleRegion(bubble.getLeftEdge(), bubble.getTopEdge(), bubble.getRightEdge(), bubble.getBottomEdge(), params.measureEllipse, regions[i]);
+			if(processedRegions[i] < 0) {
+				status = -1;
+				TLOG_CRITICAL(tlog, tlOss, "Failed to check bubble " << bubble << " on " << *bubble.getParent());
+				regions[i] = cv::Rect();
+			}
 		}
 	}
 
-	// Get the minimum width for a rectangle to keep
-	if(!detectionParams.isFloat("alignment-min-width")) {
-		status = -1;
-		tlOss << "Minimum rectangle width (alignment-min-width) property on \"" << detectionParams.getName() << "\" configuration must exist and be a number";
-		tlog.critical(__FILE__, __LINE__, tlOss);
+	measureBubbles(regions, processedRegions, params, results);
+
+	return status;
+}
+
+int SheetScan::bubbleRegion(float left, float top, float right, float bottom, bool isElliptical, cv::Rect& region) {
+	//Bubbles are checked either as the ellipse inscribed in their bounding box or as the square around the largest circle that fits inside it
+	int processedRegion;
+	if(isElliptical) {
+		region = imageRegion(left, top, right, bottom);
+		processedRegion = checkRegion(region);
+	} else {
+		const float width = right - left;
+		const float height = bottom - top;
+		const cv::Vec3f circle(left + width / 2.0f, top + height / 2.0f, std::min(width, height) / 2);
+		processedRegion = fracRegion(circle, region);
 	}
+	return processedRegion;
+}
 
-	float minWidth;
-	if(status >= 0) {
-		minWidth = detectionParams.getAsFloat("alignment-min-width");
-		if(minWidth < 0) {
-			status = -1;
-			tlOss << "Minimum rectangle width (alignment-min-width) property on \"" << detectionParams.getName() << "\" must be a non-negative number.";
-			tlog.critical(__FILE__, __LINE__, tlOss);
-		} else {
-			tlOss << "Minimum rectangle width set to " << minWidth;
-			tlog.debug(__FILE__, __LINE__, tlOss);
+void SheetScan::measureBubbles(const std::vector<cv::Rect>& regions, const std::vector<int>& processedRegions, const ThreshFracParams& params, std::vector<BubbleResult>& results) {
+	//Visit the bubbles from the top of the image to the bottom, so that rows of the image are read in order rather than jumping back up
+	//for every question in a column
+	std::vector<size_t> order(regions.size());
+	for(size_t i = 0; i < order.size(); i++) {
+		order[i] = i;
+	}
+	std::sort(order.begin(), order.end(), [&regions](size_t lhs, size_t rhs) {
+		return regions[lhs].y < regions[rhs].y || (regions[lhs].y == regions[rhs].y && regions[lhs].x < regions[rhs].x);
+	});
+
+	results.resize(regions.size());
+	for(size_t index : order) {
+		if(regions[index].area() > 0) {
+			const double fillScore = fracFilled(regions[index], processedRegions[index], params.measureEllipse);
+			results[index].fillScore = (float)fillScore;
+			results[index].filled = fillScore >= params.fraction;
 		}
 	}
+}
 
-	// Get the maximum width for a rectangle to keep
-	if(!detectionParams.isFloat("alignment-max-width")) {
-		status = -1;
-		tlOss << "Maximum rectangle width (alignment-max-width) property on \"" << detectionParams.getName() << "\" configuration must exist and be a number";
-		tlog.critical(__FILE__, __LINE__, tlOss);
-	}
+int SheetScan::fracRegion(const cv::Vec3f& circle, cv::Rect& region) {
+	//Convert circle position/radius to absolute coordinates
+	const cv::Point2f center = toImage(cv::Point2f(circle[0], circle[1]));
+	cv::Point absoluteCenter(cvRound(center.x), cvRound(center.y));
+	int absoluteRadius = imageRadius(circle);
 
-	float maxWidth;
-	if(status >= 0) {
-		maxWidth = detectionParams.getAsFloat("alignment-max-width");
-		if(maxWidth < 0) {
-			status = -1;
-			tlOss << "Maximum rectangle width (alignment-min-width) property on \"" << detectionParams.getName() << "\" must be a non-negative number.";
-			tlog.critical(__FILE__, __LINE__, tlOss);
-		} else {
-			tlOss << "Maximum rectangle width set to " << maxWidth;
-			tlog.debug(__FILE__, __LINE__, tlOss);
+	region = cv::Rect(absoluteCenter.x - absoluteRadius, absoluteCenter.y - absoluteRadius, 2 * absoluteRadius, 2 * absoluteRadius);
+
+	return checkRegion(region);
+}
+
+int SheetScan::fracRegion(const EasyGrade::Rectangle& boundingBox, cv::Rect& region) {
+	region = imageRegion(boundingBox.getLeftEdge(), boundingBox.getTopEdge(), boundingBox.getRightEdge(), boundingBox.getBottomEdge());
+
+	return checkRegion(region);
+}
+
+int SheetScan::checkRegion(const cv::Rect& region) {
+	int processedRegion = -1;
+
+	//Check that the region is entirely within a processed region. If it is not, report an error to avoid an exception when isolating the region.
+	if(region.width > 0 && region.height > 0) {
+		for(size_t i = 0; i < processedRegions_.size() && processedRegion < 0; i++) {
+			if((region & processedRegions_[i].bounds) == region) {
+				processedRegion = (int)i;
+			}
 		}
 	}
-	
-	// Get the minimum height for a rectangle to keep
-	if(!detectionParams.isFloat("alignment-min-height")) {
-		status = -1;
-		tlOss << "Minimum rectangle height (alignment-min-height) property on \"" << detectionParams.getName() << "\" configuration must exist and be a number";
-		tlog.critical(__FILE__, __LINE__, tlOss);
+
+	if(processedRegion < 0) {
+		TLOG_CRITICAL(tlog, tlOss, "Unable to check circle, circle is empty or exceeds the bounds of the processed image.");
 	}
 
-	float minHeight;
-	if(status >= 0) {
-		minHeight = detectionParams.getAsFloat("alignment-min-height");
-		if(minHeight < 0) {
-			status = -1;
-			tlOss << "Minimum rectangle height (alignment-min-height) property on \"" << detectionParams.getName() << "\" must be a non-negative number.";
-			tlog.critical(__FILE__, __LINE__, tlOss);
+	return processedRegion;
+}
+
+double SheetScan::fracFilled(const cv::Rect& region, int processedRegion, bool isElliptical) {
+	const ProcessedRegion& processed = processedRegions_[processedRegion];
+
+	//The summed-area table has an extra row and column of zeros at the top and left, so the entry at (x, y) is the count of the pixels above
+	//and to the left of pixel (x, y) and the count of a rectangle is found from its four corners
+	auto countFilled = [&processed](int left, int top, int right, int bottom) {
+		int count;
+		if(processed.integral.empty()) {
+			count = cv::countNonZero(processed.image(cv::Range(top, bottom), cv::Range(left, right)));
 		} else {
-			tlOss << "Minimum rectangle height set to " << minHeight;
-			tlog.debug(__FILE__, __LINE__, tlOss);
+			const int* topRow = processed.integral.ptr<int>(top);
+			const int* bottomRow = processed.integral.ptr<int>(bottom);
+			count = bottomRow[right] - bottomRow[left] - topRow[right] + topRow[left];
+		}
+		return count;
+	};
+
+	//Position of the region within the processed region
+	const int x = region.x - processed.bounds.x;
+	const int y = region.y - processed.bounds.y;
+
+	int numFilled = 0;
+	int area = 0;
+	if(isElliptical) {
+		//Each row of an ellipse is one unbroken run of pixels, so count the run on each row
+		const std::vector<cv::Range>& mask = ellipseMask(region.width, region.height);
+		for(int row = 0; row < region.height; row++) {
+			if(!mask[row].empty()) {
+				numFilled += countFilled(x + mask[row].start, y + row, x + mask[row].end, y + row + 1);
+				area += mask[row].size();
+			}
 		}
+	} else {
+		numFilled = countFilled(x, y, x + region.width, y + region.height);
+		area = region.area();
 	}
 
-	// Get the maximum height for a rectangle to keep
-	if(!detectionParams.isFloat("alignment-max-height")) {
-		status = -1;
-		tlOss << "Maximum rectangle height (alignment-max-height) property on \"" << detectionParams.getName() << "\" configuration must exist and be a number";
-		tlog.critical(__FILE__, __LINE__, tlOss);
-	}
+	return area > 0 ? (double)numFilled / (double)area : 0.0;
+}
 
-	float maxHeight;
-	if(status >= 0) {
-		maxHeight = detectionParams.getAsFloat("alignment-max-height");
-		if(maxHeight < 0) {
-			status = -1;
-			tlOss << "Maximum rectangle height (alignment-min-height) property on \"" << detectionParams.getName() << "\" must be a non-negative number.";
-			tlog.critical(__FILE__, __LINE__, tlOss);
-		} else {
-			tlOss << "Maximum rectangle height set to " << maxHeight;
-			tlog.debug(__FILE__, __LINE__, tlOss);
+const std::vector<cv::Range>& SheetScan::ellipseMask(int width, int height) {
+	std::vector<cv::Range>& mask = ellipseMaskCache_[std::make_pair(width, height)];
+
+	if(mask.empty()) {
+		//A pixel is inside the ellipse if its center is
+		const double radiusX = width / 2.0;
+		const double radiusY = height / 2.0;
+		mask.resize(height);
+		for(int row = 0; row < height; row++) {
+			const double dy = (row + 0.5 - radiusY) / radiusY;
+			const double halfWidth = radiusX * std::sqrt(std::max(0.0, 1.0 - dy * dy));
+			const int start = std::max(0, cvCeil(radiusX - halfWidth - 0.5));
+			const int end = std::min(width, cvFloor(radiusX + halfWidth - 0.5) + 1);
+			mask[row] = start < end ? cv::Range(start, end) : cv::Range(0, 0);
 		}
 	}
 
-	//Alignment rectangles are black. Get the minimum % filled in
-	if(!detectionParams.isFloat("alignment-min-filled")) {
-		status = -1;
-		tlOss << "Minimum fraction filled in (alignment-min-filled) property on \"" << detectionParams.getName() << "\" configuration must exist and be a number";
-		tlog.critical(__FILE__, __LINE__, tlOss);
-	}
+	return mask;
+}
 
-	float minFrac;
-	if(status >= 0) {
-		minFrac = detectionParams.getAsFloat("alignment-min-filled");
-		if(minFrac < 0) {
-			status = -1;
-			tlOss << "Minimum fraction filled in (alignment-min-filled) property on \"" << detectionParams.getName() << "\" must be a non-negative number.";
-			tlog.critical(__FILE__, __LINE__, tlOss);
-		} else {
-			tlOss << "Minimum fraction filled in set to " << minFrac;
-			tlog.debug(__FILE__, __LINE__, tlOss);
-		}
+void SheetScan::buildIntegral() {
+	//The processed image is 0 or 255, which would overflow a 32 bit table on large scans, so count each non-zero pixel as one
+	cv::Mat filled;
+	for(ProcessedRegion& region : processedRegions_) {
+		cv::threshold(region.image, filled, 0, 1, CV_THRESH_BINARY);
+		cv::integral(filled, region.integral, CV_32S);
 	}
+}
 
-	//Find the centers of all of the alignment marks
-	std::vector<cv::Point> alignmentMarks;
+cv::Point2f SheetScan::toImage(const cv::Point2f& point) {
+	cv::Point2f result;
+	if(layoutTransform_.empty()) {
+		result = cv::Point2f(point.x * sheetImage_.cols, point.y * sheetImage_.cols);
+	} else {
+		const double* h = layoutTransform_.ptr<double>();
+		const double w = h[6] * point.x + h[7] * point.y + h[8];
+		result = cv::Point2f((float)((h[0] * point.x + h[1] * point.y + h[2]) / w), (float)((h[3] * point.x + h[4] * point.y + h[5]) / w));
+	}
+	return result;
+}
 
-	if(status >= 0) {
-		std::vector<std::vector<cv::Point>> contours;
-		cv::findContours(processedImageCache_, contours, CV_RETR_LIST, CV_CHAIN_APPROX_TC89_L1);
+cv::Rect SheetScan::imageRegion(float left, float top, float right, float bottom) {
+	//Convert the edges rather than the size, so that neighboring regions line up the same way they do on the layout. The layout transform
+	//can turn a rectangle into any quadrilateral, so take the smallest rectangle containing all four of its corners.
+	const cv::Point2f corners[4] = {toImage(cv::Point2f(left, top)), toImage(cv::Point2f(right, top)), toImage(cv::Point2f(right, bottom)), toImage(cv::Point2f(left, bottom))};
+	float minX = corners[0].x;
+	float maxX = corners[0].x;
+	float minY = corners[0].y;
+	float maxY = corners[0].y;
+	for(const cv::Point2f& corner : corners) {
+		minX = std::min(minX, corner.x);
+		maxX = std::max(maxX, corner.x);
+		minY = std::min(minY, corner.y);
+		maxY = std::max(maxY, corner.y);
+	}
 
-		for(int i = 0; i < contours.size(); i++) {
-			std::vector<cv::Point> approx;
-			cv::approxPolyDP(contours[i], approx, tollerance * cv::arcLength(contours[i], true), true);
+	return cv::Rect(cvRound(minX), cvRound(minY), cvRound(maxX) - cvRound(minX), cvRound(maxY) - cvRound(minY));
+}
 
-			if(approx.size() != 4) {
-				continue;
-			}
+int SheetScan::imageRadius(const cv::Vec3f& circle) {
+	int radius;
+	if(layoutTransform_.empty()) {
+		radius = absolute(circle[2]);
+	} else {
+		//The layout transform can stretch the page by different amounts in different places, so measure how far it stretches the radius
+		//around this particular circle, averaging across both axes
+		const cv::Point2f center = toImage(cv::Point2f(circle[0], circle[1]));
+		const cv::Point2f right = toImage(cv::Point2f(circle[0] + circle[2], circle[1]));
+		const cv::Point2f below = toImage(cv::Point2f(circle[0], circle[1] + circle[2]));
+		radius = cvRound((std::hypot(right.x - center.x, right.y - center.y) + std::hypot(below.x - center.x, below.y - center.y)) / 2);
+	}
+	return radius;
+}
+//-------------------------------------//
+//     CONTOUR alignment algorithm     //
+//-------------------------------------//
 
-			if(!cv::isContourConvex(approx)) {
-				continue;
-			}
+int SheetScan::alignScanContour(const DetectionParams& detectionParams, size_t numMarks) {
+	int status = 0;
 
-			cv::RotatedRect boundingBox = minAreaRect(approx);
+	const ContourAlignParams& params = detectionParams.getContourAlignParams();
 
-			float height = normalized(MAX(boundingBox.size.height, boundingBox.size.width));
-			float width = normalized(MIN(boundingBox.size.height, boundingBox.size.width));
+	//Any transform found by an earlier alignment is replaced
+	layoutTransform_.release();
 
-			//Check dimensions of contour are acceptable
-			if(width < minWidth || width > maxWidth || height < minHeight || height > maxHeight) {
-				continue;
-			}
+	//Find the centers of all of the alignment marks
+	std::vector<cv::Point> alignmentMarks;
+	std::vector<std::vector<cv::Point>> markOutlines;
 
-			if(getFilledFraction(processedImageCache_, boundingBox) < minFrac) {
-				continue;
-			}
+	if(status >= 0) {
+		findAlignmentMarks(params.marks, std::max<size_t>(2, numMarks), alignmentMarks, markOutlines);
 
-			cv::drawContours(annotatedImage_, std::vector<std::vector<cv::Point>>({approx}), -1, cv::Scalar(255, 0, 255), 2);
-			alignmentMarks.push_back((cv::Point)boundingBox.center);
+		if(isAnnotationEnabled_) {
+			cv::drawContours(annotatedImage_, markOutlines, -1, cv::Scalar(255, 0, 255), 2);
+			cv::drawContours(annotatedImage_, std::vector<std::vector<cv::Point>>({alignmentMarks}), -1, cv::Scalar(255, 0, 255), 1);
 		}
+	}
 
-		cv::drawContours(annotatedImage_, std::vector<std::vector<cv::Point>>({alignmentMarks}), -1, cv::Scalar(255, 0, 255), 1);
+	if(status >= 0 && alignmentMarks.size() < 2) {
+		status = -1;
+		TLOG_CRITICAL(tlog, tlOss, "Unable to align image, found " << alignmentMarks.size() << " alignment marks but at least 2 are needed.");
 	}
 
 	cv::Point firstMark;
@@ -524,23 +810,19 @@ int SheetScan::alignScanContour(const DetectionParams& detectionParams) {
 		markDelta = lastMark - firstMark;
 	}
 
+	cv::Mat rotationMatrix;
 	if(status >= 0) {
 		//Find angle that the sheet scan is tilted by
 		//Note: OpenCV uses degrees for everything while the C++ standard library functions use radians
 		float angleRad = std::atan2(markDelta.y, markDelta.x);
 		float angleDeg = angleRad * 180.0 / 3.141592653589793238463;
 
-		tlOss << "Sheet tilted by " << angleDeg << " degrees";
-		tlog.debug(__FILE__, __LINE__, tlOss);
-
-		//Rotate image by angle in order to reverse 
+		TLOG_DEBUG(tlog, tlOss, "Sheet tilted by " << angleDeg << " degrees");
 
-		cv::Point2f center(annotatedImage_.cols / 2., annotatedImage_.rows / 2.);
-		cv::Mat rotationMatrix = cv::getRotationMatrix2D(center, angleDeg, 1.0);
-		//Rotate both original sheet image and annotated image so that the change will be reflected both by subsequent image processing
-		//and debug output
-		cv::warpAffine(sheetImage_, sheetImage_, rotationMatrix, cv::Size(annotatedImage_.cols, annotatedImage_.rows));
-		cv::warpAffine(annotatedImage_, annotatedImage_, rotationMatrix, cv::Size(annotatedImage_.cols, annotatedImage_.rows));
+		//Find the rotation that reverses the tilt. The image itself is not rotated until the crop box is known, so that rotating and
+		//cropping can be done in one step.
+		cv::Point2f center(sheetImage_.cols / 2., sheetImage_.rows / 2.);
+		rotationMatrix = cv::getRotationMatrix2D(center, angleDeg, 1.0);
 
 		//Rotate firstMark, and lastMark points so that they will be correct for later calculations
 		firstMark = SheetScan::rotate(firstMark, center, -angleRad);
@@ -552,200 +834,340 @@ int SheetScan::alignScanContour(const DetectionParams& detectionParams) {
 	//are multiplied by the distance in pixels between the first and last alignment mark. This is done so that the image will be aligned the same
 	//regardless of the size of the scanning bed used
 	
-	//Get the bottom offset
-	if(!detectionParams.isFloat("crop-offset-fraction-bottom")) {
-		status = -1;
-		tlOss << "Bottom crop offset (crop-offset-fraction-bottom) property on \"" << detectionParams.getName() << "\" configuration must exist and be a number";
-		tlog.critical(__FILE__, __LINE__, tlOss);
-	}
-
-	float bottomOffset;
+	cv::Rect cropBox;
 	if(status >= 0) {
-		bottomOffset = detectionParams.getAsFloat("crop-offset-fraction-bottom");
-		tlOss << "Bottom crop offset set to " << bottomOffset;
-		tlog.debug(__FILE__, __LINE__, tlOss);
-	}
+		float distance = sqrt(markDelta.x * markDelta.x + markDelta.y * markDelta.y);
+		//Create rectangle around the first alignment mark with each side offset by the specified value
+		cropBox.x = firstMark.x - distance * params.cropOffsetLeft;
+		cropBox.y = firstMark.y - distance * params.cropOffsetTop;
+		cropBox.width = distance * (params.cropOffsetLeft + params.cropOffsetRight);
+		cropBox.height = distance * (params.cropOffsetBottom + params.cropOffsetTop);
 
-	//Get the top offset
-	if(!detectionParams.isFloat("crop-offset-fraction-top")) {
-		status = -1;
-		tlOss << "Top crop offset (crop-offset-fraction-top) property on \"" << detectionParams.getName() << "\" configuration must exist and be a number";
-		tlog.critical(__FILE__, __LINE__, tlOss);
+		//Check that crop rectangle is entirely within the rotated image. If it is not, report an error to avoid exception when cropping image.
+
+		if((cropBox & cv::Rect(0, 0, sheetImage_.cols, sheetImage_.rows)) != cropBox) {
+			status = -1;
+			TLOG_CRITICAL(tlog, tlOss, "Unable to crop image, crop offset parameters exceed bounds of image.");
+		}
 	}
 
-	float topOffset;
 	if(status >= 0) {
-		topOffset = detectionParams.getAsFloat("crop-offset-fraction-top");
-		tlOss << "Top crop offset set to " << topOffset;
-		tlog.debug(__FILE__, __LINE__, tlOss);
+		//Shift the rotation so that the corner of the crop box lands on the origin, then only resample the pixels inside the crop box
+		rotationMatrix.at<double>(0, 2) -= cropBox.x;
+		rotationMatrix.at<double>(1, 2) -= cropBox.y;
 	}
 
-	//Get the left offset
-	if(!detectionParams.isFloat("crop-offset-fraction-left")) {
-		status = -1;
-		tlOss << "Left crop offset (crop-offset-fraction-left) property on \"" << detectionParams.getName() << "\" configuration must exist and be a number";
-		tlog.critical(__FILE__, __LINE__, tlOss);
+	if(status >= 0 && params.transformOnly) {
+		//Rather than resampling the image, keep the transform from normalized coordinates on the aligned image (which is cropBox.width pixels
+		//wide) back to the scan, so that bubbles can be found on the scan as it is
+		cv::Mat inverse;
+		cv::invertAffineTransform(rotationMatrix, inverse);
+
+		layoutTransform_ = cv::Mat::zeros(3, 3, CV_64F);
+		for(int row = 0; row < 2; row++) {
+			layoutTransform_.at<double>(row, 0) = inverse.at<double>(row, 0) * cropBox.width;
+			layoutTransform_.at<double>(row, 1) = inverse.at<double>(row, 1) * cropBox.width;
+			layoutTransform_.at<double>(row, 2) = inverse.at<double>(row, 2);
+		}
+		layoutTransform_.at<double>(2, 2) = 1;
+
+		TLOG_DEBUG(tlog, tlOss, "Recorded alignment transform without resampling the image.");
+	} else if(status >= 0) {
+		//Rotate and crop both original sheet image and annotated image so that the change will be reflected both by subsequent image
+		//processing and debug output
+		cv::Mat alignedImage;
+		cv::warpAffine(sheetImage_, alignedImage, rotationMatrix, cropBox.size());
+		sheetImage_ = alignedImage;
+
+		if(isAnnotationEnabled_) {
+			cv::Mat alignedAnnotations;
+			cv::warpAffine(annotatedImage_, alignedAnnotations, rotationMatrix, cropBox.size());
+			annotatedImage_ = alignedAnnotations;
+		}
 	}
 
-	float leftOffset;
-	if(status >= 0) {
-		leftOffset = detectionParams.getAsFloat("crop-offset-fraction-left");
-		tlOss << "Left crop offset set to " << leftOffset;
-		tlog.debug(__FILE__, __LINE__, tlOss);
-	}
+	return status;
+}
+
+//-----------------------------------------//
+//     HOMOGRAPHY alignment algorithm      //
+//-----------------------------------------//
+
+int SheetScan::alignScanHomography(const DetectionParams& detectionParams, const EasyGrade::SideLayout& side) {
+	int status = 0;
+
+	const HomographyAlignParams& params = detectionParams.getHomographyAlignParams();
+	const std::vector<EasyGrade::AlignmentMark>& layoutMarks = side.getAlignmentMarks();
 
-	//Get the right offset
-	if(!detectionParams.isFloat("crop-offset-fraction-right")) {
+	//Any transform found by an earlier alignment is replaced
+	layoutTransform_.release();
+
+	//A homography has eight degrees of freedom, so it takes at least four pairs of points to pin down
+	if(layoutMarks.size() < 4) {
 		status = -1;
-		tlOss << "Right crop offset (crop-offset-fraction-right) property on \"" << detectionParams.getName() << "\" configuration must exist and be a number";
-		tlog.critical(__FILE__, __LINE__, tlOss);
+		TLOG_CRITICAL(tlog, tlOss, "Unable to align image, side " << side.getSideNumber() << " of the layout has " << layoutMarks.size() << " alignment marks but at least 4 are needed.");
 	}
 
-	float rightOffset;
-	if(status >= 0) {
-		rightOffset = detectionParams.getAsFloat("crop-offset-fraction-right");
-		tlOss << "Left crop offset set to " << rightOffset;
-		tlog.debug(__FILE__, __LINE__, tlOss);
-	}
-	
-	cv::Rect cropBox;
+	std::vector<cv::Point> alignmentMarks;
+	std::vector<std::vector<cv::Point>> markOutlines;
 	if(status >= 0) {
-		float distance = sqrt(markDelta.x * markDelta.x + markDelta.y + markDelta.y);
-		//Create rectangle around the first alignment mark with each side offset by the specified value
-		cropBox.x = firstMark.x - distance * leftOffset;
-		cropBox.y = firstMark.y - distance * topOffset;
-		cropBox.width = distance * (leftOffset + rightOffset);
-		cropBox.height = distance * (bottomOffset + topOffset);
+		//Every one of the layout's marks is needed to pair them up reliably, not just the four that pin down a homography
+		findAlignmentMarks(params.marks, layoutMarks.size(), alignmentMarks, markOutlines);
 
-		//Check that crop rectangle is entirely within the image. If it is not, report an error to avoid exception when cropping image.
+		if(isAnnotationEnabled_) {
+			cv::drawContours(annotatedImage_, markOutlines, -1, cv::Scalar(255, 0, 255), 2);
+		}
 
-		if((cropBox & cv::Rect(0, 0, sheetImage_.cols, sheetImage_.rows)) != cropBox) {
+		if(alignmentMarks.size() < 4) {
 			status = -1;
-			tlOss << "Unable to crop image, crop offset parameters exceed bounds of image.";
-			tlog.critical(__FILE__, __LINE__, tlOss);
+			TLOG_CRITICAL(tlog, tlOss, "Unable to align image, found " << alignmentMarks.size() << " alignment marks but at least 4 are needed.");
 		}
 	}
 
+	//Work out which detected mark is which of the layout's marks. The leftmost and rightmost marks (the same ones the THRESH_CONTOUR algorithm
+	//aligns with) give a rough rotation, scale and offset, which is good enough to predict roughly where each of the other marks should be.
+	std::vector<cv::Point2f> layoutPoints;
+	std::vector<cv::Point2f> imagePoints;
 	if(status >= 0) {
-		//Crop images to the rectangle
-		sheetImage_ = sheetImage_(cropBox);
-		annotatedImage_ = annotatedImage_(cropBox);
-	}
-
-	return status;
-}
+		size_t firstLayoutMark = 0;
+		size_t lastLayoutMark = 0;
+		for(size_t i = 0; i < layoutMarks.size(); i++) {
+			if(layoutMarks[i].x < layoutMarks[firstLayoutMark].x) {
+				firstLayoutMark = i;
+			}
+			if(layoutMarks[i].x > layoutMarks[lastLayoutMark].x) {
+				lastLayoutMark = i;
+			}
+		}
 
-int SheetScan::findCirclesHough(std::vector<cv::Vec3f>& circles, const DetectionParams & detectionParams) {
-	int status = 0;
+		size_t firstMark = 0;
+		size_t lastMark = 0;
+		for(size_t i = 0; i < alignmentMarks.size(); i++) {
+			if(alignmentMarks[i].x < alignmentMarks[firstMark].x) {
+				firstMark = i;
+			}
+			if(alignmentMarks[i].x > alignmentMarks[lastMark].x) {
+				lastMark = i;
+			}
+		}
 
-	//Get parameters for Hough transform method
+		//Treat points as complex numbers, so that the rotation and scale taking the layout's pair of marks onto the detected pair is a
+		//single complex number
+		const std::complex<double> layoutOrigin(layoutMarks[firstLayoutMark].x, layoutMarks[firstLayoutMark].y);
+		const std::complex<double> imageOrigin(alignmentMarks[firstMark].x, alignmentMarks[firstMark].y);
+		const std::complex<double> layoutDelta = std::complex<double>(layoutMarks[lastLayoutMark].x, layoutMarks[lastLayoutMark].y) - layoutOrigin;
+		const std::complex<double> imageDelta = std::complex<double>(alignmentMarks[lastMark].x, alignmentMarks[lastMark].y) - imageOrigin;
+		const std::complex<double> rotationScale = std::abs(layoutDelta) > 0 ? imageDelta / layoutDelta : std::complex<double>(0, 0);
+
+		//Pair up each of the layout's marks with a detected mark near where it is predicted to be, closest pairs first, using each mark at most once
+		struct MarkMatch {
+			double distance;
+			size_t layoutMark;
+			size_t imageMark;
+		};
+		std::vector<MarkMatch> candidates;
+		const double maxDistance = absolute(params.matchDistance);
+		for(size_t i = 0; i < layoutMarks.size(); i++) {
+			const std::complex<double> predicted = imageOrigin + rotationScale * (std::complex<double>(layoutMarks[i].x, layoutMarks[i].y) - layoutOrigin);
+			for(size_t j = 0; j < alignmentMarks.size(); j++) {
+				const double distance = std::abs(std::complex<double>(alignmentMarks[j].x, alignmentMarks[j].y) - predicted);
+				if(distance <= maxDistance) {
+					candidates.push_back({distance, i, j});
+				}
+			}
+		}
+		std::sort(candidates.begin(), candidates.end(), [](const MarkMatch& lhs, const MarkMatch& rhs) {
+			return lhs.distance < rhs.distance;
+		});
+
+		std::vector<bool> isLayoutMarkMatched(layoutMarks.size(), false);
+		std::vector<bool> isImageMarkMatched(alignmentMarks.size(), false);
+		for(const MarkMatch& match : candidates) {
+			if(!isLayoutMarkMatched[match.layoutMark] && !isImageMarkMatched[match.imageMark]) {
+				isLayoutMarkMatched[match.layoutMark] = true;
+				isImageMarkMatched[match.imageMark] = true;
+				layoutPoints.push_back(cv::Point2f(layoutMarks[match.layoutMark].x, layoutMarks[match.layoutMark].y));
+				imagePoints.push_back(cv::Point2f((float)alignmentMarks[match.imageMark].x, (float)alignmentMarks[match.imageMark].y));
+			}
+		}
 
-	//Get edge detection threshold, which determines how sensitive the edge detection algorithm is. Lower values mean more sensitivity
-	if(!detectionParams.isFloat("circle-edge-detection-thresh")) {
-		status = -1;
-		tlOss << "Edge detection threshold (circle-edge-detection-thresh) property on \"" << detectionParams.getName() << "\" configuration must exist and be a number";
-		tlog.critical(__FILE__, __LINE__, tlOss);
+		TLOG_DEBUG(tlog, tlOss, "Matched " << layoutPoints.size() << " of the layout's " << layoutMarks.size() << " alignment marks to the " << alignmentMarks.size() << " marks found.");
+		if(layoutPoints.size() < 4) {
+			status = -1;
+			TLOG_CRITICAL(tlog, tlOss, "Unable to align image, only " << layoutPoints.size() << " alignment marks could be matched to the layout but at least 4 are needed.");
+		}
 	}
 
-	float edgeThreshold;
+	//Fit the homography from layout coordinates to image coordinates, leaving out any matches that don't agree with the rest
 	if(status >= 0) {
-		edgeThreshold = detectionParams.getAsFloat("circle-edge-detection-thresh");
-		if(edgeThreshold < 0) {
+		cv::Mat inliers;
+		layoutTransform_ = cv::findHomography(layoutPoints, imagePoints, cv::RANSAC, params.reprojectionThreshold * sheetImage_.cols, inliers);
+
+		if(layoutTransform_.empty()) {
 			status = -1;
-			tlOss << "Edge detection threshold (circle-edge-detection-thresh) property on \"" << detectionParams.getName() << "\" must be a non-negative number.";
-			tlog.critical(__FILE__, __LINE__, tlOss);
+			TLOG_CRITICAL(tlog, tlOss, "Unable to align image, failed to fit a transform to the alignment marks. The layout's alignment marks must not all lie on one line.");
 		} else {
-			tlOss << "Edge detection threshold set to " << edgeThreshold;
-			tlog.debug(__FILE__, __LINE__, tlOss);
+			TLOG_DEBUG(tlog, tlOss, "Fit layout transform to " << cv::countNonZero(inliers) << " of " << layoutPoints.size() << " matched alignment marks.");
 		}
 	}
 
-	//Get the circle accumulator threshold, which determines how circular a shape must be to be recognized as a circle. Higher values mean stricter circles
-	if(!detectionParams.isFloat("circle-accumulator-thresh")) {
-		status = -1;
-		tlOss << "Circle accumulator threshold (circle-accumulator-thresh) property on \"" << detectionParams.getName() << "\" configuration must exist and be a number";
-		tlog.critical(__FILE__, __LINE__, tlOss);
+	//Mark where the transform puts each of the layout's marks
+	if(status >= 0 && isAnnotationEnabled_) {
+		for(const EasyGrade::AlignmentMark& mark : layoutMarks) {
+			const cv::Point2f position = toImage(cv::Point2f(mark.x, mark.y));
+			cv::circle(annotatedImage_, cv::Point(cvRound(position.x), cvRound(position.y)), 5, cv::Scalar(255, 0, 255), 2);
+		}
 	}
 
-	float accumThreshold;
-	if(status >= 0) {
-		accumThreshold = detectionParams.getAsFloat("circle-accumulator-thresh");
-		if(accumThreshold < 0) {
-			status = -1;
-			tlOss << "Circle accumulator threshold (circle-accumulator-thresh) property on \"" << detectionParams.getName() << "\" must be a non-negative number.";
-			tlog.critical(__FILE__, __LINE__, tlOss);
-		} else {
-			tlOss << "Circle accumulator threshold set to " << accumThreshold;
-			tlog.debug(__FILE__, __LINE__, tlOss);
+	return status;
+}
+
+void SheetScan::findAlignmentMarks(const MarkParams& params, size_t minMarks, std::vector<cv::Point>& alignmentMarks, std::vector<std::vector<cv::Point>>& markOutlines) {
+	alignmentMarks.clear();
+	markOutlines.clear();
+
+	//Look for the marks on a downsampled copy of the image first, then only search the parts of the full resolution image around the
+	//candidates found. Fall back on searching the whole image if that doesn't find as many marks as are needed, since a partial set would
+	//throw off the alignment.
+	std::vector<cv::Rect> windows;
+	if(findMarkCandidates(params, windows) >= 0) {
+		for(const cv::Rect& window : windows) {
+			findAlignmentMarks(window, params, alignmentMarks, markOutlines);
 		}
 	}
 
-	//Get the minimum allowable distance between circle centers. This is a normalized coordinate. See SheetScan::normalize() for more details
-	if(!detectionParams.isFloat("circle-min-distance")) {
-		status = -1;
-		tlOss << "Minimum circle distance (circle-min-distance) property on \"" << detectionParams.getName() << "\" configuration must exist and be a number";
-		tlog.critical(__FILE__, __LINE__, tlOss);
+	if(alignmentMarks.size() < minMarks) {
+		TLOG_DEBUG(tlog, tlOss, "Found " << alignmentMarks.size() << " of " << minMarks << " alignment marks in downsampled search, searching whole image.");
+		alignmentMarks.clear();
+		markOutlines.clear();
+		findAlignmentMarks(cv::Rect(0, 0, processedImageCache_.cols, processedImageCache_.rows), params, alignmentMarks, markOutlines);
 	}
+}
 
-	int minDistanceAbsolute;
-	if(status >= 0) {
-		float minDistance = detectionParams.getAsFloat("circle-min-distance");
-		minDistanceAbsolute = absolute(minDistance);
-		if(minDistance < 0) {
-			status = -1;
-			tlOss << "Minimum circle distance (circle-min-distance) property on \"" << detectionParams.getName() << "\" must be a non-negative number.";
-			tlog.critical(__FILE__, __LINE__, tlOss);
-		} else {
-			tlOss << "Minimum circle distance set to " << minDistance << " (" << minDistanceAbsolute << "px)";
-			tlog.debug(__FILE__, __LINE__, tlOss);
+int SheetScan::findMarkCandidates(const MarkParams& params, std::vector<cv::Rect>& windows) {
+	int status = 0;
+
+	//Downsample as far as possible while the narrowest acceptable mark is still wide enough to survive
+	int factor = 0;
+	for(int candidateFactor : {8, 4}) {
+		if(factor == 0 && absolute(params.minWidth) >= MIN_COARSE_MARK_WIDTH * candidateFactor) {
+			factor = candidateFactor;
 		}
 	}
-
-	//Get the minimum allowable radius for a circle. This is a normalized coordinate.
-	if(!detectionParams.isFloat("circle-min-radius")) {
+	if(factor == 0) {
 		status = -1;
-		tlOss << "Minimum circle radius (circle-min-radius) property on \"" << detectionParams.getName() << "\" configuration must exist and be a number";
-		tlog.critical(__FILE__, __LINE__, tlOss);
+		TLOG_DEBUG(tlog, tlOss, "Alignment marks are too small to search for on a downsampled image.");
 	}
 
-	int minRadiusAbsolute;
+	std::vector<std::vector<cv::Point>> contours;
 	if(status >= 0) {
-		float minRadius = detectionParams.getAsFloat("circle-min-radius");
-		minRadiusAbsolute = absolute(minRadius);
-		if(minRadius < 0) {
-			status = -1;
-			tlOss << "Minimum circle radius (circle-min-radius) property on \"" << detectionParams.getName() << "\" must be a non-negative number.";
-			tlog.critical(__FILE__, __LINE__, tlOss);
-		} else {
-			tlOss << "Minimum circle radius set to " << minRadius << " (" << minRadiusAbsolute << "px)";
-			tlog.debug(__FILE__, __LINE__, tlOss);
+		//Area interpolation averages each block of pixels, so a block that is mostly part of a mark stays set while isolated specks of noise
+		//disappear, leaving far fewer contours to look at
+		cv::Mat coarse;
+		cv::resize(processedImageCache_, coarse, cv::Size(processedImageCache_.cols / factor, processedImageCache_.rows / factor), 0, 0, cv::INTER_AREA);
+		cv::threshold(coarse, coarse, 127, 255, CV_THRESH_BINARY);
+		cv::findContours(coarse, contours, CV_RETR_LIST, CV_CHAIN_APPROX_SIMPLE);
+	}
+
+	if(status >= 0) {
+		//The outline of a downsampled mark can be off by up to a block on every side, so relax the size limits by that much
+		const float tollerance = normalized(2.0f * factor);
+		const cv::Rect imageBounds(0, 0, processedImageCache_.cols, processedImageCache_.rows);
+
+		for(const std::vector<cv::Point>& contour : contours) {
+			cv::RotatedRect boundingBox = cv::minAreaRect(contour);
+			float height = normalized(factor * MAX(boundingBox.size.height, boundingBox.size.width));
+			float width = normalized(factor * MIN(boundingBox.size.height, boundingBox.size.width));
+
+			if(width + tollerance < params.minWidth || width - tollerance > params.maxWidth || height + tollerance < params.minHeight || height - tollerance > params.maxHeight) {
+				continue;
+			}
+
+			//Search a window around the candidate at full resolution, with a margin so that the whole mark is inside it
+			cv::Rect window = cv::boundingRect(contour);
+			window = cv::Rect((window.x - 2) * factor, (window.y - 2) * factor, (window.width + 4) * factor, (window.height + 4) * factor) & imageBounds;
+			windows.push_back(window);
 		}
+
+		mergeOverlapping(windows);
+		TLOG_DEBUG(tlog, tlOss, "Found " << windows.size() << " alignment mark candidates among " << contours.size() << " contours at 1/" << factor << " scale.");
 	}
 
-	//Get the maximum allowable radius for a circle. This is a normalized coordinate.
-	if(!detectionParams.isFloat("circle-max-radius")) {
-		status = -1;
-		tlOss << "Maximum circle radius (circle-min-radius) property on \"" << detectionParams.getName() << "\" configuration must exist and be a number";
-		tlog.critical(__FILE__, __LINE__, tlOss);
+	return status;
+}
+
+void SheetScan::findAlignmentMarks(const cv::Rect& window, const MarkParams& params, std::vector<cv::Point>& alignmentMarks, std::vector<std::vector<cv::Point>>& markOutlines) {
+	//Contours that touch the edge of the window may continue outside of it, so only accept ones that are entirely inside (unless the
+	//edge of the window is the edge of the image)
+	cv::Rect inner = window;
+	if(window.x > 0) {
+		inner.x++;
+		inner.width--;
+	}
+	if(window.y > 0) {
+		inner.y++;
+		inner.height--;
+	}
+	if(window.x + window.width < processedImageCache_.cols) {
+		inner.width--;
+	}
+	if(window.y + window.height < processedImageCache_.rows) {
+		inner.height--;
 	}
 
-	int maxRadiusAbsolute;
-	if(status >= 0) {
-		float maxRadius = detectionParams.getAsFloat("circle-max-radius");
-		maxRadiusAbsolute = absolute(maxRadius);
-		if(maxRadius < 0) {
-			status = -1;
-			tlOss << "Maximum circle radius (circle-max-radius) property on \"" << detectionParams.getName() << "\" must be a non-negative number.";
-			tlog.critical(__FILE__, __LINE__, tlOss);
-		} else {
-			tlOss << "Maximum circle radius set to " << maxRadius << " (" << maxRadiusAbsolute << "px)";
-			tlog.debug(__FILE__, __LINE__, tlOss);
+	std::vector<std::vector<cv::Point>> contours;
+	cv::findContours(processedImageCache_(window), contours, CV_RETR_LIST, CV_CHAIN_APPROX_TC89_L1, window.tl());
+
+	for(int i = 0; i < contours.size(); i++) {
+		const cv::Rect contourBounds = cv::boundingRect(contours[i]);
+		if((contourBounds & inner) != contourBounds) {
+			continue;
+		}
+
+		std::vector<cv::Point> approx;
+		cv::approxPolyDP(contours[i], approx, params.approxTollerance * cv::arcLength(contours[i], true), true);
+
+		if(approx.size() != 4) {
+			continue;
+		}
+
+		if(!cv::isContourConvex(approx)) {
+			continue;
+		}
+
+		cv::RotatedRect boundingBox = minAreaRect(approx);
+
+		float height = normalized(MAX(boundingBox.size.height, boundingBox.size.width));
+		float width = normalized(MIN(boundingBox.size.height, boundingBox.size.width));
+
+		//Check dimensions of contour are acceptable
+		if(width < params.minWidth || width > params.maxWidth || height < params.minHeight || height > params.maxHeight) {
+			continue;
+		}
+
+		if(getFilledFraction(processedImageCache_, boundingBox) < params.minFilled) {
+			continue;
 		}
+
+		markOutlines.push_back(approx);
+		alignmentMarks.push_back((cv::Point)boundingBox.center);
 	}
+}
+
+int SheetScan::findCirclesHough(std::vector<cv::Vec3f>& circles, const DetectionParams & detectionParams) {
+	int status = 0;
+
+	//Distances and radii are stored as normalized coordinates, so convert them to pixels for this image
+	const HoughCircleParams& params = detectionParams.getHoughCircleParams();
+	int minDistanceAbsolute = absolute(params.minDistance);
+	int minRadiusAbsolute = absolute(params.minRadius);
+	int maxRadiusAbsolute = absolute(params.maxRadius);
+
+	TLOG_DEBUG(tlog, tlOss, "Finding circles with radius between " << minRadiusAbsolute << "px and " << maxRadiusAbsolute << "px at least " << minDistanceAbsolute << "px apart");
 
 	//Find circles in the image
 	if(status >= 0) {
-		cv::HoughCircles(processedImageCache_, circles, CV_HOUGH_GRADIENT, 1, minDistanceAbsolute, edgeThreshold, accumThreshold, minRadiusAbsolute, maxRadiusAbsolute);
+		cv::HoughCircles(processedImageCache_, circles, CV_HOUGH_GRADIENT, 1, minDistanceAbsolute, params.edgeThreshold, params.accumulatorThreshold, minRadiusAbsolute, maxRadiusAbsolute);
 
 		//Normalize circle coordinates
 		for(cv::Vec3f& circle : circles) {
@@ -759,9 +1181,12 @@ int SheetScan::findCirclesHough(std::vector<cv::Vec3f>& circles, const Detection
 }
 
 void SheetScan::annotateCircle(const cv::Vec3f & circle, const cv::Scalar & color, int thickness) {
-	cv::Point center(absolute(circle[0]), absolute(circle[1]));
-	int radius = absolute(circle[2]);
-	cv::circle(annotatedImage_, center, radius, color, thickness);
+	const cv::Point2f imageCenter = toImage(cv::Point2f(circle[0], circle[1]));
+	cv::Point center(cvRound(imageCenter.x), cvRound(imageCenter.y));
+	int radius = imageRadius(circle);
+	if(isAnnotationEnabled_) {
+		cv::circle(annotatedImage_, center, radius, color, thickness);
+	}
 }
 
 void SheetScan::annotateCircles(const std::map<cv::Vec3f, cv::Scalar>& circles, int thickness) {
@@ -771,24 +1196,42 @@ void SheetScan::annotateCircles(const std::map<cv::Vec3f, cv::Scalar>& circles,
 }
 
 void SheetScan::annotateRect(const cv::Rect2f& rect, const cv::Scalar& color, int thickness) {
-	cv::Rect absoluteRect(absolute(rect.x), absolute(rect.y), absolute(rect.width), absolute(rect.height));
-	cv::rectangle(annotatedImage_, absoluteRect, color, thickness);
+	if(isAnnotationEnabled_) {
+		if(layoutTransform_.empty()) {
+			cv::Rect absoluteRect(absolute(rect.x), absolute(rect.y), absolute(rect.width), absolute(rect.height));
+			cv::rectangle(annotatedImage_, absoluteRect, color, thickness);
+		} else {
+			//The layout transform can turn the rectangle into any quadrilateral, so draw its outline corner to corner
+			std::vector<cv::Point> outline;
+			for(const cv::Point2f& corner : {rect.tl(), cv::Point2f(rect.x + rect.width, rect.y), rect.br(), cv::Point2f(rect.x, rect.y + rect.height)}) {
+				const cv::Point2f imageCorner = toImage(corner);
+				outline.push_back(cv::Point(cvRound(imageCorner.x), cvRound(imageCorner.y)));
+			}
+			cv::polylines(annotatedImage_, outline, true, color, thickness);
+		}
+	}
 }
 
 void SheetScan::resetAnnotations() {
-	annotatedImage_ = sheetImage_.clone();
-}
-
-QPixmap SheetScan::getAnnotatedPixmap() {
-	return matToPixmap(annotatedImage_);
+	if(isAnnotationEnabled_) {
+		//Annotations are drawn in color even if only a single channel of the scan was decoded
+		if(sheetImage_.channels() == 1) {
+			cv::cvtColor(sheetImage_, annotatedImage_, CV_GRAY2BGR);
+		} else {
+			annotatedImage_ = sheetImage_.clone();
+		}
+	} else {
+		annotatedImage_.release();
+	}
 }
 
-QPixmap SheetScan::getOriginalPixmap() {
-	return matToPixmap(sheetImage_);
+void SheetScan::setAnnotationsEnabled(bool isAnnotationEnabled) {
+	isAnnotationEnabled_ = isAnnotationEnabled;
+	resetAnnotations();
 }
 
-QPixmap SheetScan::getProcessedPixmap() {
-	return matToPixmap(processedImageCache_);
+bool SheetScan::isAnnotationEnabled() const {
+	return isAnnotationEnabled_;
 }
 
 int SheetScan::savePng(const cv::Mat& image, const std::string& filename, int compressionLevel) {
@@ -801,8 +1244,7 @@ int SheetScan::savePng(const cv::Mat& image, const std::string& filename, int co
 	try {
 		cv::imwrite(filename, image, compression_params);
 	} catch (std::runtime_error& ex) {
-		tlOss << "Failed to save PNG image \"" << filename << "\": " << ex.what();
-		tlog.critical(__FILE__, __LINE__, tlOss);
+		TLOG_CRITICAL(tlog, tlOss, "Failed to save PNG image \"" << filename << "\": " << ex.what());
 		status = -1;
 	}
 	
@@ -828,50 +1270,64 @@ cv::Point SheetScan::rotate(const cv::Point& point, const cv::Point& center, flo
 }
 
 float SheetScan::getFilledFraction(const cv::Mat & image, const cv::RotatedRect & region) {
-	//This function works by iterating over all of the pixels in the RotatedRect, counting how many of them are non-zero, and
-	//then dividing that by the total number of pixels checked. This is performed using two LineIterators. Consider the pixels
-	//inside a rotated rectangle as being arranged in a grid aligned with the rectangle. The outer for loop uses a line iterator
-	//to iterate across the top of the rectangle, while the inner for loop uses a line iterator to iterate down each column of
-	//the grid.
+	//This function counts every pixel whose center lies inside the rectangle, one row of the image at a time. The rectangle is convex, so the
+	//part of each row inside of it is a single run of pixels, running between the points where the row crosses the rectangle's edges. Each
+	//run is then counted in one pass over contiguous memory.
+
+	//Get the points at the corners of the rectangular region
+	cv::Point2f corners[4];
+	region.points(corners);
+
+	//The corners are calculated in floating point, so allow a little rounding error when deciding whether a pixel center that lies exactly
+	//on an edge is inside the rectangle
+	const float tollerance = 1e-3f;
 
-	//Because the rectangle is rotated, the actual grid of pixels may not line up exactly with the theoretical grid traversed
-	//using the method above. As a result, a few isolated pixels may be skipped. For a large and fairly uniform region this
-	//shouldn't significantly change the fraction of the pixels that are filled, but it means it is necessary to manually count
-	//the number seeen instead of just multiplying the dimenstions of the rectangle.
+	float top = corners[0].y;
+	float bottom = corners[0].y;
+	for(const cv::Point2f& corner : corners) {
+		top = std::min(top, corner.y);
+		bottom = std::max(bottom, corner.y);
+	}
+
+	//If the rectangle extends past the edge of the image, just ignore all the pixels hanging off the end
+	const int firstRow = std::max(0, cvCeil(top - tollerance));
+	const int lastRow = std::min(image.rows - 1, cvFloor(bottom + tollerance));
 
 	//Count the number of pixels checked
 	size_t countSeen = 0;
 	size_t countFilled = 0;
 
-	//Get the points at the corners of the rectangular region
-	cv::Point2f corners[4];
-	region.points(corners);
+	for(int row = firstRow; row <= lastRow; row++) {
+		//Find where the row enters and leaves the rectangle
+		float left = std::numeric_limits<float>::max();
+		float right = std::numeric_limits<float>::lowest();
+		for(int i = 0; i < 4; i++) {
+			const cv::Point2f& start = corners[i];
+			const cv::Point2f& end = corners[(i + 1) % 4];
+			if(row < std::min(start.y, end.y) - tollerance || row > std::max(start.y, end.y) + tollerance) {
+				continue;
+			}
 
-	cv::Point accrossStart = corners[0];
-	cv::Point accrossEnd = corners[1];
-	//downOffset represents the offset between the start of a column and the end of a column of the grid described above.
-	cv::Point downOffset = corners[3] - corners[0];
-
-	//Keep track of the current position in the image.
-	cv::Point currentPosition;
-
-	//Iterate accross the top row of the region
-	cv::LineIterator accrosItter = cv::LineIterator(image, accrossStart, accrossEnd, 4);
-	for(int i = 0; i < accrosItter.count; ++i, ++accrosItter) {
-		//Iterate down each column of the region
-		cv::LineIterator downItter = cv::LineIterator(image, accrosItter.pos(), accrosItter.pos() + downOffset, 4);
-		for(int j = 0; j < downItter.count; j++, ++downItter) {
-			currentPosition = downItter.pos();
-			//If the rectangle extands past the edge of the image, just ignore all the pixels hanging off the end
-			if(currentPosition.x < image.cols && currentPosition.y < image.rows) {
-				countSeen++;
-				uint8_t currentPixel = image.at<uint8_t>(currentPosition);
-				if(currentPixel != 0) {
-					countFilled++;
-				}
+			if(std::abs(end.y - start.y) <= tollerance) {
+				//The whole of a horizontal edge lies on the row
+				left = std::min(left, std::min(start.x, end.x));
+				right = std::max(right, std::max(start.x, end.x));
+			} else {
+				const float t = std::max(0.0f, std::min(1.0f, (row - start.y) / (end.y - start.y)));
+				const float x = start.x + t * (end.x - start.x);
+				left = std::min(left, x);
+				right = std::max(right, x);
 			}
 		}
+
+		const int firstCol = std::max(0, cvCeil(left - tollerance));
+		const int lastCol = std::min(image.cols - 1, cvFloor(right + tollerance));
+		if(firstCol <= lastCol) {
+			countSeen += lastCol - firstCol + 1;
+			countFilled += countNonZeroRun(image.ptr<uchar>(row) + firstCol, lastCol - firstCol + 1);
+		}
 	}
+
 	float fraction;
 	if(countSeen == 0) {
 		fraction = 0;
@@ -882,21 +1338,36 @@ float SheetScan::getFilledFraction(const cv::Mat & image, const cv::RotatedRect
 	return fraction;
 }
 
-QPixmap SheetScan::matToPixmap(const cv::Mat& mat) {
-	//Convert the image from BGR or gray (used by OpenCV) to RGB (used by QT)
-	cv::Mat rgbMat;
-	if(mat.data) {
-		if(mat.channels() == 3) {
-			cv::cvtColor(mat, rgbMat, CV_BGR2RGB);
-		} else {
-			cv::cvtColor(mat, rgbMat, CV_GRAY2RGB);
+int SheetScan::countNonZeroRun(const uchar* pixels, int width) {
+	int count = 0;
+	int x = 0;
+
+#if CV_SIMD128
+	const cv::v_uint8x16 zero = cv::v_setzero_u8();
+	const cv::v_uint8x16 one = cv::v_setall_u8(1);
+	while(x <= width - 16) {
+		//Count the non-zero pixels in each of the 16 lanes separately. A lane can only count to 255, so add the lanes' counts together at
+		//least every 255 blocks.
+		const int blocksEnd = std::min(width - 15, x + 255 * 16);
+		cv::v_uint8x16 laneCounts = zero;
+		for(; x < blocksEnd; x += 16) {
+			//Comparisons produce all ones for true and all zeros for false
+			laneCounts += ~(cv::v_load(pixels + x) == zero) & one;
 		}
+
+		cv::v_uint16x8 countsLow, countsHigh;
+		cv::v_expand(laneCounts, countsLow, countsHigh);
+		cv::v_uint32x4 sumsLow, sumsHigh;
+		cv::v_expand(countsLow + countsHigh, sumsLow, sumsHigh);
+		count += (int)cv::v_reduce_sum(sumsLow + sumsHigh);
 	}
-	
-	if(rgbMat.data) {
-		//Convert to QImage and then to QPixmap
-		return QPixmap::fromImage(QImage(rgbMat.data, rgbMat.cols, rgbMat.rows, rgbMat.step, QImage::Format_RGB888));
-	} else {
-		return QPixmap();
+#endif
+
+	for(; x < width; x++) {
+		if(pixels[x] != 0) {
+			count++;
+		}
 	}
+
+	return count;
 }
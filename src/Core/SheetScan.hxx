@@ -1,11 +1,35 @@
 #pragma once
 
+#include <map>
 #include <string>
-#include <opencv2\opencv.hpp>
-#include <QPixmap>
+#include <utility>
+#include <vector>
+#include <opencv2/opencv.hpp>
 
+#include "CompiledLayout.hxx"
 #include "DetectionParams.hxx"
+#include "ScanSheetLayout.hxx"
 
+///
+/// <summary> The result of checking one bubble on a scan </summary>
+///
+struct BubbleResult {
+	//What fraction of the bubble is filled in. Negative if the bubble could not be checked.
+	float fillScore{-1};
+	bool filled{false};
+};
+
+///
+/// <summary> How to decode a scan. Decoding only what the alignment and detection algorithms will use saves both decode time and memory. </summary>
+///
+struct DecodeHints {
+	//Which single channel of the image to keep. Negative to keep every channel. Ignored if grayscale is set.
+	int channel{-1};
+	//Whether to decode the image straight to grayscale
+	bool grayscale{false};
+	//How many times smaller to make the image while decoding it. Must be 1, 2, 4 or 8.
+	int reduction{1};
+};
 
 class SheetScan {
 public:
@@ -13,14 +37,34 @@ public:
 	SheetScan(const SheetScan& other);
 	~SheetScan();
 
+	//Copying deep copies the images (see the copy constructor); assigning would only share them, so it isn't allowed. Use clear() to free a scan.
+	SheetScan& operator=(const SheetScan&) = delete;
+
 	///
 	/// <summary> Load an image from a file. </summary>
 	///
 	/// <param name="filename"> The filename of the image to load. </param>
+	/// <param name="hints"> How to decode the image. By default every channel is decoded at full resolution. </param>
+	///
+	/// <returns> Integer status code. Negative if an error occured, non-negative if no error occured. </returns>
+	///
+	int load(const std::string& filename, const DecodeHints& hints = DecodeHints());
+
+	///
+	/// <summary> Use an image that has already been decoded (e.g. a page of a multi-page file) as the scan. The image's data is shared, not copied,
+	///           unless a single channel has to be extracted from it. </summary>
+	///
+	/// <param name="sheetImage"> The scanned image, decoded with the flags given by decodeFlags(hints). </param>
+	/// <param name="hints"> How the image was decoded. </param>
 	///
 	/// <returns> Integer status code. Negative if an error occured, non-negative if no error occured. </returns>
 	///
-	int load(const std::string& filename);
+	int load(const cv::Mat& sheetImage, const DecodeHints& hints = DecodeHints());
+
+	///
+	/// <summary> Get the cv::ImreadModes flags that decode an image the way a set of decode hints describes. </summary>
+	///
+	static int decodeFlags(const DecodeHints& hints);
 	int saveSheetImage(const std::string& filename);
 	int saveAnnotated(const std::string& filename);
 	int saveProcessedCache(const std::string& filename);
@@ -31,6 +75,11 @@ public:
 
 	bool empty();
 
+	///
+	/// <summary> Free the scan and everything computed from it, leaving this empty. Whether annotations are enabled is kept. </summary>
+	///
+	void clear();
+
 
 	///
 	/// <summary> Setup the image recognition algorithm used to detect wether bubbles are filled in. </summary>
@@ -41,8 +90,42 @@ public:
 	///
 	int setupAlgorithm(const DetectionParams& detectionParams);
 
+	///
+	/// <summary> Setup the image recognition algorithm used to detect wether bubbles are filled in, for checking the bubbles of a particular
+	///           side layout. If the detection configuration has a roi-padding property, only the regions around the side's question groups
+	///           are processed, so getProcessedCache() returns an empty image. </summary>
+	///
+	/// <param name="detectionParams"> Configuration for the image recognition algorithm. </param>
+	/// <param name="side"> The side layout whose bubbles will be checked </param>
+	///
+	/// <returns> Integer status code. Negative if an error occured, non-negative if no error occured. </returns>
+	///
+	int setupAlgorithm(const DetectionParams& detectionParams, const EasyGrade::SideLayout& side);
+
 	int alignScan(const DetectionParams& detectionParams);
 
+	///
+	/// <summary> Align the scan of a particular side of a sheet layout. Algorithms that match the detected alignment marks against the marks
+	///           on the side layout (THRESH_HOMOGRAPHY) need the layout, every other algorithm behaves the same as alignScan(detectionParams). </summary>
+	///
+	/// <param name="detectionParams"> Configuration for the alignment algorithm. setupAlgorithm must already have been called with it. </param>
+	/// <param name="side"> The side layout this is a scan of </param>
+	///
+	/// <returns> Integer status code. Negative if an error occured, non-negative if no error occured. </returns>
+	///
+	int alignScan(const DetectionParams& detectionParams, const EasyGrade::SideLayout& side);
+
+	///
+	/// <summary> Check whether the scan has been aligned by fitting a transform from layout coordinates to the image rather than by resampling
+	///           the image. If so, positions on the layout are mapped through the transform when checking bubbles and drawing annotations. </summary>
+	///
+	bool hasLayoutTransform() const;
+
+	///
+	/// <summary> Convert a point in normalized layout coordinates to absolute image coordinates, through the layout transform if there is one </summary>
+	///
+	cv::Point2f toImage(const cv::Point2f& point);
+
 	///
 	/// <summary> Check whether or not a circular region of the image is filled in. </summary>
 	///
@@ -55,6 +138,51 @@ public:
 	///
 	int isCircleFilled(const cv::Vec3f& circle, const DetectionParams& detectionParams);
 
+	///
+	/// <summary> Check every bubble on one side of a sheet layout in a single pass, using the THRESH_FRAC algorithm </summary>
+	///
+	/// <param name="side"> The side layout whose bubbles should be checked </param>
+	/// <param name="detectionParams"> Configuration for the image recognition algorithm. Must be the same as was passed to setupAlgorithm </param>
+	/// <param name="results"> Output parameter in which the result for each bubble will be placed, in the order the bubbles appear in the layout
+	///                        (group by group, question by question) </param>
+	///
+	/// <returns> Integer status code. Negative if an error occured, non-negative if no error occured. If some bubbles could not be checked the
+	///           status is negative, but every other bubble's result is still filled in. </returns>
+	///
+	/// <note> A side on its own has no flat index, so its bubbles are gathered from the tree first. Use the ScanSheetLayout overload when the
+	///        whole layout is at hand. </note>
+	///
+	int evaluateBubbles(const EasyGrade::SideLayout& side, const DetectionParams& detectionParams, std::vector<BubbleResult>& results);
+
+	///
+	/// <summary> Check every bubble on one side of a scan sheet layout in a single pass, using the THRESH_FRAC algorithm </summary>
+	///
+	/// <param name="layout"> The sheet layout </param>
+	/// <param name="sideNumber"> Which side of the layout this scan is of </param>
+	/// <param name="detectionParams"> Configuration for the image recognition algorithm. Must be the same as was passed to setupAlgorithm </param>
+	/// <param name="results"> Output parameter in which the result for each bubble will be placed, in layout order </param>
+	///
+	/// <returns> Integer status code. Negative if an error occured, non-negative if no error occured. If some bubbles could not be checked the
+	///           status is negative, but every other bubble's result is still filled in. </returns>
+	///
+	/// <note> The bubbles are found through the layout's flat index (see ScanSheetLayout::index()), so the index must be up to date </note>
+	///
+	int evaluateBubbles(const EasyGrade::ScanSheetLayout& layout, int sideNumber, const DetectionParams& detectionParams, std::vector<BubbleResult>& results);
+
+	///
+	/// <summary> Check every bubble on one side of a compiled layout in a single pass, using the THRESH_FRAC algorithm. The side's bubbles are read
+	///           straight from the compiled layout's arrays rather than by walking the layout tree. </summary>
+	///
+	/// <param name="layout"> The compiled sheet layout </param>
+	/// <param name="sideNumber"> Which side of the layout this scan is of </param>
+	/// <param name="detectionParams"> Configuration for the image recognition algorithm. Must be the same as was passed to setupAlgorithm </param>
+	/// <param name="results"> Output parameter in which the result for each bubble on the side will be placed, in layout order </param>
+	///
+	/// <returns> Integer status code. Negative if an error occured, non-negative if no error occured. If some bubbles could not be checked the
+	///           status is negative, but every other bubble's result is still filled in. </returns>
+	///
+	int evaluateBubbles(const EasyGrade::CompiledLayout& layout, int sideNumber, const DetectionParams& detectionParams, std::vector<BubbleResult>& results);
+
 	int findCircles(std::vector<cv::Vec3f>& circles, const DetectionParams& detectionParams);
 
 	///
@@ -71,9 +199,14 @@ public:
 
 	void resetAnnotations();
 
-	QPixmap getAnnotatedPixmap();
-	QPixmap getOriginalPixmap();
-	QPixmap getProcessedPixmap();
+	///
+	/// <summary> Enable or disable the annotated image. While disabled, the annotated image is empty and drawing on it or aligning it is
+	///           skipped, which saves a copy and a resample of the image when nothing will look at the annotations. Enabled by default. </summary>
+	///
+	/// <param name="isAnnotationEnabled"> Whether to keep the annotated image </param>
+	///
+	void setAnnotationsEnabled(bool isAnnotationEnabled);
+	bool isAnnotationEnabled() const;
 
 private:
 
@@ -82,15 +215,188 @@ private:
 	///           brightness is greater than the cutoff value become white.
 	///
 	/// <param name="detectionParams"> Configuration for the threshold algorithm. </param>
+	/// <param name="regions"> The regions of the image to threshold, in absolute coordinates. Must not overlap. If empty, the whole image is
+	///                        thresholded and placed in processedImageCache_, otherwise processedImageCache_ is left empty. </param>
 	///
 	/// <returns> Integer status code, negative if an error occured, non-negative if no error occured. </returns>
 	///
 	/// <note> This function is considered part of the initialization stage of an image processing algorithm. As such, it uses sheetImage_ as its
-	///        input image and processedCache_ as its output image. No member variables will be changed besides processedCache_ </note>
+	///        input image and processedCache_ and processedRegions_ as its output. No other member variables will be changed. </note>
 	///
-	int threshold(const DetectionParams& detectionParams);
+	int threshold(const DetectionParams& detectionParams, const std::vector<cv::Rect>& regions = std::vector<cv::Rect>());
+
+	///
+	/// <summary> Get the regions of the image around each question group on a side layout, merging any that overlap </summary>
+	///
+	/// <param name="side"> The side layout </param>
+	/// <param name="padding"> How far to extend each region past its question group's bounding box, in normalized coordinates </param>
+	///
+	/// <returns> The regions, in absolute coordinates, clipped to the image </returns>
+	///
+	std::vector<cv::Rect> layoutRegions(const EasyGrade::SideLayout& side, float padding);
+
+	///
+	/// <summary> Replace any rectangles that overlap with the smallest rectangle containing both, until none overlap </summary>
+	///
+	static void mergeOverlapping(std::vector<cv::Rect>& rects);
 	int isCircleFilledFrac(const cv::Vec3f& circle, const DetectionParams& detectionParams);
-	int alignScanContour(const DetectionParams& detectionParams);
+
+	///
+	/// <summary> Get the square region of the processed image that the THRESH_FRAC algorithm checks for a circle </summary>
+	///
+	/// <param name="circle"> The circle, in normalized coordinates </param>
+	/// <param name="region"> Output parameter in which the region, in absolute coordinates, will be placed </param>
+	///
+	/// <returns> The index of the processed region containing the region. Negative if the region is empty or is not within a processed region. </returns>
+	///
+	int fracRegion(const cv::Vec3f& circle, cv::Rect& region);
+
+	///
+	/// <summary> Get the region of the processed image covered by a bubble's bounding box </summary>
+	///
+	/// <param name="boundingBox"> The bubble's bounding box, in normalized coordinates </param>
+	/// <param name="region"> Output parameter in which the region, in absolute coordinates, will be placed </param>
+	///
+	/// <returns> The index of the processed region containing the region. Negative if the region is empty or is not within a processed region. </returns>
+	///
+	int fracRegion(const EasyGrade::Rectangle& boundingBox, cv::Rect& region);
+
+	///
+	/// <summary> Get the region of the processed image that the THRESH_FRAC algorithm checks for a bubble: either its whole bounding box or the
+	///           square around the largest circle that fits inside it </summary>
+	///
+	/// <param name="left, top, right, bottom"> The edges of the bubble, in normalized coordinates </param>
+	/// <param name="isElliptical"> Whether the ellipse inscribed in the bounding box is checked rather than a circle </param>
+	/// <param name="region"> Output parameter in which the region, in absolute coordinates, will be placed </param>
+	///
+	/// <returns> The index of the processed region containing the region. Negative if the region is empty or is not within a processed region. </returns>
+	///
+	int bubbleRegion(float left, float top, float right, float bottom, bool isElliptical, cv::Rect& region);
+
+	///
+	/// <summary> Check that a detection algorithm can be used to check a whole side of bubbles at once </summary>
+	///
+	int checkBubbleParams(const DetectionParams& detectionParams);
+
+	///
+	/// <summary> Check a run of bubbles from a layout tree in a single pass, using the THRESH_FRAC algorithm </summary>
+	///
+	/// <param name="bubbles"> The bubbles to check </param>
+	/// <param name="detectionParams"> Configuration for the image recognition algorithm. Must be the same as was passed to setupAlgorithm </param>
+	/// <param name="results"> Output parameter in which the result for each bubble will be placed, in the same order as the bubbles </param>
+	///
+	/// <returns> Integer status code. Negative if an error occured, non-negative if no error occured. </returns>
+	///
+	int evaluateBubbleRange(const EasyGrade::ElementRange<EasyGrade::BubbleLayout>& bubbles, const DetectionParams& detectionParams, std::vector<BubbleResult>& results);
+
+	///
+	/// <summary> Measure the regions of a side's bubbles, found with SheetScan::bubbleRegion(), visiting them from the top of the image to the bottom </summary>
+	///
+	/// <param name="regions"> The region of each bubble. Bubbles with an empty region are left with the default (negative) score. </param>
+	/// <param name="processedRegions"> The processed region containing each bubble's region </param>
+	/// <param name="params"> The THRESH_FRAC parameters to measure the bubbles with </param>
+	/// <param name="results"> Output parameter in which the result for each bubble will be placed, in the same order as the regions </param>
+	///
+	void measureBubbles(const std::vector<cv::Rect>& regions, const std::vector<int>& processedRegions, const ThreshFracParams& params, std::vector<BubbleResult>& results);
+
+	///
+	/// <summary> Find the processed region that a region of the image lies entirely within </summary>
+	///
+	/// <returns> The index of the processed region. Negative if the region is empty or is not within a processed region. </returns>
+	///
+	int checkRegion(const cv::Rect& region);
+
+	///
+	/// <summary> Get what fraction of a region of the processed image is non-zero. Uses the summed-area table if one was built. </summary>
+	///
+	/// <param name="region"> The region to check, in absolute coordinates. Must be non-empty and within the processed region. </param>
+	/// <param name="processedRegion"> The index of the processed region containing the region, as returned by SheetScan::checkRegion() </param>
+	/// <param name="isElliptical"> Whether to only count the ellipse inscribed in the region rather than the whole region </param>
+	///
+	double fracFilled(const cv::Rect& region, int processedRegion, bool isElliptical);
+
+	///
+	/// <summary> Get the mask of the ellipse inscribed in a rectangle of the given size, as the range of columns inside the ellipse on each row.
+	///           Masks are cached, since every bubble on a sheet is usually the same size. </summary>
+	///
+	const std::vector<cv::Range>& ellipseMask(int width, int height);
+
+	///
+	/// <summary> Build a summed-area table of each processed region, counting each non-zero pixel as one </summary>
+	///
+	void buildIntegral();
+
+	///
+	/// <summary> Get the region of the image covered by a rectangle on the layout. Each edge is converted separately, so neighboring rectangles
+	///           line up the same way they do on the layout. </summary>
+	///
+	/// <param name="left"> left, top, right and bottom are the edges of the rectangle, in normalized layout coordinates </param>
+	///
+	/// <returns> The smallest rectangle, in absolute coordinates, containing the whole rectangle once converted to image coordinates </returns>
+	///
+	cv::Rect imageRegion(float left, float top, float right, float bottom);
+
+	///
+	/// <summary> Get the radius, in pixels, of a circle on the layout once converted to image coordinates </summary>
+	///
+	int imageRadius(const cv::Vec3f& circle);
+
+	///
+	/// <summary> Align the scan with the THRESH_CONTOUR algorithm, rotating and cropping it around its leftmost and rightmost alignment marks </summary>
+	///
+	/// <param name="detectionParams"> Configuration for the alignment algorithm </param>
+	/// <param name="numMarks"> How many alignment marks the scan should have. At least 2. </param>
+	///
+	/// <returns> Integer status code. Negative if an error occured, non-negative if no error occured. </returns>
+	///
+	int alignScanContour(const DetectionParams& detectionParams, size_t numMarks = 2);
+
+	///
+	/// <summary> Align the scan by fitting a homography from the alignment marks on a side layout to the marks detected on the scan. The image
+	///           is not resampled; the homography is kept in layoutTransform_ and used to find bubbles on the unaligned image. </summary>
+	///
+	/// <param name="detectionParams"> Configuration for the alignment algorithm </param>
+	/// <param name="side"> The side layout this is a scan of. Must have at least 4 alignment marks, not all on one line. </param>
+	///
+	/// <returns> Integer status code. Negative if an error occured, non-negative if no error occured. </returns>
+	///
+	int alignScanHomography(const DetectionParams& detectionParams, const EasyGrade::SideLayout& side);
+
+	///
+	/// <summary> Find every alignment mark on the processed image. Searches a downsampled copy of the image first, then only the parts of the
+	///           full resolution image around the candidates found, falling back on searching the whole image if that finds fewer than the
+	///           caller needs. </summary>
+	///
+	/// <param name="params"> Configuration for the alignment algorithm </param>
+	/// <param name="minMarks"> How many marks the caller needs. The whole image is searched if the downsampled search finds fewer. </param>
+	/// <param name="alignmentMarks"> Output parameter in which the center of each mark will be placed </param>
+	/// <param name="markOutlines"> Output parameter in which the outline of each mark will be placed </param>
+	///
+	void findAlignmentMarks(const MarkParams& params, size_t minMarks, std::vector<cv::Point>& alignmentMarks, std::vector<std::vector<cv::Point>>& markOutlines);
+
+	///
+	/// <summary> Search a downsampled copy of the processed image for anything that could be an alignment mark </summary>
+	///
+	/// <param name="params"> Configuration for the alignment algorithm </param>
+	/// <param name="windows"> Output parameter to which the regions of the full resolution image around the candidates will be appended.
+	///                        The regions do not overlap. </param>
+	///
+	/// <returns> Integer status code. Negative if the marks are too small to search for on a downsampled image, non-negative otherwise. </returns>
+	///
+	int findMarkCandidates(const MarkParams& params, std::vector<cv::Rect>& windows);
+
+	///
+	/// <summary> Find the alignment marks within a region of the processed image </summary>
+	///
+	/// <param name="window"> The region to search, in absolute coordinates. Only marks entirely inside of it are found. </param>
+	/// <param name="params"> Configuration for the alignment algorithm </param>
+	/// <param name="alignmentMarks"> Output parameter to which the center of each mark will be appended </param>
+	/// <param name="markOutlines"> Output parameter to which the outline of each mark will be appended </param>
+	///
+	void findAlignmentMarks(const cv::Rect& window, const MarkParams& params, std::vector<cv::Point>& alignmentMarks, std::vector<std::vector<cv::Point>>& markOutlines);
+
+	//How wide, in pixels, the narrowest acceptable alignment mark has to be after downsampling for the downsampled search to find it
+	static constexpr float MIN_COARSE_MARK_WIDTH = 1.5f;
 
 	int findCirclesHough(std::vector<cv::Vec3f>& circles, const DetectionParams& detectionParams);
 
@@ -131,18 +437,21 @@ private:
 
 	///
 	/// <summary> Get what fraction a rectangular region of an image is "filled in" (i.e. what fraction of the pixels in the region are non-zero). If the rectangle
-	///           extends past the edge of the image the empty space will simply be ignored and will not affect the result. </summary>
+	///           extends past the edge of the image the empty space will simply be ignored and will not affect the result. Every pixel whose center lies
+	///           inside the rectangle is counted exactly once. </summary>
 	///
 	/// <param name="image"> The image to check </param>
 	/// <param name="region"> The region of the image, specified as a rotated rectangle </param>
 	///
 	/// <returns> The fraction of the region's pixels that are non-zero </returns>
 	///
-	/// <note> The way this function traverses the region will occasionally skip several pixels. As a result, the results of this function are somewhat imprecise.
-	///        These missed pixels will never be contiguous and with moderately large regions on typical real-world images will not have a significan effect. </note>
-	///
 	static float getFilledFraction(const cv::Mat& image, const cv::RotatedRect& region);
 
+	///
+	/// <summary> Count the non-zero pixels in a run of contiguous 8 bit pixels </summary>
+	///
+	static int countNonZeroRun(const uchar* pixels, int width);
+
 	///
 	/// <summary> Save an image as a PNG </summary>
 	///
@@ -156,11 +465,34 @@ private:
 	///
 	static int savePng(const cv::Mat& image, const std::string& filename, int compressionLevel = 3);
 
-	static QPixmap matToPixmap(const cv::Mat& mat);
-
 	SheetScan(const cv::Mat& sheetImage);
 	cv::Mat sheetImage_{};
 	cv::Mat processedImageCache_{};
+
+	///
+	/// <summary> A part of the image that has been processed by the initialization step of an algorithm </summary>
+	///
+	struct ProcessedRegion {
+		//Where the region is on the sheet image, in absolute coordinates
+		cv::Rect bounds{};
+		cv::Mat image{};
+		//Summed-area table of the region built by the THRESH_FRAC algorithm if requested. Empty if it has not been built.
+		cv::Mat integral{};
+	};
+
+	//The processed parts of the image. When the whole image is processed this is a single region sharing its data with processedImageCache_.
+	std::vector<ProcessedRegion> processedRegions_{};
+	//Ellipse masks built by ellipseMask(), keyed by width and height in pixels
+	std::map<std::pair<int, int>, std::vector<cv::Range>> ellipseMaskCache_{};
 	cv::Mat annotatedImage_{};
+	bool isAnnotationEnabled_{true};
+	//Transform from normalized layout coordinates to absolute image coordinates (3x3, CV_64F), found by THRESH_HOMOGRAPHY alignment or by
+	//THRESH_CONTOUR alignment with transform-only set. Empty if the image itself was aligned, in which case normalized coordinates map
+	//directly onto the image.
+	cv::Mat layoutTransform_{};
+	//If sheetImage_ has a single channel, which channel of the scan it holds. Negative if it holds the whole scan converted to grayscale.
+	int decodedChannel_{-1};
+	//How many times smaller than the original scan sheetImage_ was decoded
+	int decodeReduction_{1};
 };
 
@@ -8,24 +8,17 @@
 
 #include "TextLogging.hxx"
 
-const std::string DEFAULT_COLOR = "\033[0m";
-const std::string WHITE_COLOR = "\033[1;37m";
-const std::string RED_COLOR = "\033[1;31m";
-const std::string GREEN_COLOR = "\033[0;32m";
-const std::string YELLOW_COLOR = "\033[1;33m";
-const std::string MAGENTA_COLOR = "\033[1;35m";
-
-bool TextLogging::isDebugVerbosityEnabledDefault_ = false;
-bool TextLogging::isInfoVerbosityEnabledDefault_ = true;
-bool TextLogging::isWarningVerbosityEnabledDefault_ = true;
-bool TextLogging::isCriticalVerbosityEnabledDefault_ = true;
-bool TextLogging::isFatalVerbosityEnabledDefault_ = true;
-bool TextLogging::isColorTextEnabledDefault_ = true;
+std::atomic<bool> TextLogging::isDebugVerbosityEnabledDefault_{false};
+std::atomic<bool> TextLogging::isInfoVerbosityEnabledDefault_{true};
+std::atomic<bool> TextLogging::isWarningVerbosityEnabledDefault_{true};
+std::atomic<bool> TextLogging::isCriticalVerbosityEnabledDefault_{true};
+std::atomic<bool> TextLogging::isFatalVerbosityEnabledDefault_{true};
+std::atomic<bool> TextLogging::isColorTextEnabledDefault_{true};
 
 std::string TextLogging::logDir_ = "./logs/";
 std::string TextLogging::logName_ = generateLogFileName();
 
-std::ofstream TextLogging::logFile_ = std::ofstream(logName_, std::ios_base::app);
+AsyncLogSink TextLogging::logSink_(logName_);
 
 
 TextLogging::TextLogging() {
@@ -40,109 +33,74 @@ TextLogging::TextLogging() {
 
 TextLogging::~TextLogging() = default;
 
-void TextLogging::debug(char * file, int line, std::ostringstream& tlOss) {
-	if(isDebugVerbosityEnabled_ || isDebugVerbosityEnabledDefault_) {
+void TextLogging::debug(const char * file, int line, std::ostringstream& tlOss) {
+	if(isEnabled(LogLevel::DEBUG)) {
 		log(file, line, tlOss, LogLevel::DEBUG);
 	}
 	//Reset the supplied ostringstream so that it can be reused.
 	tlOss.str("");
 }
 
-void TextLogging::info(char * file, int line, std::ostringstream& tlOss) {
-	if(isInfoVerbosityEnabled_ || isInfoVerbosityEnabledDefault_) {
+void TextLogging::info(const char * file, int line, std::ostringstream& tlOss) {
+	if(isEnabled(LogLevel::INFO)) {
 		log(file, line, tlOss, LogLevel::INFO);
 	}
 	//Reset the supplied ostringstream so that it can be reused.
 	tlOss.str("");
 }
 
-void TextLogging::warning(char * file, int line, std::ostringstream& tlOss) {
-	if(isWarningVerbosityEnabled_ || isWarningVerbosityEnabledDefault_) {
+void TextLogging::warning(const char * file, int line, std::ostringstream& tlOss) {
+	if(isEnabled(LogLevel::WARNING)) {
 		log(file, line, tlOss, LogLevel::WARNING);
 	}
 	//Reset the supplied ostringstream so that it can be reused.
 	tlOss.str("");
 }
 
-void TextLogging::critical(char * file, int line, std::ostringstream& tlOss) {
-	if(isCriticalVerbosityEnabled_ || isCriticalVerbosityEnabledDefault_) {
+void TextLogging::critical(const char * file, int line, std::ostringstream& tlOss) {
+	if(isEnabled(LogLevel::CRITICAL)) {
 		log(file, line, tlOss, LogLevel::CRITICAL);
 	}
 	//Reset the supplied ostringstream so that it can be reused.
 	tlOss.str("");
 }
 
-void TextLogging::fatal(char * file, int line, std::ostringstream& tlOss) {
-	if(isFatalVerbosityEnabled_ || isFatalVerbosityEnabledDefault_) {
+void TextLogging::fatal(const char * file, int line, std::ostringstream& tlOss) {
+	if(isEnabled(LogLevel::FATAL)) {
 		log(file, line, tlOss, LogLevel::FATAL);
 	}
 	//Reset the supplied ostringstream so that it can be reused.
 	tlOss.str("");
+	//Make sure the entry (and everything logged before it) reaches the log file before the program is killed
+	logSink_.flush();
 	//Kill the program if a fatal error occurs
 	raise(SIGTERM);
 }
 
-void TextLogging::log(char * file, int line, std::ostringstream & tlOss, LogLevel level) {
-
-	//Set the text to the appropriate color (if color text is enabled)
-	if(isColorTextEnabled_) {
-		switch(level) {
-		case LogLevel::DEBUG:
-			logFile_ << GREEN_COLOR;
-			break;
-		case LogLevel::INFO:
-			logFile_ << WHITE_COLOR;
-			break;
-		case LogLevel::WARNING:
-			logFile_ << YELLOW_COLOR;
-			break;
-		case LogLevel::CRITICAL:
-			logFile_ << MAGENTA_COLOR;
-			break;
-		case LogLevel::FATAL:
-			logFile_ << RED_COLOR;
-			break;
-		default:
-			logFile_ << DEFAULT_COLOR;
-		}
-	}
-
-	//Log the warning severity
+bool TextLogging::isEnabled(LogLevel level) const {
 	switch(level) {
 	case LogLevel::DEBUG:
-		logFile_ << "DEBUG: ";
-		break;
+		return isDebugVerbosityEnabled_ || isDebugVerbosityEnabledDefault_;
 	case LogLevel::INFO:
-		logFile_ << "INFO: ";
-		break;
+		return isInfoVerbosityEnabled_ || isInfoVerbosityEnabledDefault_;
 	case LogLevel::WARNING:
-		logFile_ << "WARN: ";
-		break;
+		return isWarningVerbosityEnabled_ || isWarningVerbosityEnabledDefault_;
 	case LogLevel::CRITICAL:
-		logFile_ << "CRIT: ";
-		break;
+		return isCriticalVerbosityEnabled_ || isCriticalVerbosityEnabledDefault_;
 	case LogLevel::FATAL:
-		logFile_ << "FATAL: ";
-		break;
+		return isFatalVerbosityEnabled_ || isFatalVerbosityEnabledDefault_;
 	default:
-		logFile_ << ": ";
-	}
-
-	//Log the file/line info
-	logFile_ << file << " #" << line << ": ";
-
-	//Log the warning message
-	logFile_ << tlOss.str();
-
-	//Reset the text color
-	if(isColorTextEnabled_) {
-		logFile_ << DEFAULT_COLOR;
+		return true;
 	}
+}
 
-	logFile_ << std::endl;
+void TextLogging::log(const char * file, int line, std::ostringstream & tlOss, LogLevel level) {
+	//Formatting and writing the entry happens on the log sink's background thread
+	logSink_.push(level, file, line, tlOss.str(), isColorTextEnabled_);
+}
 
-	//Write the new log entry to the log file.
-	logFile_.flush();
+void TextLogging::flush() {
+	logSink_.flush();
 }
 
 std::string TextLogging::generateLogFileName() {
@@ -189,6 +147,14 @@ void TextLogging::setIsColorTextEnabled(bool isEnabled) {
 	isColorTextEnabled_ = isEnabled;
 }
 
+void TextLogging::setOverflowPolicy(LogOverflowPolicy overflowPolicy) {
+	logSink_.setOverflowPolicy(overflowPolicy);
+}
+
+uint64_t TextLogging::getNumDroppedEntries() {
+	return logSink_.getNumDroppedEntries();
+}
+
 // Setters for defaults
 
 void TextLogging::setIsDebugVerbosityEnabledDefault(bool isEnabled) {
@@ -1,18 +1,31 @@
 #pragma once
 
+#include <atomic>
 #include <string>
-#include <fstream>
 
+#include "AsyncLogSink.hxx"
+
+///
+/// <summary> Writes entries to the session's log file. Entries are handed to a background thread to be written, so logging does not wait on the
+///           disk. Any number of threads may log at once as long as each thread uses its own TextLogging instance and std::ostringstream (i.e.
+///           declare them thread_local). </summary>
+///
 class TextLogging {
 public:
 	TextLogging();
 	~TextLogging();
 
-	void debug(char *file, int line, std::ostringstream& tlOss);
-	void info(char *file, int line, std::ostringstream& tlOss);
-	void warning(char *file, int line, std::ostringstream& tlOss);
-	void critical(char *file, int line, std::ostringstream& tlOss);
-	void fatal(char *file, int line, std::ostringstream& tlOss);
+	void debug(const char *file, int line, std::ostringstream& tlOss);
+	void info(const char *file, int line, std::ostringstream& tlOss);
+	void warning(const char *file, int line, std::ostringstream& tlOss);
+	void critical(const char *file, int line, std::ostringstream& tlOss);
+	void fatal(const char *file, int line, std::ostringstream& tlOss);
+
+	///
+	/// @brief: Check whether entries of a particular level would be included in the log. Used by the TLOG_* macros to skip formatting
+	///         messages that would be discarded.
+	///
+	bool isEnabled(LogLevel level) const;
 
 	///
 	/// @brief: Set whether DEBUG entries should be included in the log
@@ -79,22 +92,29 @@ public:
 
 	static std::string getLogFileName();
 
-private:
+	///
+	/// @brief: Wait until every entry logged so far (by any thread) has been written to the log file
+	///
+	static void flush();
 
-	enum class LogLevel {
-		DEBUG,
-		INFO,
-		WARNING,
-		CRITICAL,
-		FATAL
-	};
+	///
+	/// @brief: Set what happens when entries are logged faster than they can be written to the log file. Defaults to LogOverflowPolicy::BLOCK.
+	///
+	static void setOverflowPolicy(LogOverflowPolicy overflowPolicy);
+
+	///
+	/// @brief: Get the number of entries that were discarded because they were logged faster than they could be written
+	///
+	static uint64_t getNumDroppedEntries();
 
-	void log(char *file, int line, std::ostringstream& tlOss, LogLevel level);
+private:
+
+	void log(const char *file, int line, std::ostringstream& tlOss, LogLevel level);
 	static std::string generateLogFileName();
 
 	static std::string logDir_;
 	static std::string logName_;
-	static std::ofstream logFile_;
+	static AsyncLogSink logSink_;
 
 	bool isDebugVerbosityEnabled_;
 	bool isInfoVerbosityEnabled_;
@@ -103,11 +123,43 @@ private:
 	bool isFatalVerbosityEnabled_;
 	bool isColorTextEnabled_;
 
-	static bool isDebugVerbosityEnabledDefault_;
-	static bool isInfoVerbosityEnabledDefault_;
-	static bool isWarningVerbosityEnabledDefault_;
-	static bool isCriticalVerbosityEnabledDefault_;
-	static bool isFatalVerbosityEnabledDefault_;
-	static bool isColorTextEnabledDefault_;
+	static std::atomic<bool> isDebugVerbosityEnabledDefault_;
+	static std::atomic<bool> isInfoVerbosityEnabledDefault_;
+	static std::atomic<bool> isWarningVerbosityEnabledDefault_;
+	static std::atomic<bool> isCriticalVerbosityEnabledDefault_;
+	static std::atomic<bool> isFatalVerbosityEnabledDefault_;
+	static std::atomic<bool> isColorTextEnabledDefault_;
 };
 
+
+///
+/// @brief: Log a message through a TextLogging instance, formatting it into tlOss only if the entry's level is enabled. The message is anything
+///         that can follow "tlOss <<", e.g. TLOG_INFO(tlog, tlOss, "Loaded " << count << " sheets");
+///
+/// @note: DEBUG entries are removed at compile time when NDEBUG is defined (i.e. in release builds), so their messages are never evaluated.
+///        Define TLOG_KEEP_DEBUG to keep them.
+///
+#define TLOG_ENTRY(tlog, tlOss, level, method, message) \
+	do { \
+		if((tlog).isEnabled(level)) { \
+			(tlOss) << message; \
+			(tlog).method(__FILE__, __LINE__, (tlOss)); \
+		} \
+	} while(false)
+
+#if defined(NDEBUG) && !defined(TLOG_KEEP_DEBUG)
+#define TLOG_DEBUG(tlog, tlOss, message) do {} while(false)
+#else
+#define TLOG_DEBUG(tlog, tlOss, message) TLOG_ENTRY(tlog, tlOss, LogLevel::DEBUG, debug, message)
+#endif
+
+#define TLOG_INFO(tlog, tlOss, message) TLOG_ENTRY(tlog, tlOss, LogLevel::INFO, info, message)
+#define TLOG_WARNING(tlog, tlOss, message) TLOG_ENTRY(tlog, tlOss, LogLevel::WARNING, warning, message)
+#define TLOG_CRITICAL(tlog, tlOss, message) TLOG_ENTRY(tlog, tlOss, LogLevel::CRITICAL, critical, message)
+
+//Fatal entries always kill the program, so they are always formatted and logged
+#define TLOG_FATAL(tlog, tlOss, message) \
+	do { \
+		(tlOss) << message; \
+		(tlog).fatal(__FILE__, __LINE__, (tlOss)); \
+	} while(false)
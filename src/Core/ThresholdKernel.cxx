@@ -0,0 +1,136 @@
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+#include <opencv2/core/hal/intrin.hpp>
+
+#include "ThresholdKernel.hxx"
+
+void ThresholdKernel::apply(const cv::Mat& image, const ThreshParams& params, cv::Mat& output, int reduction) {
+	apply(image, params, cv::Rect(0, 0, image.cols, image.rows), output, reduction);
+}
+
+void ThresholdKernel::apply(const cv::Mat& image, const ThreshParams& params, const cv::Rect& region, cv::Mat& output, int reduction) {
+	//The preblur and block size are calibrated against the original scan, so shrink them along with the image. The neighborhood has to stay
+	//at least 3x3 for the mean to differ from the pixel itself.
+	const int blurSize = scaleKernelSize(params.preblur, reduction);
+	const int blockSize = std::max(3, scaleKernelSize(static_cast<float>(BLOCK_SIZE), reduction));
+
+	//How many rows and columns around a pixel of the blurred image are needed to compute the mean of its neighborhood
+	const int blockRadius = blockSize / 2;
+
+	//cv::adaptiveThreshold rounds the offset up for THRESH_BINARY. Offsets beyond +/-256 behave the same as +/-256, since the difference between
+	//two 8 bit pixels is always within +/-255, so clamp it to keep it in range of the 16 bit lanes used by thresholdRow()
+	const int delta = std::max(-256, std::min(256, cvCeil(params.threshold)));
+
+	output.create(region.height, region.width, CV_8UC1);
+
+	//Range of blurred columns the neighborhoods of the region's pixels cover
+	const cv::Range columns(std::max(0, region.x - blockRadius), std::min(image.cols, region.x + region.width + blockRadius));
+	const int cols = columns.size();
+
+	//Holds the rows of the blurred image that the current strip needs. Rows shared with the previous strip are kept rather than recomputed.
+	std::vector<uchar> blurredData(static_cast<size_t>(std::min(image.rows, STRIP_HEIGHT + 2 * blockRadius)) * cols);
+	int blurredFirst = 0;
+	int blurredLast = 0;
+
+	cv::Mat mean;
+
+	for(int stripFirst = region.y; stripFirst < region.y + region.height; stripFirst += STRIP_HEIGHT) {
+		const int stripLast = std::min(region.y + region.height, stripFirst + STRIP_HEIGHT);
+
+		//Range of blurred rows the neighborhoods of this strip's pixels cover
+		const int neededFirst = std::max(0, stripFirst - blockRadius);
+		const int neededLast = std::min(image.rows, stripLast + blockRadius);
+
+		//Move the blurred rows already computed for the previous strip to the start of the buffer, then compute the rest
+		const int keptFirst = std::max(neededFirst, blurredFirst);
+		if(keptFirst < blurredLast) {
+			std::memmove(blurredData.data(), blurredData.data() + static_cast<size_t>(keptFirst - blurredFirst) * cols, static_cast<size_t>(blurredLast - keptFirst) * cols);
+		} else {
+			blurredLast = neededFirst;
+		}
+		blurredFirst = neededFirst;
+		blurRows(image, params, blurSize, blurredLast, neededLast, columns, blurredData.data() + static_cast<size_t>(blurredLast - blurredFirst) * cols);
+		blurredLast = neededLast;
+
+		//The buffer is wrapped in a header of its own (rather than being a region of a larger image) and the border flags match the ones
+		//cv::adaptiveThreshold uses, so that OpenCV takes exactly the same code path as it would for the whole image. Pixels within blockRadius
+		//of the buffer's edges are only correct where the buffer's edge is also the image's edge, which is exactly the set of pixels used below.
+		cv::Mat blurred(blurredLast - blurredFirst, cols, CV_8UC1, blurredData.data());
+		cv::boxFilter(blurred, mean, CV_8U, cv::Size(blockSize, blockSize), cv::Point(-1, -1), true, cv::BORDER_REPLICATE | cv::BORDER_ISOLATED);
+
+		const int offset = region.x - columns.start;
+		for(int row = stripFirst; row < stripLast; row++) {
+			thresholdRow(blurred.ptr<uchar>(row - blurredFirst) + offset, mean.ptr<uchar>(row - blurredFirst) + offset, output.ptr<uchar>(row - region.y), region.width, delta, params.invert);
+		}
+	}
+}
+
+int ThresholdKernel::scaleKernelSize(float size, int reduction) {
+	int scaledSize = 0;
+	if(size > 0) {
+		//Kernels are centered on a pixel, so they need an odd size
+		scaledSize = static_cast<int>(size / std::max(reduction, 1)) | 1;
+	}
+	return scaledSize;
+}
+
+void ThresholdKernel::blurRows(const cv::Mat& image, const ThreshParams& params, int blurSize, int firstRow, int lastRow, const cv::Range& columns, uchar* output) {
+	if(firstRow >= lastRow) {
+		return;
+	}
+
+	const int blurRadius = blurSize > 0 ? blurSize / 2 : 0;
+
+	//Take the source pixels needed to blur the requested pixels, extending past them by the blur radius where the image allows
+	const cv::Range sourceRows(std::max(0, firstRow - blurRadius), std::min(image.rows, lastRow + blurRadius));
+	const cv::Range sourceCols(std::max(0, columns.start - blurRadius), std::min(image.cols, columns.end + blurRadius));
+	const cv::Mat source = image(sourceRows, sourceCols);
+
+	//Copy the pixels out into a buffer of their own, so that the blur extrapolates a border at the buffer's edges the same way it would at the
+	//edges of the whole image. Where the buffer's edge is not the image's edge, the requested pixels are far enough away not to be affected.
+	cv::Mat channel;
+	if(params.channel >= 0) {
+		cv::extractChannel(source, channel, params.channel);
+	} else {
+		cv::cvtColor(source, channel, CV_BGR2GRAY);
+	}
+
+	cv::Mat blurred;
+	if(blurSize > 0) {
+		cv::GaussianBlur(channel, blurred, cv::Size(blurSize, blurSize), 0);
+	} else {
+		blurred = channel;
+	}
+
+	for(int row = firstRow; row < lastRow; row++) {
+		std::memcpy(output + static_cast<size_t>(row - firstRow) * columns.size(), blurred.ptr<uchar>(row - sourceRows.start) + (columns.start - sourceCols.start), columns.size());
+	}
+}
+
+void ThresholdKernel::thresholdRow(const uchar* blurred, const uchar* mean, uchar* output, int width, int delta, bool invert) {
+	//A pixel is bright if it is no more than delta darker than its neighborhood. Bright pixels are white unless the image is inverted.
+	int x = 0;
+
+#if CV_SIMD128
+	const cv::v_int16x8 negativeDelta = cv::v_setall_s16(static_cast<short>(-delta));
+	for(; x <= width - 16; x += 16) {
+		cv::v_uint16x8 blurredLow, blurredHigh, meanLow, meanHigh;
+		cv::v_expand(cv::v_load(blurred + x), blurredLow, blurredHigh);
+		cv::v_expand(cv::v_load(mean + x), meanLow, meanHigh);
+
+		cv::v_int16x8 differenceLow = cv::v_reinterpret_as_s16(blurredLow) - cv::v_reinterpret_as_s16(meanLow);
+		cv::v_int16x8 differenceHigh = cv::v_reinterpret_as_s16(blurredHigh) - cv::v_reinterpret_as_s16(meanHigh);
+
+		//Comparisons produce all ones for true and all zeros for false, which pack down to 255 and 0
+		cv::v_uint8x16 isBright = cv::v_reinterpret_as_u8(cv::v_pack(differenceLow > negativeDelta, differenceHigh > negativeDelta));
+		cv::v_store(output + x, invert ? ~isBright : isBright);
+	}
+#endif
+
+	for(; x < width; x++) {
+		const bool isBright = static_cast<int>(blurred[x]) - static_cast<int>(mean[x]) > -delta;
+		output[x] = isBright != invert ? 255 : 0;
+	}
+}
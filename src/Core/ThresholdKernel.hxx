@@ -0,0 +1,72 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+
+#include "DetectionParams.hxx"
+
+///
+/// <summary> Performs the whole threshold step (channel extraction, blur, adaptive threshold and invert) one horizontal strip of the image at a
+///           time. Each strip's intermediate images are small enough to stay in cache, so the scan is read from memory once and the binary image
+///           is written once, rather than making a full pass over the image for every step. The result is identical to running
+///           cv::extractChannel, cv::GaussianBlur, cv::adaptiveThreshold and cv::bitwise_not on the whole image. </summary>
+///
+class ThresholdKernel {
+public:
+	///
+	/// <summary> Threshold a scanned image </summary>
+	///
+	/// <param name="image"> The image to threshold. Must be an 8 bit BGR image if params.channel is negative. </param>
+	/// <param name="params"> Configuration for the threshold algorithm. params.channel must be a valid channel of image. </param>
+	/// <param name="output"> Output parameter in which the single channel binary image will be placed. Must not share data with image. </param>
+	/// <param name="reduction"> How many times smaller than the original scan the image was decoded. The preblur and block size are scaled down to match. </param>
+	///
+	static void apply(const cv::Mat& image, const ThreshParams& params, cv::Mat& output, int reduction = 1);
+
+	///
+	/// <summary> Threshold one region of a scanned image. The result is the same as the corrisponding region of the result of thresholding the
+	///           whole image, but only the region and enough of its surroundings to compute it are read. </summary>
+	///
+	/// <param name="image"> The image to threshold. Must be an 8 bit BGR image if params.channel is negative. </param>
+	/// <param name="params"> Configuration for the threshold algorithm. params.channel must be a valid channel of image. </param>
+	/// <param name="region"> The region of the image to threshold. Must lie within the image. </param>
+	/// <param name="output"> Output parameter in which the single channel binary image of the region will be placed. Must not share data with image. </param>
+	/// <param name="reduction"> How many times smaller than the original scan the image was decoded. The preblur and block size are scaled down to match. </param>
+	///
+	static void apply(const cv::Mat& image, const ThreshParams& params, const cv::Rect& region, cv::Mat& output, int reduction = 1);
+
+	///
+	/// <summary> Scale the size of a blur or filter kernel given in pixels of the original scan to a scan decoded at a reduced resolution </summary>
+	///
+	/// <param name="size"> The size of the kernel in pixels of the original scan. Zero or less if there is no kernel. </param>
+	/// <param name="reduction"> How many times smaller than the original scan the image was decoded </param>
+	///
+	/// <returns> The scaled size, which is always odd, or 0 if size was zero or less </returns>
+	///
+	static int scaleKernelSize(float size, int reduction);
+
+	//Block size of the adaptive threshold at full resolution, i.e. the width and height of the neighborhood each pixel is compared against
+	static const int BLOCK_SIZE = 75;
+
+	//Number of output rows produced per strip. Larger strips waste less work on the rows shared with the neighboring strips, smaller strips
+	//keep more of the intermediate images in cache.
+	static const int STRIP_HEIGHT = 256;
+
+private:
+	///
+	/// <summary> Compute rows of the blurred single channel image, exactly as they would appear if the whole image were blurred at once </summary>
+	///
+	/// <param name="image"> The image being thresholded </param>
+	/// <param name="params"> Configuration for the threshold algorithm </param>
+	/// <param name="blurSize"> Size of the blur to apply, already scaled to the image. Zero if the image should not be blurred. </param>
+	/// <param name="firstRow"> The first row to compute </param>
+	/// <param name="lastRow"> One past the last row to compute </param>
+	/// <param name="columns"> The range of columns to compute </param>
+	/// <param name="output"> Pointer to where the first computed row should be written. Rows are written contiguously. </param>
+	///
+	static void blurRows(const cv::Mat& image, const ThreshParams& params, int blurSize, int firstRow, int lastRow, const cv::Range& columns, uchar* output);
+
+	///
+	/// <summary> Compare one row of the blurred image against the mean of each pixel's neighborhood, producing one row of the binary image </summary>
+	///
+	static void thresholdRow(const uchar* blurred, const uchar* mean, uchar* output, int width, int delta, bool invert);
+};
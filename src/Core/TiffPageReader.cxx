@@ -0,0 +1,377 @@
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <set>
+#include <sstream>
+
+#include "TiffPageReader.hxx"
+#include "TextLogging.hxx"
+
+namespace {
+	thread_local std::ostringstream tlOss;
+	thread_local TextLogging tlog;
+
+	//Tags whose values are the offsets and sizes of the page's image data
+	const uint16_t TAG_STRIP_OFFSETS = 273;
+	const uint16_t TAG_STRIP_BYTE_COUNTS = 279;
+	const uint16_t TAG_TILE_OFFSETS = 324;
+	const uint16_t TAG_TILE_BYTE_COUNTS = 325;
+
+	//Tags that point at data elsewhere in the file which isn't needed to decode the page (or at further directories). These are left out of
+	//extracted pages rather than following them.
+	const std::set<uint16_t> SKIPPED_TAGS = {
+		288,   //FreeOffsets
+		289,   //FreeByteCounts
+		330,   //SubIFDs
+		513,   //JPEGInterchangeFormat
+		514,   //JPEGInterchangeFormatLength
+		34665, //Exif IFD
+		34853, //GPS IFD
+		40965  //Interoperability IFD
+	};
+
+	const uint16_t TYPE_SHORT = 3;
+	const uint16_t TYPE_LONG = 4;
+
+	const size_t HEADER_SIZE = 8;
+	const size_t ENTRY_SIZE = 12;
+}
+
+TiffPageReader::TiffPageReader() = default;
+TiffPageReader::~TiffPageReader() = default;
+
+int TiffPageReader::open(const std::string& filename) {
+	int status = 0;
+
+	pageOffsets_.clear();
+
+	if(file_.open(filename) < 0) {
+		status = -1;
+	}
+
+	//Check the header, which gives the byte order of the file and the offset of the first page's directory
+	if(status >= 0 && file_.size() < HEADER_SIZE) {
+		status = -1;
+		TLOG_CRITICAL(tlog, tlOss, "\"" << filename << "\" is too short to be a TIFF file");
+	}
+
+	if(status >= 0) {
+		if(file_.data()[0] == 'I' && file_.data()[1] == 'I') {
+			isLittleEndian_ = true;
+		} else if(file_.data()[0] == 'M' && file_.data()[1] == 'M') {
+			isLittleEndian_ = false;
+		} else {
+			status = -1;
+			TLOG_CRITICAL(tlog, tlOss, "\"" << filename << "\" is not a TIFF file");
+		}
+	}
+
+	if(status >= 0 && read16(2) != 42) {
+		status = -1;
+		TLOG_CRITICAL(tlog, tlOss, "\"" << filename << "\" is not a TIFF file, or is a BigTIFF file, which is not supported");
+	}
+
+	//Follow the chain of directories, one per page. Each directory ends with the offset of the next, or zero after the last page.
+	if(status >= 0) {
+		std::set<size_t> visited;
+		size_t offset = read32(4);
+		while(status >= 0 && offset != 0) {
+			if(offset + 2 > file_.size() || offset + 2 + ENTRY_SIZE * read16(offset) + 4 > file_.size()) {
+				status = -1;
+				TLOG_CRITICAL(tlog, tlOss, "Directory of page " << pageOffsets_.size() << " of \"" << filename << "\" extends past the end of the file");
+			} else if(!visited.insert(offset).second) {
+				status = -1;
+				TLOG_CRITICAL(tlog, tlOss, "Directories of \"" << filename << "\" form a loop after page " << pageOffsets_.size());
+			} else {
+				pageOffsets_.push_back(offset);
+				offset = read32(offset + 2 + ENTRY_SIZE * read16(offset));
+			}
+		}
+	}
+
+	if(status >= 0 && pageOffsets_.empty()) {
+		status = -1;
+		TLOG_CRITICAL(tlog, tlOss, "\"" << filename << "\" does not contain any pages");
+	}
+
+	if(status >= 0) {
+		TLOG_INFO(tlog, tlOss, "Found " << pageOffsets_.size() << " pages in \"" << filename << "\"");
+	} else {
+		pageOffsets_.clear();
+		file_.close();
+	}
+
+	return status;
+}
+
+size_t TiffPageReader::numPages() const {
+	return pageOffsets_.size();
+}
+
+const std::string& TiffPageReader::getFilename() const {
+	return file_.getFilename();
+}
+
+int TiffPageReader::readPage(size_t pageIndex, cv::Mat& page, int flags) const {
+	int status = 0;
+
+	if(pageIndex >= pageOffsets_.size()) {
+		status = -1;
+		TLOG_CRITICAL(tlog, tlOss, "Requested page " << pageIndex << " of \"" << getFilename() << "\", which only has " << pageOffsets_.size() << " pages");
+	}
+
+	//OpenCV only decodes the first page of a TIFF, so copy the requested page (which is only that page's compressed data) into a TIFF of its own
+	std::vector<unsigned char> pageData;
+	if(status >= 0) {
+		status = extractPage(pageIndex, pageData);
+	}
+
+	if(status >= 0) {
+		page = cv::imdecode(pageData, flags);
+		if(!page.data) {
+			status = -1;
+			TLOG_CRITICAL(tlog, tlOss, "Failed to decode page " << pageIndex << " of \"" << getFilename() << "\"");
+		}
+	}
+
+	return status;
+}
+
+int TiffPageReader::extractPage(size_t pageIndex, std::vector<unsigned char>& output) const {
+	int status = 0;
+
+	std::vector<DirectoryEntry> entries;
+	status = readDirectory(pageOffsets_[pageIndex], entries);
+
+	//Find the image data. Pages are either split into strips or into tiles.
+	std::vector<uint32_t> dataOffsets;
+	std::vector<uint32_t> dataSizes;
+	uint16_t offsetsTag = 0;
+	uint16_t sizesTag = 0;
+	if(status >= 0) {
+		for(const DirectoryEntry& entry : entries) {
+			if(entry.tag == TAG_STRIP_OFFSETS || entry.tag == TAG_TILE_OFFSETS) {
+				offsetsTag = entry.tag;
+				status = readValues(entry, dataOffsets);
+			} else if(entry.tag == TAG_STRIP_BYTE_COUNTS || entry.tag == TAG_TILE_BYTE_COUNTS) {
+				sizesTag = entry.tag;
+				if(readValues(entry, dataSizes) < 0) {
+					status = -1;
+				}
+			}
+		}
+
+		if(status < 0 || offsetsTag == 0 || sizesTag == 0 || dataOffsets.size() != dataSizes.size()) {
+			status = -1;
+			TLOG_CRITICAL(tlog, tlOss, "Page " << pageIndex << " of \"" << getFilename() << "\" does not say where its image data is");
+		}
+	}
+
+	if(status >= 0) {
+		for(size_t i = 0; i < dataOffsets.size() && status >= 0; i++) {
+			if(static_cast<size_t>(dataOffsets[i]) + dataSizes[i] > file_.size()) {
+				status = -1;
+				TLOG_CRITICAL(tlog, tlOss, "Image data of page " << pageIndex << " of \"" << getFilename() << "\" extends past the end of the file");
+			}
+		}
+	}
+
+	//Lay out the new file: the header, then the page's directory, then any values too large to fit in the directory, then the image data. The
+	//offsets and sizes of the image data are always written as LONGs, since their values change.
+	std::vector<DirectoryEntry> kept;
+	std::vector<size_t> valueSizes;
+	std::vector<size_t> newValueOffsets;
+	std::vector<uint32_t> newDataOffsets;
+	size_t totalSize = 0;
+	if(status >= 0) {
+		for(const DirectoryEntry& entry : entries) {
+			if(SKIPPED_TAGS.count(entry.tag) == 0) {
+				kept.push_back(entry);
+			}
+		}
+
+		totalSize = HEADER_SIZE + 2 + ENTRY_SIZE * kept.size() + 4;
+		for(const DirectoryEntry& entry : kept) {
+			const bool isDataTag = entry.tag == offsetsTag || entry.tag == sizesTag;
+			const size_t valueSize = (isDataTag ? 4 : typeSize(entry.type)) * entry.count;
+			valueSizes.push_back(valueSize);
+
+			//Values that don't fit in the entry have to start on a word boundary
+			if(valueSize > 4) {
+				totalSize += totalSize % 2;
+				newValueOffsets.push_back(totalSize);
+				totalSize += valueSize;
+			} else {
+				newValueOffsets.push_back(0);
+			}
+		}
+
+		for(uint32_t dataSize : dataSizes) {
+			totalSize += totalSize % 2;
+			newDataOffsets.push_back(static_cast<uint32_t>(totalSize));
+			totalSize += dataSize;
+		}
+
+		if(totalSize > std::numeric_limits<uint32_t>::max()) {
+			status = -1;
+			TLOG_CRITICAL(tlog, tlOss, "Page " << pageIndex << " of \"" << getFilename() << "\" is too large to extract");
+		}
+	}
+
+	if(status >= 0) {
+		output.assign(totalSize, 0);
+
+		//Header, in the same byte order as the original file so that values can be copied as they are
+		output[0] = file_.data()[0];
+		output[1] = file_.data()[1];
+		write16(output, 2, 42);
+		write32(output, 4, HEADER_SIZE);
+
+		//Directory
+		write16(output, HEADER_SIZE, static_cast<uint16_t>(kept.size()));
+		for(size_t i = 0; i < kept.size(); i++) {
+			const DirectoryEntry& entry = kept[i];
+			const size_t entryOffset = HEADER_SIZE + 2 + ENTRY_SIZE * i;
+			const size_t valueOffset = valueSizes[i] > 4 ? newValueOffsets[i] : entryOffset + 8;
+
+			write16(output, entryOffset, entry.tag);
+			write32(output, entryOffset + 4, entry.count);
+			if(valueSizes[i] > 4) {
+				write32(output, entryOffset + 8, static_cast<uint32_t>(newValueOffsets[i]));
+			}
+
+			if(entry.tag == offsetsTag || entry.tag == sizesTag) {
+				write16(output, entryOffset + 2, TYPE_LONG);
+				const std::vector<uint32_t>& values = entry.tag == offsetsTag ? newDataOffsets : dataSizes;
+				for(size_t j = 0; j < values.size(); j++) {
+					write32(output, valueOffset + 4 * j, values[j]);
+				}
+			} else {
+				write16(output, entryOffset + 2, entry.type);
+				//Values that fit in the entry are copied along with the unused bytes after them
+				std::memcpy(output.data() + valueOffset, file_.data() + entry.valueOffset, std::max<size_t>(valueSizes[i], 4));
+			}
+		}
+
+		//There are no more pages after this one
+		write32(output, HEADER_SIZE + 2 + ENTRY_SIZE * kept.size(), 0);
+
+		//Image data
+		for(size_t i = 0; i < dataOffsets.size(); i++) {
+			std::memcpy(output.data() + newDataOffsets[i], file_.data() + dataOffsets[i], dataSizes[i]);
+		}
+	}
+
+	return status;
+}
+
+int TiffPageReader::readDirectory(size_t offset, std::vector<DirectoryEntry>& entries) const {
+	int status = 0;
+
+	entries.clear();
+
+	const size_t numEntries = read16(offset);
+	for(size_t i = 0; i < numEntries && status >= 0; i++) {
+		const size_t entryOffset = offset + 2 + ENTRY_SIZE * i;
+
+		DirectoryEntry entry;
+		entry.tag = read16(entryOffset);
+		entry.type = read16(entryOffset + 2);
+		entry.count = read32(entryOffset + 4);
+
+		//Readers are expected to skip tags of types they don't know, since there is no way to tell how large their values are
+		const size_t valueSize = typeSize(entry.type) * entry.count;
+		if(valueSize == 0) {
+			continue;
+		}
+
+		if(valueSize > 4) {
+			entry.valueOffset = read32(entryOffset + 8);
+			if(entry.valueOffset + valueSize > file_.size()) {
+				status = -1;
+				TLOG_CRITICAL(tlog, tlOss, "Value of tag " << entry.tag << " in \"" << getFilename() << "\" extends past the end of the file");
+			}
+		} else {
+			entry.valueOffset = entryOffset + 8;
+		}
+
+		entries.push_back(entry);
+	}
+
+	return status;
+}
+
+int TiffPageReader::readValues(const DirectoryEntry& entry, std::vector<uint32_t>& values) const {
+	int status = 0;
+
+	values.clear();
+	for(size_t i = 0; i < entry.count && status >= 0; i++) {
+		if(entry.type == TYPE_SHORT) {
+			values.push_back(read16(entry.valueOffset + 2 * i));
+		} else if(entry.type == TYPE_LONG) {
+			values.push_back(read32(entry.valueOffset + 4 * i));
+		} else {
+			status = -1;
+		}
+	}
+
+	return status;
+}
+
+size_t TiffPageReader::typeSize(uint16_t type) {
+	size_t size;
+	switch(type) {
+	case 1:  //BYTE
+	case 2:  //ASCII
+	case 6:  //SBYTE
+	case 7:  //UNDEFINED
+		size = 1;
+		break;
+	case 3:  //SHORT
+	case 8:  //SSHORT
+		size = 2;
+		break;
+	case 4:  //LONG
+	case 9:  //SLONG
+	case 11: //FLOAT
+	case 13: //IFD
+		size = 4;
+		break;
+	case 5:  //RATIONAL
+	case 10: //SRATIONAL
+	case 12: //DOUBLE
+		size = 8;
+		break;
+	default:
+		size = 0;
+	}
+	return size;
+}
+
+uint16_t TiffPageReader::read16(size_t offset) const {
+	const unsigned char* bytes = file_.data() + offset;
+	return isLittleEndian_ ? static_cast<uint16_t>(bytes[0] | (bytes[1] << 8)) : static_cast<uint16_t>((bytes[0] << 8) | bytes[1]);
+}
+
+uint32_t TiffPageReader::read32(size_t offset) const {
+	const unsigned char* bytes = file_.data() + offset;
+	if(isLittleEndian_) {
+		return static_cast<uint32_t>(bytes[0]) | (static_cast<uint32_t>(bytes[1]) << 8) | (static_cast<uint32_t>(bytes[2]) << 16) | (static_cast<uint32_t>(bytes[3]) << 24);
+	} else {
+		return (static_cast<uint32_t>(bytes[0]) << 24) | (static_cast<uint32_t>(bytes[1]) << 16) | (static_cast<uint32_t>(bytes[2]) << 8) | static_cast<uint32_t>(bytes[3]);
+	}
+}
+
+void TiffPageReader::write16(std::vector<unsigned char>& output, size_t offset, uint16_t value) const {
+	for(size_t i = 0; i < 2; i++) {
+		const size_t shift = isLittleEndian_ ? 8 * i : 8 * (1 - i);
+		output[offset + i] = static_cast<unsigned char>(value >> shift);
+	}
+}
+
+void TiffPageReader::write32(std::vector<unsigned char>& output, size_t offset, uint32_t value) const {
+	for(size_t i = 0; i < 4; i++) {
+		const size_t shift = isLittleEndian_ ? 8 * i : 8 * (3 - i);
+		output[offset + i] = static_cast<unsigned char>(value >> shift);
+	}
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <opencv2/opencv.hpp>
+
+#include "MappedFile.hxx"
+
+///
+/// <summary> Reads the pages of a multi-page TIFF file one at a time. The file is memory-mapped and only the directory of each page is read when
+///           the file is opened, so the pages' image data is only read from disk when that page is decoded and no more than one page is held
+///           in memory per call to TiffPageReader::readPage(). </summary>
+///
+class TiffPageReader {
+public:
+	TiffPageReader();
+	~TiffPageReader();
+
+	TiffPageReader(const TiffPageReader&) = delete;
+	TiffPageReader& operator=(const TiffPageReader&) = delete;
+
+	///
+	/// <summary> Open a TIFF file and find each of its pages </summary>
+	///
+	/// <param name="filename"> The TIFF file to open </param>
+	///
+	/// <returns> Integer status code. Negative if the file could not be opened or is not a valid TIFF file, non-negative if no error occured. </returns>
+	///
+	int open(const std::string& filename);
+
+	size_t numPages() const;
+
+	///
+	/// <summary> Decode one page of the file. Safe to call from several threads at once. </summary>
+	///
+	/// <param name="pageIndex"> The index of the page to decode, counting from zero </param>
+	/// <param name="page"> Output parameter in which the decoded image will be placed </param>
+	/// <param name="flags"> cv::ImreadModes flags to decode the page with </param>
+	///
+	/// <returns> Integer status code. Negative if an error occured, non-negative if no error occured. </returns>
+	///
+	int readPage(size_t pageIndex, cv::Mat& page, int flags = cv::IMREAD_COLOR) const;
+
+	const std::string& getFilename() const;
+
+private:
+	///
+	/// <summary> One entry of a page's directory, describing one tag </summary>
+	///
+	struct DirectoryEntry {
+		uint16_t tag{0};
+		uint16_t type{0};
+		uint32_t count{0};
+		//Where the tag's value is in the file. Values of 4 bytes or fewer are stored in the entry itself.
+		size_t valueOffset{0};
+	};
+
+	///
+	/// <summary> Copy one page out of the file into a self-contained single page TIFF, leaving out any other pages </summary>
+	///
+	/// <param name="pageIndex"> The index of the page to copy </param>
+	/// <param name="output"> Output parameter in which the single page TIFF will be placed </param>
+	///
+	/// <returns> Integer status code. Negative if the page's directory refers to data outside of the file, non-negative otherwise. </returns>
+	///
+	int extractPage(size_t pageIndex, std::vector<unsigned char>& output) const;
+
+	///
+	/// <summary> Read the entries of the directory at a given offset </summary>
+	///
+	/// <returns> Integer status code. Negative if the directory does not fit within the file, non-negative otherwise. </returns>
+	///
+	int readDirectory(size_t offset, std::vector<DirectoryEntry>& entries) const;
+
+	///
+	/// <summary> Read the values of an entry with an integer type as unsigned 32 bit integers </summary>
+	///
+	/// <returns> Integer status code. Negative if the entry does not have an integer type, non-negative otherwise. </returns>
+	///
+	int readValues(const DirectoryEntry& entry, std::vector<uint32_t>& values) const;
+
+	///
+	/// <summary> Get the size in bytes of one value of a TIFF field type. Zero if the type is unknown. </summary>
+	///
+	static size_t typeSize(uint16_t type);
+
+	uint16_t read16(size_t offset) const;
+	uint32_t read32(size_t offset) const;
+	void write16(std::vector<unsigned char>& output, size_t offset, uint16_t value) const;
+	void write32(std::vector<unsigned char>& output, size_t offset, uint32_t value) const;
+
+	MappedFile file_{};
+	bool isLittleEndian_{true};
+	//The offset of the directory of each page
+	std::vector<size_t> pageOffsets_{};
+};
@@ -0,0 +1,22 @@
+#include <opencv2/opencv.hpp>
+
+#include "QtImageConversion.hxx"
+
+QPixmap QtImageConversion::matToPixmap(const cv::Mat& mat) {
+	//Convert the image from BGR or gray (used by OpenCV) to RGB (used by QT)
+	cv::Mat rgbMat;
+	if(mat.data) {
+		if(mat.channels() == 3) {
+			cv::cvtColor(mat, rgbMat, CV_BGR2RGB);
+		} else {
+			cv::cvtColor(mat, rgbMat, CV_GRAY2RGB);
+		}
+	}
+	
+	if(rgbMat.data) {
+		//Convert to QImage and then to QPixmap
+		return QPixmap::fromImage(QImage(rgbMat.data, rgbMat.cols, rgbMat.rows, rgbMat.step, QImage::Format_RGB888));
+	} else {
+		return QPixmap();
+	}
+}
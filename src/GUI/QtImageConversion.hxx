@@ -0,0 +1,20 @@
+#pragma once
+
+#include <QPixmap>
+
+//Forward declearation of cv::Mat so that we don't have to include opencv in the header.
+namespace cv {
+	class Mat;
+}
+
+class QtImageConversion {
+public:
+	///
+	/// <summary> Convert an OpenCV image to a pixmap that can be displayed by QT. </summary>
+	///
+	/// <param name="mat"> The image to convert. Must be either a 3 channel BGR image or a single channel grayscale image. </param>
+	///
+	/// <returns> The converted pixmap, or a null pixmap if the image is empty. </returns>
+	///
+	static QPixmap matToPixmap(const cv::Mat& mat);
+};
@@ -14,41 +14,58 @@ bool QtLogging::areFatalDialogsEnabledDefault_ = true;
 QtLogging::QtLogging() = default;
 QtLogging::~QtLogging() = default;
 
-void QtLogging::debug(char * file, int line, QWidget* parent, std::ostringstream & tlOss) {
+void QtLogging::debug(const char * file, int line, QWidget* parent, std::ostringstream & tlOss) {
 	if(areDebugDialogsEnabled_ || areDebugDialogsEnabledDefault_) {
 		QMessageBox::information(parent, "Debugging Info", QString::fromStdString("Debugging Message: " + tlOss.str()));
 	}
 	tlog.debug(file, line, tlOss);
 }
 
-void QtLogging::info(char * file, int line, QWidget* parent, std::ostringstream & tlOss) {
+void QtLogging::info(const char * file, int line, QWidget* parent, std::ostringstream & tlOss) {
 	if(areInfoDialogsEnabled_ || areInfoDialogsEnabledDefault_) {
 		QMessageBox::information(parent, "Bubble Scanner", QString::fromStdString(tlOss.str()));
 	}
 	tlog.info(file, line, tlOss);
 }
 
-void QtLogging::warning(char * file, int line, QWidget* parent, std::ostringstream & tlOss) {
+void QtLogging::warning(const char * file, int line, QWidget* parent, std::ostringstream & tlOss) {
 	if(areWarningDialogsEnabled_ || areWarningDialogsEnabledDefault_) {
 		QMessageBox::warning(parent, "Warning", QString::fromStdString(tlOss.str()));
 	}
 	tlog.warning(file, line, tlOss);
 }
 
-void QtLogging::critical(char * file, int line, QWidget* parent, std::ostringstream & tlOss) {
+void QtLogging::critical(const char * file, int line, QWidget* parent, std::ostringstream & tlOss) {
 	if(areCriticalDialogsEnabled_ || areCriticalDialogsEnabledDefault_) {
 		QMessageBox::critical(parent, "Error", QString::fromStdString(tlOss.str()));
 	}
 	tlog.critical(file, line, tlOss);
 }
 
-void QtLogging::fatal(char * file, int line, QWidget* parent, std::ostringstream & tlOss) {
+void QtLogging::fatal(const char * file, int line, QWidget* parent, std::ostringstream & tlOss) {
 	if(areFatalDialogsEnabled_ || areFatalDialogsEnabledDefault_) {
 		QMessageBox::critical(parent, "Fatal Error", QString::fromStdString(tlOss.str()));
 	}
 	tlog.critical(file, line, tlOss);
 }
 
+bool QtLogging::isEnabled(LogLevel level) const {
+	switch(level) {
+	case LogLevel::DEBUG:
+		return areDebugDialogsEnabled_ || areDebugDialogsEnabledDefault_ || tlog.isEnabled(level);
+	case LogLevel::INFO:
+		return areInfoDialogsEnabled_ || areInfoDialogsEnabledDefault_ || tlog.isEnabled(level);
+	case LogLevel::WARNING:
+		return areWarningDialogsEnabled_ || areWarningDialogsEnabledDefault_ || tlog.isEnabled(level);
+	case LogLevel::CRITICAL:
+		return areCriticalDialogsEnabled_ || areCriticalDialogsEnabledDefault_ || tlog.isEnabled(level);
+	case LogLevel::FATAL:
+		return areFatalDialogsEnabled_ || areFatalDialogsEnabledDefault_ || tlog.isEnabled(level);
+	default:
+		return true;
+	}
+}
+
 void QtLogging::setAreDebugDialogsEnabled(bool isEnabled) {
 	areDebugDialogsEnabled_ = isEnabled;
 }
@@ -9,11 +9,17 @@ public:
 	QtLogging();
 	~QtLogging();
 
-	void debug(char *file, int line, QWidget* parent, std::ostringstream& tlOss);
-	void info(char *file, int line, QWidget* parent, std::ostringstream& tlOss);
-	void warning(char *file, int line, QWidget* parent, std::ostringstream& tlOss);
-	void critical(char *file, int line, QWidget* parent, std::ostringstream& tlOss);
-	void fatal(char *file, int line, QWidget* parent, std::ostringstream& tlOss);
+	void debug(const char *file, int line, QWidget* parent, std::ostringstream& tlOss);
+	void info(const char *file, int line, QWidget* parent, std::ostringstream& tlOss);
+	void warning(const char *file, int line, QWidget* parent, std::ostringstream& tlOss);
+	void critical(const char *file, int line, QWidget* parent, std::ostringstream& tlOss);
+	void fatal(const char *file, int line, QWidget* parent, std::ostringstream& tlOss);
+
+	///
+	/// <summary> Check whether entries of a particular level would be shown in a dialog or included in the log. Used by the QLOG_* macros to skip
+	///           formatting messages that would be discarded. </summary>
+	///
+	bool isEnabled(LogLevel level) const;
 
 	void setAreDebugDialogsEnabled(bool isEnabled);
 	void setAreInfoDialogsEnabled(bool isEnabled);
@@ -44,3 +50,26 @@ private:
 	
 };
 
+
+///
+/// <summary> Log a message through a QtLogging instance, formatting it into tlOss only if the entry's level is enabled. Works the same way as the
+///           TLOG_* macros, with the addition of the parent widget for any dialog that is shown. </summary>
+///
+#define QLOG_ENTRY(qlog, parent, tlOss, level, method, message) \
+	do { \
+		if((qlog).isEnabled(level)) { \
+			(tlOss) << message; \
+			(qlog).method(__FILE__, __LINE__, (parent), (tlOss)); \
+		} \
+	} while(false)
+
+#if defined(NDEBUG) && !defined(TLOG_KEEP_DEBUG)
+#define QLOG_DEBUG(qlog, parent, tlOss, message) do {} while(false)
+#else
+#define QLOG_DEBUG(qlog, parent, tlOss, message) QLOG_ENTRY(qlog, parent, tlOss, LogLevel::DEBUG, debug, message)
+#endif
+
+#define QLOG_INFO(qlog, parent, tlOss, message) QLOG_ENTRY(qlog, parent, tlOss, LogLevel::INFO, info, message)
+#define QLOG_WARNING(qlog, parent, tlOss, message) QLOG_ENTRY(qlog, parent, tlOss, LogLevel::WARNING, warning, message)
+#define QLOG_CRITICAL(qlog, parent, tlOss, message) QLOG_ENTRY(qlog, parent, tlOss, LogLevel::CRITICAL, critical, message)
+#define QLOG_FATAL(qlog, parent, tlOss, message) QLOG_ENTRY(qlog, parent, tlOss, LogLevel::FATAL, fatal, message)
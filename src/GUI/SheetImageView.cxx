@@ -0,0 +1,87 @@
+#include <algorithm>
+
+#include <QPainter>
+#include <QPaintEvent>
+
+#include "SheetImageView.hxx"
+
+namespace {
+	//Width of overlay outlines, in image pixels
+	const qreal OUTLINE_WIDTH = 2.0;
+}
+
+bool SheetImageView::Overlay::operator==(const Overlay& other) const {
+	return isSelected == other.isSelected && outline == other.outline;
+}
+
+bool SheetImageView::Overlay::operator!=(const Overlay& other) const {
+	return !(*this == other);
+}
+
+SheetImageView::SheetImageView(QWidget* parent) : QLabel(parent) {}
+
+SheetImageView::~SheetImageView() = default;
+
+void SheetImageView::setBaseImage(const QPixmap& pixmap) {
+	//QLabel repaints the whole label when its pixmap changes
+	setPixmap(pixmap);
+}
+
+void SheetImageView::setOverlays(std::vector<Overlay> overlays) {
+	//Repaint wherever an overlay was or now is, if it changed. Qt merges these into a single repaint.
+	const size_t numCommon = std::min(overlays_.size(), overlays.size());
+	for(size_t i = 0; i < numCommon; i++) {
+		if(overlays_[i] != overlays[i]) {
+			update(overlayRect(overlays_[i]));
+			update(overlayRect(overlays[i]));
+		}
+	}
+	for(size_t i = numCommon; i < overlays_.size(); i++) {
+		update(overlayRect(overlays_[i]));
+	}
+	for(size_t i = numCommon; i < overlays.size(); i++) {
+		update(overlayRect(overlays[i]));
+	}
+
+	overlays_ = std::move(overlays);
+}
+
+void SheetImageView::paintEvent(QPaintEvent* event) {
+	//Draw the image (only the part that needs repainting)
+	QLabel::paintEvent(event);
+
+	if(pixmap() != nullptr && !pixmap()->isNull()) {
+		QPainter painter(this);
+		painter.setClipRegion(event->region());
+		painter.scale(scale(), scale());
+
+		//Selected overlays are red and everything else is blue, as in the annotations drawn by SheetScan
+		QPen pen(Qt::blue, OUTLINE_WIDTH);
+		pen.setJoinStyle(Qt::MiterJoin);
+		const QRect dirtyRect = event->rect();
+		for(const Overlay& overlay : overlays_) {
+			if(dirtyRect.intersects(overlayRect(overlay))) {
+				pen.setColor(overlay.isSelected ? Qt::red : Qt::blue);
+				painter.setPen(pen);
+				painter.drawPolygon(overlay.outline);
+			}
+		}
+	}
+}
+
+QRect SheetImageView::overlayRect(const Overlay& overlay) const {
+	const qreal s = scale();
+	const QRectF imageRect = overlay.outline.boundingRect();
+	const QRectF labelRect(imageRect.topLeft() * s, imageRect.bottomRight() * s);
+	//Pad by the width of the outline (which is centered on the edges) and a pixel for rounding
+	const int padding = static_cast<int>(OUTLINE_WIDTH * s) + 1;
+	return labelRect.toAlignedRect().adjusted(-padding, -padding, padding, padding);
+}
+
+qreal SheetImageView::scale() const {
+	qreal s = 1.0;
+	if(pixmap() != nullptr && pixmap()->width() > 0) {
+		s = static_cast<qreal>(width()) / pixmap()->width();
+	}
+	return s;
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <vector>
+
+#include <QLabel>
+#include <QPolygonF>
+
+///
+/// <summary> Label that displays a sheet image with layout elements drawn over it. The image is converted to a pixmap once, when it changes,
+///           and the outlines are drawn by Qt on top of it each time the label is painted. Changing the outlines only repaints the parts of
+///           the label that changed. </summary>
+///
+/// <note> The image is scaled to fill the label (as with QLabel::setScaledContents()), and the outlines are scaled along with it </note>
+///
+class SheetImageView : public QLabel {
+public:
+	///
+	/// <summary> Outline of a layout element drawn over the image </summary>
+	///
+	struct Overlay {
+		//Corners of the outline, in image pixels
+		QPolygonF outline{};
+		bool isSelected{false};
+
+		bool operator==(const Overlay& other) const;
+		bool operator!=(const Overlay& other) const;
+	};
+
+	SheetImageView(QWidget* parent = Q_NULLPTR);
+	~SheetImageView();
+
+	///
+	/// <summary> Display a new image under the overlays </summary>
+	///
+	void setBaseImage(const QPixmap& pixmap);
+
+	///
+	/// <summary> Replace the overlays drawn over the image. Only the regions covered by overlays that were added, removed or changed are repainted. </summary>
+	///
+	void setOverlays(std::vector<Overlay> overlays);
+
+protected:
+	void paintEvent(QPaintEvent* event);
+
+private:
+	///
+	/// <summary> Get the region of the label an overlay is drawn in, including the width of its outline </summary>
+	///
+	QRect overlayRect(const Overlay& overlay) const;
+
+	///
+	/// <summary> Get the size of an image pixel on the label </summary>
+	///
+	qreal scale() const;
+
+	std::vector<Overlay> overlays_{};
+};
@@ -10,6 +10,7 @@
 #include "ui_SheetLayoutEditor.h"
 
 #include "FilenameOracle.hxx"
+#include "QtImageConversion.hxx"
 #include "QtLogging.hxx"
 
 namespace {
@@ -25,6 +26,8 @@ SheetLayoutEditor::SheetLayoutEditor(QWidget *parent) : QDialog(parent) {
 	ui->imageScrollArea->setWidget(ui->imageLabel);
 	//Make the image viewer background dark.
 	ui->imageScrollArea->setBackgroundRole(QPalette::Dark);
+	//Layout elements are drawn over the editor image by the image view, so the editor image doesn't need its own annotated copy
+	editorImage_.setAnnotationsEnabled(false);
 
 	//Set validators text fields that should only accept numbers
 	ui->bubbleWidthEdit->setValidator(new QDoubleValidator(0.0, 10.0, 20, this));
@@ -85,7 +88,7 @@ void SheetLayoutEditor::on_layoutTree_itemSelectionChanged() {
 		openEditorImage(FilenameOracle::getLayoutDirectoryFilename() + FilenameOracle::getImageDirectory() + focusedSideLayout->getReferenceImageFilename());
 		//Update the editor image to reflect the change in selection
 	}
-	reloadEditorImage();
+	annotateEditorImage();
 	//Update toolbox fields
 	updateBubbleEditor();
 	updateQuestionEditor();
@@ -105,16 +108,14 @@ void SheetLayoutEditor::on_alignBackgroundButton_clicked() {
 
 	//Check that the sheet image exists
 	if(editorImage_.empty()) {
-		tlOss << "Not aligning background because editor image is not loaded.";
-		qlog.debug(__FILE__, __LINE__, this, tlOss);
+		QLOG_DEBUG(qlog, this, tlOss, "Not aligning background because editor image is not loaded.");
 		status = 1;
 	}
 
 	//Get the name of the current image alignment algorithm from the algorithm chooser
 	std::string algorithmName = ui->alignmentAlgoChooser->currentText().toStdString();
 	if(status == 0 && algorithmName.empty()) {
-		tlOss << "Not aligning background image because no alignment algorithm is selected.";
-		qlog.debug(__FILE__, __LINE__, this, tlOss);
+		QLOG_DEBUG(qlog, this, tlOss, "Not aligning background image because no alignment algorithm is selected.");
 		status = 1;
 	}
 
@@ -123,8 +124,7 @@ void SheetLayoutEditor::on_alignBackgroundButton_clicked() {
 	if(status == 0) {
 		if(algorithmParams.load(FilenameOracle::getAlignmentAlgorithmsFilename(), algorithmName) < 0) {
 			status = -1;
-			tlOss << "Failed to load sheet alignment algorithm \"" << algorithmName << "\"";
-			qlog.critical(__FILE__, __LINE__, this, tlOss);
+			QLOG_CRITICAL(qlog, this, tlOss, "Failed to load sheet alignment algorithm \"" << algorithmName << "\"");
 		}
 	}
 
@@ -132,8 +132,7 @@ void SheetLayoutEditor::on_alignBackgroundButton_clicked() {
 	if(status == 0) {
 		if(editorImage_.setupAlgorithm(algorithmParams) < 0) {
 			status = -1;
-			tlOss << "Failed to initialize alignment algorithm \"" << algorithmName << "\"";
-			qlog.critical(__FILE__, __LINE__, this, tlOss);
+			QLOG_CRITICAL(qlog, this, tlOss, "Failed to initialize alignment algorithm \"" << algorithmName << "\"");
 		}
 	}
 
@@ -141,8 +140,9 @@ void SheetLayoutEditor::on_alignBackgroundButton_clicked() {
 	if(status == 0) {
 		if(editorImage_.alignScan(algorithmParams) < 0) {
 			status = -1;
-			tlOss << "Failed to align image.";
-			qlog.critical(__FILE__, __LINE__, this, tlOss);
+			QLOG_CRITICAL(qlog, this, tlOss, "Failed to align image.");
+		} else if(editorImage_.hasLayoutTransform()) {
+			QLOG_WARNING(qlog, this, tlOss, "Alignment algorithm \"" << algorithmName << "\" does not straighten the image, so the editor image is left unaligned.");
 		}
 	}
 
@@ -155,16 +155,14 @@ void SheetLayoutEditor::on_recognizeCirclesButton_clicked() {
 
 	//Check that the sheet image exists
 	if(editorImage_.empty()) {
-		tlOss << "Not running circle recognition algorithm because editor image is not loaded.";
-		qlog.debug(__FILE__, __LINE__, this, tlOss);
+		QLOG_DEBUG(qlog, this, tlOss, "Not running circle recognition algorithm because editor image is not loaded.");
 		status = 1;
 	}
 
 	//Get the circle recognition algorithm to use from the algorithm chooser
 	std::string algorithmName = ui->circleAlgoPicker->currentText().toStdString();
 	if(status == 0 && algorithmName.empty()) {
-		tlOss << "Not running circle recognition algorithm because no algorithm is selected.";
-		qlog.debug(__FILE__, __LINE__, this, tlOss);
+		QLOG_DEBUG(qlog, this, tlOss, "Not running circle recognition algorithm because no algorithm is selected.");
 		status = 1;
 	}
 
@@ -173,8 +171,7 @@ void SheetLayoutEditor::on_recognizeCirclesButton_clicked() {
 	if(status == 0) {
 		if(algorithmParams.load(FilenameOracle::getCircleAlgorithmsFilename(), algorithmName) < 0) {
 			status = -1;
-			tlOss << "Failed to load circle recognition algorithm \"" << algorithmName << "\"";
-			qlog.critical(__FILE__, __LINE__, this, tlOss);
+			QLOG_CRITICAL(qlog, this, tlOss, "Failed to load circle recognition algorithm \"" << algorithmName << "\"");
 		}
 	}
 
@@ -182,8 +179,7 @@ void SheetLayoutEditor::on_recognizeCirclesButton_clicked() {
 	if(status == 0) {
 		if(editorImage_.setupAlgorithm(algorithmParams) < 0) {
 			status = -1;
-			tlOss << "Failed to initialize circle recognition algorithm \"" << algorithmName << "\"";
-			qlog.critical(__FILE__, __LINE__, this, tlOss);
+			QLOG_CRITICAL(qlog, this, tlOss, "Failed to initialize circle recognition algorithm \"" << algorithmName << "\"");
 		}
 	}
 
@@ -191,8 +187,7 @@ void SheetLayoutEditor::on_recognizeCirclesButton_clicked() {
 	if(status == 0) {
 		if(editorImage_.findCircles(circles, algorithmParams) < 0) {
 			status = -1;
-			tlOss << "Circle recognition algorithm reported an error.";
-			qlog.critical(__FILE__, __LINE__, this, tlOss);
+			QLOG_CRITICAL(qlog, this, tlOss, "Circle recognition algorithm reported an error.");
 		}
 	}
 
@@ -208,7 +203,7 @@ void SheetLayoutEditor::on_recognizeCirclesButton_clicked() {
 			unownedLayoutElements.add(bubble);
 		}
 		buildLayoutTree();
-		reloadEditorImage();
+		annotateEditorImage();
 	}
 	
 }
@@ -236,7 +231,7 @@ void SheetLayoutEditor::on_bubbleHeightEdit_editingFinished() {
 void SheetLayoutEditor::on_addBubble_clicked() {
 	unownedLayoutElements.add(EasyGrade::BubbleLayout());
 	buildLayoutTree();
-	reloadEditorImage();
+	annotateEditorImage();
 }
 
 void SheetLayoutEditor::on_deleteBubbles_clicked() {
@@ -263,8 +258,7 @@ void SheetLayoutEditor::on_questionFromBubbles_clicked() {
 		if(treeItem->type() == static_cast<int>(TreeItemType::BUBBLE_LAYOUT)) {
 			EasyGrade::BubbleLayout* bubble_ptr = dynamic_cast<EasyGrade::BubbleLayout*>(findLayoutElement(treeItem));
 			if(bubble_ptr == nullptr) {
-				tlOss << "Attempted to add non-existant bubble to new question";
-				qlog.critical(__FILE__, __LINE__, this, tlOss);
+				QLOG_CRITICAL(qlog, this, tlOss, "Attempted to add non-existant bubble to new question");
 			} else {
 				newQuestion.addBubble(bubble_ptr);
 				selectedBubbles.append(treeItem);
@@ -300,16 +294,14 @@ void SheetLayoutEditor::on_groupToSide_clicked() {
 
 	//Find all of the selected question groups and add them to the selected side
 	if(focusedSide_ptr == nullptr) {
-		tlOss << "Attempted to add group layouts to nonexistant side";
-		qlog.critical(__FILE__, __LINE__, this, tlOss);
+		QLOG_CRITICAL(qlog, this, tlOss, "Attempted to add group layouts to nonexistant side");
 	} else {
 		QList<QTreeWidgetItem*> selectedGroups;
 		for(const auto& treeItem : ui->layoutTree->selectedItems()) {
 			if(treeItem->type() == static_cast<int>(TreeItemType::QUESTION_GROUP_LAYOUT)) {
 				EasyGrade::GroupLayout* group_ptr = dynamic_cast<EasyGrade::GroupLayout*>(findLayoutElement(treeItem));
 				if(group_ptr == nullptr) {
-					tlOss << "Attempted to add non-existant group to new side";
-					qlog.critical(__FILE__, __LINE__, this, tlOss);
+					QLOG_CRITICAL(qlog, this, tlOss, "Attempted to add non-existant group to new side");
 				} else {
 					focusedSide_ptr->addGroup(group_ptr);
 					selectedGroups.append(treeItem);
@@ -337,8 +329,7 @@ void SheetLayoutEditor::on_groupFromQuestions_clicked() {
 		if(treeItem->type() == static_cast<int>(TreeItemType::QUESTION_LAYOUT)) {
 			EasyGrade::QuestionLayout* question_ptr = dynamic_cast<EasyGrade::QuestionLayout*>(findLayoutElement(treeItem));
 			if(question_ptr == nullptr) {
-				tlOss << "Attempted to add non-existant question to new group";
-				qlog.critical(__FILE__, __LINE__, this, tlOss);
+				QLOG_CRITICAL(qlog, this, tlOss, "Attempted to add non-existant question to new group");
 			} else {
 				newGroup.addQuestion(question_ptr);
 				selectedQuestions.append(treeItem);
@@ -377,8 +368,7 @@ void SheetLayoutEditor::on_saveButton_clicked() {
 	//Check that the layout to load is in the list of layouts.
 	if(layouts_.find(layoutTitle) == layouts_.end()) {
 		status = -1;
-		tlOss << "Unrecognized sheet layout title \"" << layoutTitle << "\".";
-		qlog.critical(__FILE__, __LINE__, this, tlOss);
+		QLOG_CRITICAL(qlog, this, tlOss, "Unrecognized sheet layout title \"" << layoutTitle << "\".");
 	}
 
 	//Write the current state of the sheet layout to the appropriate file
@@ -401,8 +391,7 @@ int SheetLayoutEditor::reloadLayoutList() {
 	QDir sheetLayoutsDirectory(QString::fromStdString(FilenameOracle::getLayoutDirectoryFilename()), "*.xml");
 	QFileInfoList layoutFiles = sheetLayoutsDirectory.entryInfoList();
 
-	tlOss << "Found " << layoutFiles.size() << " sheet layout files.";
-	qlog.debug(__FILE__, __LINE__, this, tlOss);
+	QLOG_DEBUG(qlog, this, tlOss, "Found " << layoutFiles.size() << " sheet layout files.");
 
 	//Get the title of each sheet layout in the list and add it to the drop down menu as well as the list of sheet layouts
 	for(const auto& fileInfo : layoutFiles) {
@@ -412,8 +401,7 @@ int SheetLayoutEditor::reloadLayoutList() {
 		//Read the sheet layout file into a scan sheet layout
 		EasyGrade::ScanSheetLayout currentLayout;
 		if(currentLayout.readXml(sheetLayoutStream) < 0) {
-			tlOss << "Failed to read sheet layout file \"" << fileInfo.fileName().toStdString() << "\"";
-			qlog.warning(__FILE__, __LINE__, this, tlOss);
+			QLOG_WARNING(qlog, this, tlOss, "Failed to read sheet layout file \"" << fileInfo.fileName().toStdString() << "\"");
 		} else {
 			//Add this sheet layout to the layout picker box
 			std::string layoutTitle = currentLayout.getTitle();
@@ -445,8 +433,7 @@ int SheetLayoutEditor::openLayout(const std::string& layoutTitle) {
 	//Check that the layout to load is in the list of layouts.
 	if(layouts_.find(layoutTitle) == layouts_.end()) {
 		status = -1;
-		tlOss << "Unrecognized sheet layout title \"" << layoutTitle << "\".";
-		qlog.critical(__FILE__, __LINE__, this, tlOss);
+		QLOG_CRITICAL(qlog, this, tlOss, "Unrecognized sheet layout title \"" << layoutTitle << "\".");
 	}
 
 	//Load the sheet layout
@@ -455,8 +442,7 @@ int SheetLayoutEditor::openLayout(const std::string& layoutTitle) {
 		std::ifstream sheetLayoutStream(sheetLayoutFile.absoluteFilePath().toStdString());
 		if(currentLayout_.readXml(sheetLayoutStream) < 0) {
 			status = -1;
-			tlOss << "Failed to load sheet layout \"" << layoutTitle << "\" from \"" << layouts_[layoutTitle] << "\"";
-			qlog.critical(__FILE__, __LINE__, this, tlOss);
+			QLOG_CRITICAL(qlog, this, tlOss, "Failed to load sheet layout \"" << layoutTitle << "\" from \"" << layouts_[layoutTitle] << "\"");
 		}
 		sheetLayoutStream.close();
 	}
@@ -496,6 +482,13 @@ int SheetLayoutEditor::buildLayoutTree() {
 	//Add unowned layout elements to tree
 	ui->layoutTree->addTopLevelItem(unownedElementsItem);
 
+	//The unowned layout elements may have been added, removed or moved, so box selection needs a fresh view of where they are
+	unownedLayoutElements.refreshSpatialIndex();
+
+	//The tree is rebuilt after every change to the layout's structure, which leaves the layout's flat index pointing at elements that may no
+	//longer exist
+	currentLayout_.refreshIndex();
+
 	return status;
 }
 
@@ -515,6 +508,8 @@ QTreeWidgetItem* SheetLayoutEditor::buildTreeWidget(EasyGrade::SheetLayoutElemen
 
 	//Create the tree item for this layout element
 	QTreeWidgetItem* current = new QTreeWidgetItem(parent, QStringList(QString::fromStdString(layoutElement->toString())), static_cast<int>(itemType));
+	//Remember which layout element this item stands for, so that findLayoutElement() doesn't have to search the layout for it
+	current->setData(0, Qt::UserRole, QVariant::fromValue(static_cast<void*>(layoutElement)));
 
 	//Generate tree items for the children of this layout element
 	for(int i = 0; i < layoutElement->numChildren(); i++) {
@@ -530,15 +525,13 @@ int SheetLayoutEditor::openEditorImage(const std::string& filename) {
 	//Load the image specified by filename
 	if(editorImage_.load(filename) < 0) {
 		status = -1;
-		tlOss << "Unable to open image file \"" << filename << "\", it may be missing or corrupt.";
-		qlog.critical(__FILE__, __LINE__, this, tlOss);
+		QLOG_CRITICAL(qlog, this, tlOss, "Unable to open image file \"" << filename << "\", it may be missing or corrupt.");
 	}
 
 	//Display the image in the editor
 	if(status >= 0 && reloadEditorImage() < 0) {
 		status = -1;
-		tlOss << "Image loaded from \"" << filename << "\" (associated with this sheet layout) appears to be empty.";
-		qlog.warning(__FILE__, __LINE__, this, tlOss);
+		QLOG_WARNING(qlog, this, tlOss, "Image loaded from \"" << filename << "\" (associated with this sheet layout) appears to be empty.");
 	}
 
 
@@ -549,41 +542,41 @@ void SheetLayoutEditor::annotateEditorImage() {
 	int status = 0;
 	//If the editor image is empty, there is nothing to annotate, so just return
 	if(editorImage_.empty()) {
-		tlOss << "Not annotating sheet layout editor image, editorImage is not loaded.";
-		qlog.debug(__FILE__, __LINE__, this, tlOss);
+		QLOG_DEBUG(qlog, this, tlOss, "Not annotating sheet layout editor image, editorImage is not loaded.");
 		status = 1;
 	}
 
+	std::vector<SheetImageView::Overlay> overlays;
 	if(status <= 0) {
-		//Reset all annotations on the layout background image
-		editorImage_.resetAnnotations();
-
-		//Draw each visible item in the layout tree
+		//Outline each visible item in the layout tree
 		for(QTreeWidgetItem* item = ui->layoutTree->topLevelItem(0); item != nullptr; item = ui->layoutTree->itemBelow(item)) {
-			//Set the color to draw the layout element based on whether or not its item is selected.
-			cv::Scalar color(255, 0, 0);
-			if(item->isSelected()) {
-				color = cv::Scalar(0, 0, 255);
-			}
-			 
-			//Draw the layout element
-
 			if(item->type() == (int)TreeItemType::BUBBLE_LAYOUT) {
 				EasyGrade::BubbleLayout* bubble = dynamic_cast<EasyGrade::BubbleLayout*>(findLayoutElement(item));
 				if(bubble != nullptr) {
+					//Convert each corner separately, since aligning the image may have left the layout skewed relative to it
 					EasyGrade::Rectangle boundingBox = bubble->boundingBox();
-					cv::Rect2f cvBox(boundingBox.getLeftEdge(), boundingBox.getTopEdge(), boundingBox.getWidth(), boundingBox.getHeight());
-					editorImage_.annotateRect(cvBox, color, 2);
+					SheetImageView::Overlay overlay;
+					for(const cv::Point2f& corner : {cv::Point2f(boundingBox.getLeftEdge(), boundingBox.getTopEdge()), cv::Point2f(boundingBox.getRightEdge(), boundingBox.getTopEdge()),
+					                                 cv::Point2f(boundingBox.getRightEdge(), boundingBox.getBottomEdge()), cv::Point2f(boundingBox.getLeftEdge(), boundingBox.getBottomEdge())}) {
+						const cv::Point2f imageCorner = editorImage_.toImage(corner);
+						overlay.outline << QPointF(imageCorner.x, imageCorner.y);
+					}
+					//The color the layout element is drawn in depends on whether or not its item is selected
+					overlay.isSelected = item->isSelected();
+					overlays.push_back(overlay);
 				}
 			}
 		}
 	}
+
+	//Only the outlines that changed are redrawn
+	ui->imageLabel->setOverlays(std::move(overlays));
 }
 
 void SheetLayoutEditor::boxSelection(const EasyGrade::Rectangle& selectionBox) {
-	//Note: This function works by iterating over the unassigned layout elements in the layout tree display, not in the UnassignedLayoutElements instance itself. This is because there is currently a method for
-	//going from an item in the layout tree display to its corrisponding layout element, but not the other way around. This is important because which elements are selected is stored in the layout tree display,
-	//while the positions of elements (and therefore whether they should be selected) are stored in the layout elements themselves, so this method needs both.
+	//Note: This function finds the unassigned layout elements in the selection box using the spatial index of the unowned layout elements, then selects the corrisponding items in the layout tree display.
+	//Which elements are selected is stored in the layout tree display, while the positions of elements are stored in the layout elements themselves. The unassigned elements item has one child for each
+	//unowned layout element, in the same order, so the index of an element is also the index of its item.
 
 	int status = 0;
 
@@ -600,24 +593,21 @@ void SheetLayoutEditor::boxSelection(const EasyGrade::Rectangle& selectionBox) {
 
 		if(unassignedElementsItem == nullptr) {
 			status = -1;
-			tlOss << "Failed to find unassigned layout elements tree item";
-			qlog.critical(__FILE__, __LINE__, this, tlOss);
+			QLOG_CRITICAL(qlog, this, tlOss, "Failed to find unassigned layout elements tree item");
 		}
 
 	}
 
 	if(status >= 0) {
-		//Iterate over all unowned layout elements
-		for(int i = 0; i < unassignedElementsItem->childCount(); i++) {
-			QTreeWidgetItem* item = unassignedElementsItem->child(i);
-			EasyGrade::SheetLayoutElement* element = findLayoutElement(item);
-			if(element == nullptr) {
-				tlOss << "Encountered invalid sheet layout element while performing box selection.";
-				qlog.warning(__FILE__, __LINE__, this, tlOss);
+		//Select the items of the unowned layout elements that intersect the selection box
+		std::vector<size_t> elementIndices;
+		unownedLayoutElements.spatialIndex().query(selectionBox, elementIndices);
+		for(size_t index : elementIndices) {
+			QTreeWidgetItem* item = unassignedElementsItem->child(static_cast<int>(index));
+			if(item == nullptr) {
+				QLOG_WARNING(qlog, this, tlOss, "Encountered invalid sheet layout element while performing box selection.");
 			} else {
-				if(selectionBox.doesIntersect(element->boundingBox())) {
-					item->setSelected(true);
-				}
+				item->setSelected(true);
 			}
 		}
 	}
@@ -627,21 +617,21 @@ void SheetLayoutEditor::boxSelection(const EasyGrade::Rectangle& selectionBox) {
 int SheetLayoutEditor::reloadEditorImage() {
 	int status = 0;
 
-	annotateEditorImage();
-
-	//Get the pixmap to display from the SheetScan.
-	QPixmap editorPixmap = editorImage_.getAnnotatedPixmap();
+	//Get the pixmap to display from the SheetScan. Layout elements are drawn over it by the image view, so this is only needed when the image itself changes.
+	QPixmap editorPixmap = QtImageConversion::matToPixmap(editorImage_.getSheetImage());
 	if(editorPixmap.isNull()) {
 		status = -1;
 	}
 
 	if(status == 0) {
 		//Display the new pixmap in the image label
-		ui->imageLabel->setPixmap(editorPixmap);
+		ui->imageLabel->setBaseImage(editorPixmap);
 		//Resize the image label (in case the pixmap is a different size).
 		zoomEditorImage();
 	}
 
+	annotateEditorImage();
+
 	return status;
 }
 
@@ -653,8 +643,7 @@ int SheetLayoutEditor::zoomEditorImage(float amount) {
 	int status = 0;
 
 	if(amount <= 0) {
-		tlOss << "Invalid scale amount: " << amount;
-		qlog.warning(__FILE__, __LINE__, this, tlOss);
+		QLOG_WARNING(qlog, this, tlOss, "Invalid scale amount: " << amount);
 	}
 
 	if(status >= 0) {
@@ -680,12 +669,10 @@ int SheetLayoutEditor::reloadAlgorithmList() {
 	//Get the list of alignment algorithms
 	std::vector<std::string> alignmentAlgorithms;
 	if(DetectionParams::getFilterList(FilenameOracle::getAlignmentAlgorithmsFilename(), alignmentAlgorithms) >= 0) {
-		tlOss << "Found " << alignmentAlgorithms.size() << " image alignment algorithms";
-		qlog.debug(__FILE__, __LINE__, this, tlOss);
+		QLOG_DEBUG(qlog, this, tlOss, "Found " << alignmentAlgorithms.size() << " image alignment algorithms");
 	} else {
 		status = -1;
-		tlOss << "Failed to load background image alignment algorithms.";
-		qlog.warning(__FILE__, __LINE__, this, tlOss);
+		QLOG_WARNING(qlog, this, tlOss, "Failed to load background image alignment algorithms.");
 	}
 
 	//Add alignment algorithms to the combo box
@@ -699,12 +686,10 @@ int SheetLayoutEditor::reloadAlgorithmList() {
 	std::vector<std::string> circleAlgorithms;
 	if(status >= 0) {
 		if(DetectionParams::getFilterList(FilenameOracle::getCircleAlgorithmsFilename(), circleAlgorithms) >= 0) {
-			tlOss << "Found " << circleAlgorithms.size() << " circle detection algorithms";
-			qlog.debug(__FILE__, __LINE__, this, tlOss);
+			QLOG_DEBUG(qlog, this, tlOss, "Found " << circleAlgorithms.size() << " circle detection algorithms");
 		} else {
 			status = -1;
-			tlOss << "Failed to load circle recognition alignment algorithms.";
-			qlog.warning(__FILE__, __LINE__, this, tlOss);
+			QLOG_WARNING(qlog, this, tlOss, "Failed to load circle recognition alignment algorithms.");
 		}
 	}
 
@@ -795,7 +780,7 @@ void SheetLayoutEditor::applyBubbleEditor() {
 	}
 
 	buildLayoutTree();
-	reloadEditorImage();
+	annotateEditorImage();
 }
 
 void SheetLayoutEditor::resetbubbleEditor() {
@@ -865,14 +850,13 @@ void SheetLayoutEditor::applyQuestionEditor() {
 			if(parent_ptr != nullptr) {
 				parent_ptr->refreshQuestionNumbers();
 			} else {
-				tlOss << "Failed to re-sort question group";
-				qlog.warning(__FILE__, __LINE__, this, tlOss);
+				QLOG_WARNING(qlog, this, tlOss, "Failed to re-sort question group");
 			}
 		}
 	}
 
 	buildLayoutTree();
-	reloadEditorImage();
+	annotateEditorImage();
 
 }
 
@@ -915,7 +899,7 @@ void SheetLayoutEditor::applyGroupEditor() {
 	}
 
 	buildLayoutTree();
-	reloadEditorImage();
+	annotateEditorImage();
 }
 
 void SheetLayoutEditor::resetGroupEditor() {
@@ -930,15 +914,14 @@ void SheetLayoutEditor::removeLayoutElements(QList<QTreeWidgetItem*>& items) {
 	for(const auto& item : items) {
 		if(item == nullptr) {
 			status = -1;
-			tlOss << "Attempted to delete null tree item";
-			qlog.critical(__FILE__, __LINE__, this, tlOss);
+			QLOG_CRITICAL(qlog, this, tlOss, "Attempted to delete null tree item");
 		}
 
 		if(status >= 0) {
 			EasyGrade::SheetLayoutElement* layoutElement = findLayoutElement(item);
 			if(layoutElement == nullptr) {
 				status = -1;
-				tlOss << "Failed to find sheet layout element to delete.";
+				QLOG_CRITICAL(qlog, this, tlOss, "Failed to find sheet layout element to delete.");
 			} else {
 				layoutElements.push_back(layoutElement);
 			}
@@ -963,8 +946,7 @@ bool SheetLayoutEditor::isOwned(QTreeWidgetItem* item) {
 	int status = 0;
 	if(item == nullptr) {
 		status = -1;
-		tlOss << "Encountered null tree item.";
-		qlog.critical(__FILE__, __LINE__, this, tlOss);
+		QLOG_CRITICAL(qlog, this, tlOss, "Encountered null tree item.");
 	}
 
 	QTreeWidgetItem* parent = nullptr;
@@ -996,27 +978,8 @@ EasyGrade::SheetLayoutElement* SheetLayoutEditor::findLayoutElement(QTreeWidgetI
 
 	EasyGrade::SheetLayoutElement* element = nullptr;
 	if(status == 0) {
-		//Check if this is a top level item of the layout tree (indexOfTopLevelItem() returns -1 if it is not)
-		int index = ui->layoutTree->indexOfTopLevelItem(item);
-		if(index >= 0) {
-			//If this is a top level item of the layout tree, then it is either a sheet layout or the unowned layout elements item (in which case this function should return a null pointer.
-			if(item->type() == (int)TreeItemType::SIDE_LAYOUT) {
-				element = currentLayout_.sideLayout(index);
-			} else {
-				element = nullptr;
-			}
-		} else {
-			//If this is not a top level item, request it from its parent
-			QTreeWidgetItem* parentItem = item->parent();
-			index = parentItem->indexOfChild(item);
-			EasyGrade::SheetLayoutElement* parentElement = findLayoutElement(parentItem);
-			if(parentElement == nullptr) {
-				//If the parent element does not exist then this element is unowned and can be found in the unowned layout elements list
-				element = unownedLayoutElements.elementAt(index);
-			} else {
-				element = parentElement->childAt(index);
-			}
-		}
+		//Items that don't stand for a layout element (i.e. the unowned layout elements item) hold no pointer, so this is null for them
+		element = static_cast<EasyGrade::SheetLayoutElement*>(item->data(0, Qt::UserRole).value<void*>());
 	}
 
 	return element;
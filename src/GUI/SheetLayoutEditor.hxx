@@ -10,6 +10,7 @@
 #include "ScanSheetLayout.hxx"
 #include "SheetScan.hxx"
 #include "LayoutElementContainer.hxx"
+#include "SheetImageView.hxx"
 
 enum class TreeItemType : int {
 	UNKNOWN = QTreeWidgetItem::UserType,
@@ -117,7 +118,9 @@ private:
 	///
 	int openEditorImage(const std::string& filename);
 
-
+	///
+	/// <summary> Update the outlines of layout elements drawn over the editor image to match the layout tree display. Only outlines that changed are redrawn. </summary>
+	///
 	void annotateEditorImage();
 
 	void boxSelection(const EasyGrade::Rectangle& selectionBox);
@@ -125,6 +128,8 @@ private:
 	///
 	/// <summary> Reloads the editor background image from the SheetScan in memory. This will make the GUI reflect any changes / image processing that have been applied to the SheetScan. </summary>
 	///
+	/// <note> This converts the whole image, so it should only be called when the image changes. Use annotateEditorImage() when only the layout changes. </note>
+	///
 	int reloadEditorImage();
 
 	///
@@ -171,5 +176,12 @@ private:
 	///
 	bool isOwned(QTreeWidgetItem *item);
 
+	///
+	/// <summary> Get the sheet layout element that an item in the layout tree display stands for </summary>
+	///
+	/// <returns> A pointer to the layout element, or a null pointer if the item does not stand for one (e.g. the unassigned elements list) </returns>
+	///
+	/// <note> Each item holds a pointer to its element, set when the layout tree display is built, so the display must be rebuilt after layout elements are removed </note>
+	///
 	EasyGrade::SheetLayoutElement* findLayoutElement(QTreeWidgetItem* item);
 };
\ No newline at end of file